@@ -17,6 +17,8 @@
 #include <opencv2/imgproc.hpp>
 #include <opencv2/opencv_modules.hpp>
 #include <stdio.h>
+#include "depth_sampler.h"
+#include "color_classifier.h"
 
 #define PI 3.14159265
 
@@ -89,6 +91,7 @@ Mat result;
 Mat result_fake;
 ros::Publisher pub;
 ros::Publisher pub_markers;
+ColorClassifier color_classifier;
 
 vector<vector<float> > circle_pix_all;
 vector<vector<float> > circle_met_all;
@@ -201,23 +204,11 @@ vector<float> find_circle_depth_total(Mat dep_img, Mat inrange_img, vector<vecto
   int real_ball=circle_pix.size();
   for (int i=0 ; i<real_ball; i++)
   {
-    Scalar color = Scalar(0,0,255);
-    Mat find_depth_img(Size(1280, 720), CV_8UC3, Scalar(0,0,0));
     float pix_x = circle_pix[i][0];
     float pix_y = circle_pix[i][1];
     float ball_rad = circle_pix[i][2];
-    circle(find_depth_img, Point2f(pix_x, pix_y), (int)(ball_rad),color,CV_FILLED,8,0);
-    Mat roi_mask=make_roi(find_depth_img, pix_x, pix_y, ball_rad);
-    Mat roi_depth=make_roi(dep_img, pix_x, pix_y, ball_rad);
-    Mat roi_inrange=make_roi(inrange_img, pix_x, pix_y, ball_rad);
-    Mat mask;
-    inRange(roi_mask, Scalar(0, 0, 254, 0), Scalar(0, 0, 255, 0), mask);
-    Mat roi_bitwise_mask;
-    bitwise_and(mask, roi_inrange, roi_bitwise_mask);
-    Scalar mean_value;
-    mean_value = mean(roi_depth, roi_bitwise_mask); //Mean distance value of red pixels
-    float mean_val_raw = sum(mean_value)[0];
-    float mean_val = roundf(mean_val_raw * 1000) / 1000;
+    DepthStats stats = sample_circle_depth(dep_img, inrange_img, pix_x, pix_y, (int)(ball_rad)); //Mean distance value of ball pixels
+    float mean_val = roundf(stats.mean * 1000) / 1000;
     ball_mean_depth.push_back(mean_val);
   }
   return ball_mean_depth;
@@ -229,18 +220,11 @@ vector<float> find_circle_depth_center(Mat dep_img, Mat inrange_img, vector<vect
   int real_ball=circle_pix.size();
   for (int i=0 ; i<real_ball; i++)
   {
-    Scalar color = Scalar(0,0,255);
-    Mat find_depth_img(Size(1280, 720), CV_8UC3, Scalar(0,0,0));
     float pix_x = circle_pix[i][0];
     float pix_y = circle_pix[i][1];
     float ball_rad = circle_pix[i][2];
-    circle(find_depth_img, Point2f(pix_x, pix_y) , (int)(ball_rad*0.5), color, CV_FILLED, 8, 0);
-    Mat mask;
-    inRange(find_depth_img, Scalar(0, 0, 254, 0), Scalar(0, 0, 255, 0), mask);
-    Scalar mean_value;
-    mean_value = mean(dep_img, mask); //Mean distance value of red pixels
-    float mean_val_raw = sum(mean_value)[0];
-    float mean_val = roundf(mean_val_raw * 1000) / 1000;
+    DepthStats stats = sample_circle_depth(dep_img, Mat(), pix_x, pix_y, (int)(ball_rad*0.5)); //Mean distance value of the inner half disk
+    float mean_val = roundf(stats.mean * 1000) / 1000;
     ball_mean_depth.push_back(mean_val);
   }
   return ball_mean_depth;
@@ -834,6 +818,21 @@ void on_trackbar_depth_low(int, void*)
 
 
 
+// HSV boxes of the current thresholds, red twice for the hue wrap
+vector<ColorRange> color_ranges()
+{
+  ColorRange red1 = {LABEL_RED, Scalar(low_h_r,low_s_r,low_v_r), Scalar(high_h_r,high_s_r,high_v_r)};
+  ColorRange red2 = {LABEL_RED, Scalar(low_h2_r,low_s_r,low_v_r), Scalar(high_h2_r,high_s_r,high_v_r)};
+  ColorRange green = {LABEL_GREEN, Scalar(low_h_g,low_s_g,low_v_g), Scalar(high_h_g,high_s_g,high_v_g)};
+  ColorRange blue = {LABEL_BLUE, Scalar(low_h_b,low_s_b,low_v_b), Scalar(high_h_b,high_s_b,high_v_b)};
+  vector<ColorRange> ranges;
+  ranges.push_back(red1);
+  ranges.push_back(red2);
+  ranges.push_back(green);
+  ranges.push_back(blue);
+  return ranges;
+}
+
 void ball_detect() {
 
   Mat intrinsic = Mat(3, 3, CV_32F, intrinsic_data);
@@ -847,10 +846,8 @@ void ball_detect() {
   cv::resize(buffer, calibrated_frame_size ,cv::Size(1280,720));
   undistort(calibrated_frame_size, calibrated_frame, intrinsic, distCoeffs);
   //cv::resize(calibrated_frame_size, calibrated_frame, cv::Size(1280, 720));
-  Mat hsv_frame;
+  Mat label_masks[LABEL_COUNT];
   Mat hsv_frame_red;
-  Mat hsv_frame_red1;
-  Mat hsv_frame_red2;
   Mat hsv_frame_blue;
   Mat hsv_frame_green;
 
@@ -858,12 +855,12 @@ void ball_detect() {
   result_fake=calibrated_frame.clone();
 
 
-  cvtColor(calibrated_frame, hsv_frame, cv::COLOR_BGR2HSV);
-  inRange(hsv_frame, Scalar(low_h_r,low_s_r,low_v_r), Scalar(high_h_r,high_s_r,high_v_r), hsv_frame_red1);
-  inRange(hsv_frame, Scalar(low_h2_r,low_s_r,low_v_r), Scalar(high_h2_r,high_s_r,high_v_r), hsv_frame_red2);
-  inRange(hsv_frame, Scalar(low_h_b,low_s_b,low_v_b), Scalar(high_h_b,high_s_b,high_v_b), hsv_frame_blue);
-  inRange(hsv_frame, Scalar(low_h_g,low_s_g,low_v_g), Scalar(high_h_g,high_s_g,high_v_g), hsv_frame_green);
-  addWeighted(hsv_frame_red1, 1.0, hsv_frame_red2, 1.0, 0.0, hsv_frame_red);
+  // one pass over the frame gives all three color masks; the table follows the trackbars
+  color_classifier.update(color_ranges());
+  color_classifier.classify(calibrated_frame, label_masks);
+  hsv_frame_red = label_masks[0];
+  hsv_frame_green = label_masks[1];
+  hsv_frame_blue = label_masks[2];
   Mat erodeElement = getStructuringElement( MORPH_RECT,Size(5,5));
 
   Mat hsv_frame_red_1, hsv_frame_red_2, hsv_frame_blue_1, hsv_frame_blue_2, hsv_frame_green_1, hsv_frame_green_2;
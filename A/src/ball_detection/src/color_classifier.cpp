@@ -0,0 +1,101 @@
+#include "color_classifier.h"
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+using namespace std;
+using namespace cv;
+
+// 6 bits per channel: 256 KB table, small enough to stay in cache.
+// Each cell is classified at its center, so a pixel is at most 2 levels off in B, G and R.
+// V stays within those 2 levels, but H and S do not: on dark or low-chroma pixels a 2 level
+// step can swing the hue (and on dark ones the saturation) a long way, so such cells may land
+// on the other side of a bound from what cvtColor gives the pixel itself.
+#define LUT_BITS 6
+#define LUT_SHIFT (8-LUT_BITS)
+#define LUT_SIZE (1<<(3*LUT_BITS))
+
+static inline int lut_index(const uchar* bgr)
+{
+  return ((bgr[0]>>LUT_SHIFT)<<(2*LUT_BITS)) | ((bgr[1]>>LUT_SHIFT)<<LUT_BITS) | (bgr[2]>>LUT_SHIFT);
+}
+
+ColorClassifier::ColorClassifier()
+  : lut_(LUT_SIZE, 0)
+{
+}
+
+void ColorClassifier::update(const vector<ColorRange>& ranges)
+{
+  bool same = ranges.size() == ranges_.size();
+  for (size_t i=0; same && i<ranges.size(); i++)
+  {
+    same = ranges[i].label == ranges_[i].label && ranges[i].low == ranges_[i].low && ranges[i].high == ranges_[i].high;
+  }
+  if (same) return;
+
+  ranges_ = ranges;
+  build();
+}
+
+void ColorClassifier::build()
+{
+  // every cell center as one BGR row, converted with the same cvtColor the detector used
+  Mat cells(1, LUT_SIZE, CV_8UC3);
+  uchar* p = cells.ptr<uchar>(0);
+  const int half = (1<<LUT_SHIFT)/2;
+  for (int i=0; i<LUT_SIZE; i++, p+=3)
+  {
+    p[0] = ((i>>(2*LUT_BITS))<<LUT_SHIFT) + half;
+    p[1] = (((i>>LUT_BITS)&((1<<LUT_BITS)-1))<<LUT_SHIFT) + half;
+    p[2] = ((i&((1<<LUT_BITS)-1))<<LUT_SHIFT) + half;
+  }
+  Mat cells_hsv;
+  cvtColor(cells, cells_hsv, COLOR_BGR2HSV);
+
+  fill(lut_.begin(), lut_.end(), 0);
+  Mat in_range;
+  for (size_t k=0; k<ranges_.size(); k++)
+  {
+    inRange(cells_hsv, ranges_[k].low, ranges_[k].high, in_range);
+    const uchar* m = in_range.ptr<uchar>(0);
+    for (int i=0; i<LUT_SIZE; i++)
+    {
+      if (m[i]) lut_[i] |= ranges_[k].label;
+    }
+  }
+}
+
+void ColorClassifier::classify(const Mat& bgr, Mat* masks, Mat* labels) const
+{
+  CV_Assert(bgr.type() == CV_8UC3);
+  if (labels) labels->create(bgr.size(), CV_8U);
+  if (masks)
+  {
+    for (int k=0; k<LABEL_COUNT; k++) masks[k].create(bgr.size(), CV_8U);
+  }
+
+  const uchar* lut = &lut_[0];
+  for (int y=0; y<bgr.rows; y++)
+  {
+    const uchar* src = bgr.ptr<uchar>(y);
+    uchar* dst = labels ? labels->ptr<uchar>(y) : 0;
+    if (masks)
+    {
+      uchar* m0 = masks[0].ptr<uchar>(y);
+      uchar* m1 = masks[1].ptr<uchar>(y);
+      uchar* m2 = masks[2].ptr<uchar>(y);
+      for (int x=0; x<bgr.cols; x++, src+=3)
+      {
+        uchar label = lut[lut_index(src)];
+        if (dst) dst[x] = label;
+        m0[x] = (uchar)-(label&1);
+        m1[x] = (uchar)-((label>>1)&1);
+        m2[x] = (uchar)-((label>>2)&1);
+      }
+    }
+    else if (dst)
+    {
+      for (int x=0; x<bgr.cols; x++, src+=3) dst[x] = lut[lut_index(src)];
+    }
+  }
+}
@@ -0,0 +1,44 @@
+#ifndef COLOR_CLASSIFIER_H
+#define COLOR_CLASSIFIER_H
+
+#include <opencv2/core/core.hpp>
+#include <vector>
+
+// Class bits of the packed label image
+#define LABEL_RED   0x01
+#define LABEL_GREEN 0x02
+#define LABEL_BLUE  0x04
+#define LABEL_COUNT 3
+
+// One HSV box (same meaning as the inRange bounds) and the label bit it sets.
+// Red uses two boxes with the same bit for the hue wrap.
+struct ColorRange
+{
+  int label;
+  cv::Scalar low;
+  cv::Scalar high;
+};
+
+// BGR -> packed class label in one sweep over the frame.
+// The HSV boxes are baked into a 3D lookup table over quantized BGR, so the
+// per-pixel work is one table load; the table is rebuilt only when the boxes change.
+class ColorClassifier
+{
+public:
+  ColorClassifier();
+
+  // Rebuilds the table if ranges differ from the current ones
+  void update(const std::vector<ColorRange>& ranges);
+
+  // masks (LABEL_COUNT entries): CV_8U 0/255 per label bit.
+  // labels (optional): CV_8U packed LABEL_* bits, only written when requested.
+  void classify(const cv::Mat& bgr, cv::Mat* masks, cv::Mat* labels = 0) const;
+
+private:
+  void build();
+
+  std::vector<ColorRange> ranges_;
+  std::vector<uchar> lut_;
+};
+
+#endif
@@ -0,0 +1,80 @@
+#include "depth_sampler.h"
+
+#include <algorithm>
+#include <math.h>
+#include <vector>
+
+using namespace std;
+using namespace cv;
+
+static vector<Mat> disk_cache;
+static vector<float> depth_samples;
+
+const Mat& disk_mask(int r)
+{
+  if (r < 0) r = 0;
+  if (r >= (int)disk_cache.size()) disk_cache.resize(r+1);
+  Mat& disk = disk_cache[r];
+  if (disk.empty())
+  {
+    disk = Mat::zeros(2*r+1, 2*r+1, CV_8U);
+    for (int dy=-r; dy<=r; dy++)
+    {
+      uchar* row = disk.ptr<uchar>(dy+r);
+      for (int dx=-r; dx<=r; dx++)
+      {
+        if (dx*dx+dy*dy <= r*r) row[dx+r] = 255;
+      }
+    }
+  }
+  return disk;
+}
+
+DepthStats sample_circle_depth(const Mat& dep_img, const Mat& color_mask, float x, float y, int r)
+{
+  DepthStats stats = {0, 0, 0, 0};
+  if (dep_img.empty()) return stats;
+  if (r < 0) r = 0;
+  const Mat& disk = disk_mask(r);
+
+  // bounding box of the disk, clipped to the image
+  int cx = cvRound(x);
+  int cy = cvRound(y);
+  int x_0 = max(cx-r, 0);
+  int y_0 = max(cy-r, 0);
+  int x_1 = min(cx+r, dep_img.cols-1);
+  int y_1 = min(cy+r, dep_img.rows-1);
+  if (x_0 > x_1 || y_0 > y_1) return stats;
+
+  bool use_color = !color_mask.empty();
+  int covered = 0;
+  double sum = 0;
+  depth_samples.clear();
+  for (int v=y_0; v<=y_1; v++)
+  {
+    const float* dep_row = dep_img.ptr<float>(v);
+    const uchar* disk_row = disk.ptr<uchar>(v-cy+r);
+    const uchar* color_row = use_color ? color_mask.ptr<uchar>(v) : 0;
+    for (int u=x_0; u<=x_1; u++)
+    {
+      if (!disk_row[u-cx+r]) continue;
+      if (use_color && !color_row[u]) continue;
+      covered++;
+      float d = dep_row[u];
+      if (!(d > 0)) continue;  // also rejects nan
+      sum += d;
+      depth_samples.push_back(d);
+    }
+  }
+
+  stats.samples = depth_samples.size();
+  if (covered > 0) stats.inlier_ratio = (float)stats.samples/covered;
+  if (stats.samples > 0)
+  {
+    stats.mean = sum/stats.samples;
+    vector<float>::iterator mid = depth_samples.begin()+stats.samples/2;
+    nth_element(depth_samples.begin(), mid, depth_samples.end());
+    stats.median = *mid;
+  }
+  return stats;
+}
@@ -0,0 +1,25 @@
+#ifndef DEPTH_SAMPLER_H
+#define DEPTH_SAMPLER_H
+
+#include <opencv2/core/core.hpp>
+
+// Depth statistics of the pixels covered by one ball candidate.
+// Invalid depth (0 or nan from the realsense) is not a sample.
+struct DepthStats
+{
+  float mean;          // mean of the valid depths [m], 0 if there are none
+  float median;        // median of the valid depths [m], 0 if there are none
+  float inlier_ratio;  // valid depths / pixels under the disk
+  int samples;         // number of valid depths
+};
+
+// Filled disk of radius r, (2r+1)x(2r+1) CV_8U, built once per radius and cached.
+const cv::Mat& disk_mask(int r);
+
+// Statistics of dep_img (CV_32F, meters) under the disk (x, y, r).
+// If color_mask (CV_8U, same size) is not empty only its nonzero pixels count.
+// Only the bounding box of the disk is visited, in a single pass, and no image
+// sized buffer is allocated.
+DepthStats sample_circle_depth(const cv::Mat& dep_img, const cv::Mat& color_mask, float x, float y, int r);
+
+#endif
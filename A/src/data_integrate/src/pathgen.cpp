@@ -2,6 +2,9 @@
 #include <ctime>
 #include <math.h>
 #include <string.h>
+#include <vector>
+
+#include "route_planner.h"
 
 #define PI 3.14159265
 
@@ -10,8 +13,6 @@ using namespace std;
 int carx = 30, cary = 40;  // car size
 int saferange = 100;
 
-double tcost[6] = {0, };
-
 double t_max = 100000;
 double straight = 20;   // cm/s
 double rotate = 10;     // degree/s
@@ -33,6 +34,9 @@ double angle5 = 0; //base to goal;
 
 double prep = 0;
 
+RoutePlanner planner;
+vector<RoutePoint> targets, obstacles;
+
 double pdis(double x1, double y1, double x2, double y2)
 {
 	return sqrt(pow((x1-x2),2)+pow((y1-y2),2));
@@ -43,32 +47,6 @@ double inner(double x1, double y1, double x2, double y2)
 	return x1*x2 + y1*y2;
 }
 
-double mindis(double xa, double ya, double xb, double yb, double xp, double yp)
-{
-	double xap = xp-xa;  double yap = yp-ya;
-	double xab = xb-xa;  double yab = yb-ya;
-	double dap = pdis(0, 0, xap, yap); double dab = pdis(0, 0, xab, yab);
-	double cos = inner(xap, yap, xab, yab)/dap/dab;
-
-	if(cos<0) return dap;
-	else if(cos*dap>dab) return pdis(xp, yp, xb, yb);
-	else return sqrt(1-pow(cos, 2))*dap;
-}
-
-bool b_ball_in_path(int b1, int b2, int b3)
-{
-	double dis = mindis(base_x, base_y, b_ball_x[b1], b_ball_y[b1], b_ball_x[b2], b_ball_x[b2]);
-	if(dis < saferange) { return true; }
-
-	dis = mindis(base_x, base_y, b_ball_x[b1], b_ball_y[b1], b_ball_x[b3], b_ball_x[b3]);
-	if(dis < saferange) { return true; }
-
-	dis = mindis(b_ball_x[b1], b_ball_y[b1], b_ball_x[b2], b_ball_x[b2], b_ball_x[b3], b_ball_x[b3]);
-	if(dis < saferange) { return true; }
-
-	return false;
-}
-
 double angle(double x1, double y1, double x2, double y2, double x3, double y3)
 {
 	double in = inner(x2-x1, y2-y1, x3-x2, y3-y2);
@@ -78,110 +56,28 @@ double angle(double x1, double y1, double x2, double y2, double x3, double y3)
 	return theta;
 }
 
-double pathgen(int b1, int b2, int b3)
+// Visiting order of the blue balls from the base and back, around the red ones.
+double route_plan(vector<int>& order)
 {
-	//cout << "pathgen_start" << endl;
-	double t = 0;
-
-	// if(b_ball_in_path(b1, b2, b3))
-	// {	t = t_max;
-	// 	return t;	}
-
-	t+=pdis(base_x, base_y, b_ball_x[b1], b_ball_y[b1])/straight;
-	t+=angle(base_x, base_y-10, base_x, base_y, b_ball_x[b1], b_ball_y[b1])/rotate;
-	for(int i=0; i<3; i++)
-	{
-		double dis = mindis(base_x, base_y, b_ball_x[b1], b_ball_y[b1], r_ball_x[i], r_ball_y[i]);
-		if(dis<saferange)
-		{
-			double diff = saferange-dis;
-			t+=diff*2*sqrt(2)/diagonal;
-			t-=diff*2/straight;
-			t+=stood*2;
-			t+=dtod;
-		}
-	}
-
-	t+=pdis(b_ball_x[b1], b_ball_y[b1], b_ball_x[b2], b_ball_y[b2])/straight;
-	t+=angle(base_x, base_y, b_ball_x[b1], b_ball_y[b1], b_ball_x[b2], b_ball_y[b2])/rotate;
-	for(int i=0; i<3; i++)
-	{
-		double dis = mindis(b_ball_x[b1], b_ball_y[b1], b_ball_x[b2], b_ball_y[b2], r_ball_x[i], r_ball_y[i]);
-		if(dis<saferange)
-		{
-			double diff = saferange-dis;
-			t+=diff*2*sqrt(2)/diagonal;
-			t-=diff*2/straight;
-			t+=stood*2;
-			t+=dtod;
-		}
-	}
-
-	t+=pdis(b_ball_x[b2], b_ball_y[b2], b_ball_x[b3], b_ball_y[b3])/straight;
-	t+=angle(b_ball_x[b1], b_ball_y[b1], b_ball_x[b2], b_ball_y[b2], b_ball_x[b3], b_ball_y[b3])/rotate;
-	for(int i=0; i<3; i++)
-	{
-		double dis = mindis(b_ball_x[b2], b_ball_y[b2], b_ball_x[b3], b_ball_y[b3], r_ball_x[i], r_ball_y[i]);
-		if(dis<saferange)
-		{
-			double diff = saferange-dis;
-			t+=diff*2*sqrt(2)/diagonal;
-			t-=diff*2/straight;
-			t+=stood*2;
-			t+=dtod;
-		}
-	}
-
-	t+=pdis(b_ball_x[b3], b_ball_y[b3], base_x, base_y+prep)/straight;
-	t+=angle(b_ball_x[b2], b_ball_y[b2], b_ball_x[b3], b_ball_y[b3], base_x, base_y+prep)/rotate;
-	for(int i=0; i<3; i++)
-	{
-		double dis = mindis(b_ball_x[b3], b_ball_y[b3], base_x, base_y+prep, r_ball_x[i], r_ball_y[i]);
-		if(dis<saferange)
-		{
-			double diff = saferange-dis;
-			t+=diff*2*sqrt(2)/diagonal;
-			t-=diff*2/straight;
-			t+=stood*2;
-			t+=dtod;
-		}
-	}
-
-	t+=angle(b_ball_x[b3], b_ball_y[b3], base_x, base_y+prep, base_x, base_y-10)/rotate;
-
-	return t;
-
-}
-
-int tcal()
-{
-	tcost[0] = pathgen(0, 1, 2);
-	tcost[1] = pathgen(0, 2, 1);
-	tcost[2] = pathgen(1, 0, 2);
-	tcost[3] = pathgen(1, 2, 0);
-	tcost[4] = pathgen(2, 0, 1);
-	tcost[5] = pathgen(2, 1, 0);
-
-  cout << endl;
-	cout << "tcost per path" << endl;
-	cout << "0, 1, 2 : t = "<< tcost[0] << endl;
-	cout << "0, 2, 1 : t = "<< tcost[1] << endl;
-	cout << "1, 0, 2 : t = "<< tcost[2] << endl;
-	cout << "1, 2, 0 : t = "<< tcost[3] << endl;
-	cout << "2, 0, 1 : t = "<< tcost[4] << endl;
-	cout << "2, 1, 0 : t = "<< tcost[5] << endl;
-
-	double tmin = tcost[0];
-	int imin = 0;
-	for(int i=1; i<6; i++)
-	{
-		if(tcost[i]<tmin)
-		{
-			imin = i;
-			tmin = tcost[i];
-		}
-	}
-	return imin;
+	RouteCost cost;
+	cost.straight = straight;
+	cost.rotate = rotate;
+	cost.diagonal = diagonal;
+	cost.stood = stood;
+	cost.dtod = dtod;
+	cost.saferange = saferange;
+	// this tool never had the ball-in-path check on (it was commented out of pathgen()), keep it off
+	cost.t_max = 0;
+	planner.setCost(cost);
+
+	targets.resize(size_b);
+	for(int i=0; i<size_b; i++) { targets[i].x = b_ball_x[i]; targets[i].y = b_ball_y[i]; }
+	obstacles.resize(size_r);
+	for(int i=0; i<size_r; i++) { obstacles[i].x = r_ball_x[i]; obstacles[i].y = r_ball_y[i]; }
+
+	RoutePoint base = {base_x, base_y};
+	RoutePoint goal = {base_x, base_y+prep};
+	return planner.plan(base, M_PI/2, targets, obstacles, goal, -M_PI/2, order);
 }
 
 int main(int argc, char** argv) {
@@ -202,32 +98,12 @@ int main(int argc, char** argv) {
 	cout << "red  2 = ( "<< r_ball_x[2] << ", " << r_ball_y[2] << " )" <<endl;
 
 
-	int path = tcal();
+	vector<int> order;
+	double t = route_plan(order);
 	cout << endl;
-	cout << "best path" << endl;
-
-	int b1, b2, b3;
-	switch(path)
-	{
-		case 0:
-			b1 = 0; b2 = 1; b3 = 2;
-			break;
-		case 1:
-			b1 = 0; b2 = 2; b3 = 1;
-			break;
-		case 2:
-			b1 = 1; b2 = 0; b3 = 2;
-			break;
-		case 3:
-			b1 = 1; b2 = 2; b3 = 0;
-			break;
-		case 4:
-			b1 = 2; b2 = 0; b3 = 1;
-			break;
-		case 5:
-			b1 = 2; b2 = 1; b3 = 0;
-			break;
-	}
+	cout << "best path, t = " << t << endl;
+
+	int b1 = order[0], b2 = order[1], b3 = order[2];
 	cout << b1 << "("<< b_ball_x[b1] << ", " << b_ball_y[b1] << ") => " ;
 	cout << b2 << "("<< b_ball_x[b2] << ", " << b_ball_y[b2] << ") => " ;
 	cout << b3 << "("<< b_ball_x[b3] << ", " << b_ball_y[b3] << ")" << endl;
@@ -0,0 +1,296 @@
+#include "route_planner.h"
+
+#include <algorithm>
+
+using namespace std;
+
+// distance [cm] of p from segment a-b
+static double segment_distance(const RoutePoint& a, const RoutePoint& b, const RoutePoint& p)
+{
+  double abx = b.x-a.x, aby = b.y-a.y;
+  double apx = p.x-a.x, apy = p.y-a.y;
+  double len2 = abx*abx + aby*aby;
+  double t = (len2 > 0) ? (apx*abx + apy*aby)/len2 : 0;
+  t = min(max(t, 0.0), 1.0);
+  double ex = apx - t*abx, ey = apy - t*aby;
+  return sqrt(ex*ex + ey*ey);
+}
+
+// |a - b| wrapped into [0, 180] degrees
+static double turn_degree(double a, double b)
+{
+  double d = fabs(remainder(b - a, 2*M_PI));
+  return d*180/M_PI;
+}
+
+RoutePlanner::RoutePlanner(const RouteCost& cost)
+  : cost_(cost), exact_limit_(10), max_passes_(50), n_(0), nodes_(2),
+    start_heading_(0), goal_heading_(NAN)
+{
+}
+
+void RoutePlanner::setExactLimit(int n)
+{
+  exact_limit_ = max(0, min(n, (int)EXACT_LIMIT_MAX));
+}
+
+double RoutePlanner::turn(int a, int b, int c) const
+{
+  double in = (b == n_) ? start_heading_ : heading_[a*nodes_ + b];
+  double out = heading_[b*nodes_ + c];
+  return turn_degree(in, out)/cost_.rotate;
+}
+
+void RoutePlanner::tabulate(const RoutePoint& start, double start_heading,
+                            const vector<RoutePoint>& targets,
+                            const vector<RoutePoint>& obstacles,
+                            const RoutePoint& goal, double goal_heading)
+{
+  n_ = (int)targets.size();
+  nodes_ = n_ + 2;
+  start_heading_ = start_heading;
+  goal_heading_ = goal_heading;
+
+  pos_.assign(targets.begin(), targets.end());
+  pos_.push_back(start);
+  pos_.push_back(goal);
+
+  heading_.assign(nodes_*nodes_, 0);
+  leg_.assign(nodes_*nodes_, 0);
+  clear_.assign(nodes_*nodes_, INFINITY);
+  covers_.assign(nodes_*nodes_, 0);
+
+  // side-step around an obstacle d [cm] from the leg, as in pathgen
+  const double sidestep = 2*sqrt(2)/cost_.diagonal - 2/cost_.straight;
+  const int tracked = min(n_, 32);
+
+  for (int a = 0; a < nodes_; a++)
+  {
+    for (int b = a+1; b < nodes_; b++)
+    {
+      const RoutePoint& pa = pos_[a];
+      const RoutePoint& pb = pos_[b];
+      double dx = pb.x-pa.x, dy = pb.y-pa.y;
+
+      double t = sqrt(dx*dx + dy*dy)/cost_.straight;
+      double clear = INFINITY;
+      for (size_t m = 0; m < obstacles.size(); m++)
+      {
+        double d = segment_distance(pa, pb, obstacles[m]);
+        clear = min(clear, d);
+        if (d < cost_.saferange)
+        {
+          double diff = cost_.saferange - d;
+          t += diff*sidestep + cost_.stood*2 + cost_.dtod;
+        }
+      }
+
+      uint32_t covers = 0;
+      for (int k = 0; k < tracked; k++)
+      {
+        if (k == a || k == b) continue;
+        if (segment_distance(pa, pb, pos_[k]) < cost_.saferange) covers |= 1u << k;
+      }
+
+      // legs are symmetric except for their direction
+      heading_[a*nodes_ + b] = atan2(dy, dx);
+      heading_[b*nodes_ + a] = atan2(-dy, -dx);
+      leg_[a*nodes_ + b] = leg_[b*nodes_ + a] = t;
+      clear_[a*nodes_ + b] = clear_[b*nodes_ + a] = clear;
+      covers_[a*nodes_ + b] = covers_[b*nodes_ + a] = covers;
+    }
+  }
+}
+
+double RoutePlanner::routeTime(const vector<int>& order) const
+{
+  const int start = n_, goal = n_+1;
+  uint32_t waiting = (n_ >= 32) ? 0xFFFFFFFFu : ((1u << n_) - 1);
+
+  double t = 0;
+  int prev = -1, last = start;
+  for (size_t i = 0; i < order.size(); i++)
+  {
+    int k = order[i];
+    if (k < 32) waiting &= ~(1u << k);
+    t += turn(prev, last, k) + leg(last, k, waiting);
+    prev = last;
+    last = k;
+  }
+  t += turn(prev, last, goal) + leg(last, goal, 0);
+  if (!isnan(goal_heading_))
+    t += turn_degree(heading_[last*nodes_ + goal], goal_heading_)/cost_.rotate;
+  return t;
+}
+
+double RoutePlanner::exact(vector<int>& order)
+{
+  const int n = n_, start = n_, goal = n_+1;
+  const uint32_t all = (1u << n) - 1;
+  const size_t states = (size_t)(all+1)*n*(n+1);
+  best_.assign(states, INFINITY);
+  from_.assign(states, -1);
+
+  #define STATE(mask, last, prev) (((size_t)(mask)*n + (last))*(n+1) + (prev))
+
+  for (int j = 0; j < n; j++)
+    best_[STATE(1u << j, j, start)] = turn(-1, start, j) + leg(start, j, all & ~(1u << j));
+
+  for (uint32_t mask = 1; mask <= all; mask++)
+  {
+    for (int last = 0; last < n; last++)
+    {
+      if (!(mask & (1u << last))) continue;
+      for (int prev = 0; prev <= n; prev++)
+      {
+        double t = best_[STATE(mask, last, prev)];
+        if (isinf(t)) continue;
+        for (int k = 0; k < n; k++)
+        {
+          if (mask & (1u << k)) continue;
+          uint32_t next = mask | (1u << k);
+          double tk = t + turn(prev, last, k) + leg(last, k, all & ~next);
+          size_t s = STATE(next, k, last);
+          if (tk < best_[s])
+          {
+            best_[s] = tk;
+            from_[s] = (int8_t)prev;
+          }
+        }
+      }
+    }
+  }
+
+  double t_best = INFINITY;
+  int last_best = -1, prev_best = -1;
+  for (int last = 0; last < n; last++)
+  {
+    for (int prev = 0; prev <= n; prev++)
+    {
+      double t = best_[STATE(all, last, prev)];
+      if (isinf(t)) continue;
+      t += turn(prev, last, goal) + leg(last, goal, 0);
+      if (!isnan(goal_heading_))
+        t += turn_degree(heading_[last*nodes_ + goal], goal_heading_)/cost_.rotate;
+      if (t < t_best)
+      {
+        t_best = t;
+        last_best = last;
+        prev_best = prev;
+      }
+    }
+  }
+
+  order.resize(n);
+  uint32_t mask = all;
+  int last = last_best, prev = prev_best;
+  for (int i = n-1; i >= 0; i--)
+  {
+    order[i] = last;
+    int before = from_[STATE(mask, last, prev)];
+    mask &= ~(1u << last);
+    last = prev;
+    prev = before;
+  }
+
+  #undef STATE
+  return t_best;
+}
+
+double RoutePlanner::twoOpt(vector<int>& order)
+{
+  const int n = n_, start = n_;
+  const uint32_t all = (n >= 32) ? 0xFFFFFFFFu : ((1u << n) - 1);
+
+  // nearest neighbour by leg and turn time
+  order.clear();
+  used_.assign(n, 0);
+  uint32_t waiting = all;
+  int prev = -1, last = start;
+  for (int i = 0; i < n; i++)
+  {
+    int pick = -1;
+    double t_pick = INFINITY;
+    for (int k = 0; k < n; k++)
+    {
+      if (used_[k]) continue;
+      uint32_t w = (k < 32) ? (waiting & ~(1u << k)) : waiting;
+      double t = turn(prev, last, k) + leg(last, k, w);
+      if (t < t_pick)
+      {
+        t_pick = t;
+        pick = k;
+      }
+    }
+    used_[pick] = 1;
+    if (pick < 32) waiting &= ~(1u << pick);
+    order.push_back(pick);
+    prev = last;
+    last = pick;
+  }
+
+  // reverse order[i..j], or move order[i] to j, while that shortens the route;
+  // turns make the time depend on the whole sequence, so each candidate is timed in full
+  double t_best = routeTime(order);
+  for (int pass = 0; pass < max_passes_; pass++)
+  {
+    bool improved = false;
+    for (int i = 0; i < n-1; i++)
+    {
+      for (int j = i+1; j < n; j++)
+      {
+        reverse(order.begin()+i, order.begin()+j+1);
+        double t = routeTime(order);
+        if (t < t_best - 1e-9)
+        {
+          t_best = t;
+          improved = true;
+        }
+        else
+        {
+          reverse(order.begin()+i, order.begin()+j+1);
+        }
+      }
+    }
+    for (int i = 0; i < n; i++)
+    {
+      for (int j = 0; j < n; j++)
+      {
+        if (i == j) continue;
+        int k = order[i];
+        order.erase(order.begin()+i);
+        order.insert(order.begin()+j, k);
+        double t = routeTime(order);
+        if (t < t_best - 1e-9)
+        {
+          t_best = t;
+          improved = true;
+        }
+        else
+        {
+          order.erase(order.begin()+j);
+          order.insert(order.begin()+i, k);
+        }
+      }
+    }
+    if (!improved) break;
+  }
+  return t_best;
+}
+
+double RoutePlanner::plan(const RoutePoint& start, double start_heading,
+                          const vector<RoutePoint>& targets,
+                          const vector<RoutePoint>& obstacles,
+                          const RoutePoint& goal, double goal_heading,
+                          vector<int>& order)
+{
+  tabulate(start, start_heading, targets, obstacles, goal, goal_heading);
+
+  if (n_ == 0)
+  {
+    order.clear();
+    return routeTime(order);
+  }
+  if (n_ <= exact_limit_) return exact(order);
+  return twoOpt(order);
+}
@@ -0,0 +1,106 @@
+#ifndef ROUTE_PLANNER_H
+#define ROUTE_PLANNER_H
+
+#include <math.h>
+#include <stdint.h>
+#include <vector>
+
+// Time model of one route, same units as pathgen : cm, cm/s, degree/s, s.
+struct RouteCost
+{
+  double straight;    // translation speed [cm/s]
+  double rotate;      // rotation speed [degree/s]
+  double diagonal;    // speed while side-stepping an obstacle [cm/s]
+  double stood;       // stop before and after a side-step [s]
+  double dtod;        // extra time per side-step [s]
+  double saferange;   // clearance an obstacle or a waiting target needs [cm]
+  double t_max;       // penalty of a leg that runs over a target not picked up yet [s]
+
+  RouteCost()
+    : straight(20), rotate(10), diagonal(10), stood(1), dtod(3), saferange(30), t_max(100000) {}
+};
+
+struct RoutePoint
+{
+  double x, y;  // [cm]
+};
+
+// Order in which to visit N targets, starting at start and ending at goal,
+// avoiding M obstacles. A route's time is
+//   sum of legs : length/straight + side-step time around every obstacle closer than saferange
+//               + t_max if the leg passes a target that is still waiting
+//   sum of turns : |heading change|/rotate at the start, at every target and at the goal.
+// Leg times, obstacle clearances and the targets each leg covers are tabulated
+// once per plan(). The order is exact (dynamic programming over visited subsets)
+// up to exact_limit targets; beyond that a nearest-neighbour route is improved
+// with 2-opt reversals and single-target moves. Buffers are kept between calls,
+// so replanning from the control loop does not allocate once they are sized.
+class RoutePlanner
+{
+public:
+  enum { EXACT_LIMIT_MAX = 12 };
+
+  explicit RoutePlanner(const RouteCost& cost = RouteCost());
+
+  void setCost(const RouteCost& cost) { cost_ = cost; }
+  const RouteCost& cost() const { return cost_; }
+
+  // Routes with more targets are solved heuristically. At most EXACT_LIMIT_MAX.
+  void setExactLimit(int n);
+  // the heuristic stops after this many improving passes
+  void setMaxPasses(int n) { max_passes_ = n; }
+
+  // start_heading and goal_heading in radians from +x; a NAN goal_heading
+  // means the final orientation does not matter.
+  // Writes the visiting order (indices into targets) to order, returns its time [s].
+  double plan(const RoutePoint& start, double start_heading,
+              const std::vector<RoutePoint>& targets,
+              const std::vector<RoutePoint>& obstacles,
+              const RoutePoint& goal, double goal_heading,
+              std::vector<int>& order);
+
+  // time [s] of a given order against the tables of the last plan()
+  double routeTime(const std::vector<int>& order) const;
+
+  // smallest obstacle clearance [cm] along leg a -> b of the last plan();
+  // nodes are 0..N-1 targets, N start, N+1 goal
+  double clearance(int a, int b) const { return clear_[a*nodes_ + b]; }
+
+private:
+  void tabulate(const RoutePoint& start, double start_heading,
+                const std::vector<RoutePoint>& targets,
+                const std::vector<RoutePoint>& obstacles,
+                const RoutePoint& goal, double goal_heading);
+  double exact(std::vector<int>& order);
+  double twoOpt(std::vector<int>& order);
+
+  double leg(int a, int b, uint32_t waiting) const
+  {
+    double t = leg_[a*nodes_ + b];
+    if (covers_[a*nodes_ + b] & waiting) t += cost_.t_max;
+    return t;
+  }
+  // turn at b when arriving from a and leaving to c
+  double turn(int a, int b, int c) const;
+
+  RouteCost cost_;
+  int exact_limit_;
+  int max_passes_;
+
+  int n_;        // targets
+  int nodes_;    // targets + start + goal
+  std::vector<RoutePoint> pos_;
+  std::vector<double> heading_;   // [a*nodes_ + b] direction of leg a -> b [rad]
+  std::vector<double> leg_;       // [a*nodes_ + b] translation and side-step time [s]
+  std::vector<double> clear_;     // [a*nodes_ + b] obstacle clearance [cm]
+  std::vector<uint32_t> covers_;  // [a*nodes_ + b] targets within saferange of the leg (first 32)
+  double start_heading_, goal_heading_;
+
+  // exact() tables, [(mask*n_ + last)*(n_+1) + prev], prev == n_ is the start
+  std::vector<double> best_;
+  std::vector<int8_t> from_;
+  // twoOpt() scratch, targets already in the greedy order
+  std::vector<char> used_;
+};
+
+#endif
@@ -4,6 +4,7 @@
 #include <cv_bridge/cv_bridge.h>
 #include "core_msgs/ball_pos.h"
 #include "opencv2/opencv.hpp"
+#include "camera_model.h"
 #include <visualization_msgs/Marker.h>
 #include <std_msgs/ColorRGBA.h>
 
@@ -84,7 +85,7 @@ int high_h_g_2=80, high_s_g_2=255, high_v_g_2=255;
 string intToString(int n);
 string floatToString(float f);
 // Declaration of functions that changes int data to String
-void morphOps(Mat &thresh);
+void morphOps(Mat &thresh, double scale);
 // Declaration of functions that calculates the ball position from pixel position
 vector<float> pixel2point_1(Point center_1, int radius_1);//change
 vector<float> pixel2point_2(Point center_2, int radius_2);//change
@@ -113,6 +114,13 @@ float distortion_data_2[5] = {0.0038749795465425926, -0.08779331036450917, -0.00
 // Initialization of variable for Camera Matrix
 float Rotation_matrix_data[9] = {0.9998371379964848, -0.008370031412091706, 0.01598874782961575, 0.008288266440529145, 0.9999522694312795, 0.0051733450150507326, -0.016031285737870264, -0.005039983471654451, 0.9998587882517193};
 float Transfer_matrix_data[3] = {-0.18184857994284165, 0.0011076329446815109, -0.0052189264432324885};
+// built once; ball_detect() only reads them
+CameraModel camera_1(intrinsic_data_1, distortion_data_1);
+CameraModel camera_2(intrinsic_data_2, distortion_data_2);
+Mat Rotation_matrix = Mat(3, 3, CV_32F, Rotation_matrix_data);
+Mat Transfer_matrix = Mat(3, 1, CV_32F, Transfer_matrix_data);
+Mat Camera_2_center = Mat::zeros(3,1, CV_32F);
+Mat Camera_1_center = Mat(3,1, CV_32F, Transfer_matrix_data);
 // Initialization of variable for text drawing
 double fontScale = 2;
 int thickness = 3;
@@ -132,12 +140,14 @@ ostringstream buffer;
 buffer << f;
 return buffer.str();
 }
-void morphOps(Mat &thresh){
+void morphOps(Mat &thresh, double scale){
 //create structuring element that will be used to "dilate" and "erode" image.
-//the element chosen here is a 3px by 3px rectangle
-Mat erodeElement = getStructuringElement( MORPH_RECT,Size(3,3));
+//the element chosen here is a 3px by 3px rectangle at 640x480, scaled with the image
+int erodeSize = max(1, (int)(3*scale + 0.5));
+Mat erodeElement = getStructuringElement( MORPH_RECT,Size(erodeSize,erodeSize));
 //dilate with larger element so make sure object is nicely visible
-Mat dilateElement = getStructuringElement( MORPH_RECT,Size(8,8));
+int dilateSize = max(1, (int)(8*scale + 0.5));
+Mat dilateElement = getStructuringElement( MORPH_RECT,Size(dilateSize,dilateSize));
 erode(thresh,thresh,erodeElement);
 erode(thresh,thresh,erodeElement);
 dilate(thresh,thresh,dilateElement);
@@ -366,13 +376,6 @@ void ball_detect(){
      result_1, result_2, stereo_1, stereo_2;
      Mat calibrated_frame_1;
      Mat calibrated_frame_2;
-     Mat intrinsic_1 = Mat(3,3, CV_32FC1);//change
-     Mat intrinsic_2 = Mat(3,3, CV_32FC1);//change
-     Mat distCoeffs_1, distCoeffs_2;
-     intrinsic_1 = Mat(3, 3, CV_32F, intrinsic_data_1);//change
-     intrinsic_2 = Mat(3, 3, CV_32F, intrinsic_data_2);//change
-     distCoeffs_1 = Mat(1, 5, CV_32F, distortion_data_1);
-     distCoeffs_2 = Mat(1, 5, CV_32F, distortion_data_2);
      vector<Vec4i> hierarchy_r_1;
      vector<Vec4i> hierarchy_r_2;
      vector<Vec4i> hierarchy_b_1;
@@ -386,36 +389,30 @@ void ball_detect(){
      vector<vector<Point> > contours_b_2;
      vector<vector<Point> > contours_g_2;
 
-Mat Rotation_matrix = Mat(3,3, CV_32FC1);
-Mat Transfer_matrix;
-Rotation_matrix = Mat(3, 3, CV_32F, Rotation_matrix_data);
-Transfer_matrix = Mat(3, 1, CV_32F, Transfer_matrix_data);
-Mat Camera_2_center = Mat::zeros(3,1, CV_32F);
-Mat Camera_1_center = Mat(3,1, CV_32F, Transfer_matrix_data);
-
-     if(buffer.size().width==640){ //if the size of the image is 320x240, then resized it to 640x480
-         cv::resize(buffer, frame, cv::Size(1280, 480));
-     }
-     else{
-         frame = buffer;
-     }
+     // the two cameras side by side, processed at the size they were sent (320x240 each when
+     // reduced) instead of upscaled; CameraModel scales the calibration to that size
+     frame = buffer;
 
-  frame_1=frame(Range(0,480), Range(0,640));
-  frame_2=frame(Range(0,480), Range(640,1280));
+  frame_1=frame(Range(0,frame.rows), Range(0,frame.cols/2));
+  frame_2=frame(Range(0,frame.rows), Range(frame.cols/2,frame.cols));
 
-  undistort(frame_1, calibrated_frame_1, intrinsic_1, distCoeffs_1);//change
+  camera_1.rectify(frame_1, calibrated_frame_1);
   result_1 = calibrated_frame_1.clone();
   stereo_1 = calibrated_frame_1.clone();
   medianBlur(calibrated_frame_1, calibrated_frame_1, 3);
   cvtColor(calibrated_frame_1, hsv_frame_1, cv::COLOR_BGR2HSV);
 
 
-  undistort(frame_2, calibrated_frame_2, intrinsic_2, distCoeffs_2);//change
+  camera_2.rectify(frame_2, calibrated_frame_2);
   result_2 = calibrated_frame_2.clone();
   stereo_2 = calibrated_frame_2.clone();
   medianBlur(calibrated_frame_2, calibrated_frame_2, 3);
   cvtColor(calibrated_frame_2, hsv_frame_2, cv::COLOR_BGR2HSV);
 
+  // the kernel sizes below were tuned on 640x480 frames
+  double scale = camera_1.scale();
+  int blur_size = (int)(9*scale + 0.5) | 1;  // GaussianBlur takes odd sizes only
+
   // Detect the object based on RGB and HSV Range Values
   inRange(hsv_frame_1,Scalar(low_h_r_1,low_s_r_1,low_v_r_1),Scalar(high_h_r_1,high_s_r_1,high_v_r_1),hsv_frame_1_red1);
   inRange(hsv_frame_1,Scalar(low_h2_r_1,low_s_r_1,low_v_r_1),Scalar(high_h2_r_1,high_s_r_1,high_v_r_1),hsv_frame_1_red2);
@@ -427,18 +424,18 @@ Mat Camera_1_center = Mat(3,1, CV_32F, Transfer_matrix_data);
   inRange(hsv_frame_2,Scalar(low_h_g_2,low_s_g_2,low_v_g_2),Scalar(high_h_g_2,high_s_g_2,high_v_g_2),hsv_frame_2_green);
   addWeighted(hsv_frame_1_red1, 1.0, hsv_frame_1_red2, 1.0, 0.0, hsv_frame_1_red);
   addWeighted(hsv_frame_2_red1, 1.0, hsv_frame_2_red2, 1.0, 0.0, hsv_frame_2_red);
-  morphOps(hsv_frame_1_red);
-  morphOps(hsv_frame_2_red);
-  morphOps(hsv_frame_1_blue);
-  morphOps(hsv_frame_1_green);
-  morphOps(hsv_frame_2_blue);
-  morphOps(hsv_frame_2_green);
+  morphOps(hsv_frame_1_red, scale);
+  morphOps(hsv_frame_2_red, scale);
+  morphOps(hsv_frame_1_blue, scale);
+  morphOps(hsv_frame_1_green, scale);
+  morphOps(hsv_frame_2_blue, scale);
+  morphOps(hsv_frame_2_green, scale);
 
   //Camera One
   //cout<<"Camera1_line_info"<<endl;
-  GaussianBlur(hsv_frame_1_red, hsv_frame_1_red_blur, cv::Size(9, 9), 2, 2);
-  GaussianBlur(hsv_frame_1_blue, hsv_frame_1_blue_blur, cv::Size(9, 9), 2, 2);
-  GaussianBlur(hsv_frame_1_green, hsv_frame_1_green_blur, cv::Size(9, 9), 2, 2);
+  GaussianBlur(hsv_frame_1_red, hsv_frame_1_red_blur, cv::Size(blur_size, blur_size), 2*scale, 2*scale);
+  GaussianBlur(hsv_frame_1_blue, hsv_frame_1_blue_blur, cv::Size(blur_size, blur_size), 2*scale, 2*scale);
+  GaussianBlur(hsv_frame_1_green, hsv_frame_1_green_blur, cv::Size(blur_size, blur_size), 2*scale, 2*scale);
   Canny(hsv_frame_1_red_blur, hsv_frame_1_red_canny, lowThreshold_r*ratio_r, kernel_size_r);
   Canny(hsv_frame_1_blue_blur, hsv_frame_1_blue_canny, lowThreshold_b*ratio_b, kernel_size_b);
   Canny(hsv_frame_1_green_blur, hsv_frame_1_green_canny, lowThreshold_g*ratio_g, kernel_size_g);
@@ -455,15 +452,15 @@ Mat Camera_1_center = Mat(3,1, CV_32F, Transfer_matrix_data);
   vector<float>radius_b_1( contours_b_1.size() );
   vector<float>radius_g_1( contours_g_1.size() );
   for( size_t i = 0; i < contours_r_1.size(); i++ ){
-  approxPolyDP( contours_r_1[i], contours_r_poly_1[i], 3, true );
+  approxPolyDP( contours_r_1[i], contours_r_poly_1[i], 3*scale, true );
   minEnclosingCircle( contours_r_poly_1[i], center_r_1[i], radius_r_1[i] );
   }
   for( size_t i = 0; i < contours_b_1.size(); i++ ){
-  approxPolyDP( contours_b_1[i], contours_b_poly_1[i], 3, true );
+  approxPolyDP( contours_b_1[i], contours_b_poly_1[i], 3*scale, true );
   minEnclosingCircle( contours_b_poly_1[i], center_b_1[i], radius_b_1[i] );
   }
   for( size_t i = 0; i < contours_g_1.size(); i++ ){
-  approxPolyDP( contours_g_1[i], contours_g_poly_1[i], 3, true );
+  approxPolyDP( contours_g_1[i], contours_g_poly_1[i], 3*scale, true );
   minEnclosingCircle( contours_g_poly_1[i], center_g_1[i], radius_g_1[i] );
   }
   Point2f one_1,two_1;
@@ -511,7 +508,7 @@ Mat Camera_1_center = Mat(3,1, CV_32F, Transfer_matrix_data);
   Scalar color = Scalar( 0, 0, 255);
   drawContours( hsv_frame_1_red_canny, contours_r_poly_1, (int)i, color, 1, 8, vector<Vec4i>(), 0, Point() );
   vector<float> ball_position_r_1;
-  ball_position_r_1 = pixel2point_1(center_r_1[i], radius_r_1[i]);
+  ball_position_r_1 = pixel2point_1(camera_1.toCalibration(center_r_1[i]), camera_1.toCalibration(radius_r_1[i]));
   float ball_position_r_1_float[3];
   ball_position_r_1_float[0]=ball_position_r_1[0];
   ball_position_r_1_float[1]=ball_position_r_1[1];
@@ -606,7 +603,7 @@ Mat Camera_1_center = Mat(3,1, CV_32F, Transfer_matrix_data);
   Scalar color = Scalar( 255, 0, 0);
   drawContours( hsv_frame_1_blue_canny, contours_b_poly_1, (int)i, color, 1, 8, vector<Vec4i>(), 0, Point() );
   vector<float> ball_position_b_1;
-  ball_position_b_1 = pixel2point_1(center_b_1[i], radius_b_1[i]);
+  ball_position_b_1 = pixel2point_1(camera_1.toCalibration(center_b_1[i]), camera_1.toCalibration(radius_b_1[i]));
   float ball_position_b_1_float[3];
   ball_position_b_1_float[0]=ball_position_b_1[0];
   ball_position_b_1_float[1]=ball_position_b_1[1];
@@ -701,7 +698,7 @@ Mat Camera_1_center = Mat(3,1, CV_32F, Transfer_matrix_data);
   Scalar color = Scalar( 0, 255, 0);
   drawContours( hsv_frame_1_green_canny, contours_g_poly_1, (int)i, color, 1, 8, vector<Vec4i>(), 0, Point() );
   vector<float> ball_position_g_1;
-  ball_position_g_1 = pixel2point_1(center_g_1[i], radius_g_1[i]);
+  ball_position_g_1 = pixel2point_1(camera_1.toCalibration(center_g_1[i]), camera_1.toCalibration(radius_g_1[i]));
   float ball_position_g_1_float[3];
   ball_position_g_1_float[0]=ball_position_g_1[0];
   ball_position_g_1_float[1]=ball_position_g_1[1];
@@ -760,9 +757,9 @@ Mat Camera_1_center = Mat(3,1, CV_32F, Transfer_matrix_data);
 
   //Camera Two
   //cout<<"Camera2_line_info"<<endl;
-  GaussianBlur(hsv_frame_2_red, hsv_frame_2_red_blur, cv::Size(9, 9), 2, 2);
-  GaussianBlur(hsv_frame_2_blue, hsv_frame_2_blue_blur, cv::Size(9, 9), 2, 2);
-  GaussianBlur(hsv_frame_2_green, hsv_frame_2_green_blur, cv::Size(9, 9), 2, 2);
+  GaussianBlur(hsv_frame_2_red, hsv_frame_2_red_blur, cv::Size(blur_size, blur_size), 2*scale, 2*scale);
+  GaussianBlur(hsv_frame_2_blue, hsv_frame_2_blue_blur, cv::Size(blur_size, blur_size), 2*scale, 2*scale);
+  GaussianBlur(hsv_frame_2_green, hsv_frame_2_green_blur, cv::Size(blur_size, blur_size), 2*scale, 2*scale);
   Canny(hsv_frame_2_red_blur, hsv_frame_2_red_canny, lowThreshold_r*ratio_r, kernel_size_r);
   Canny(hsv_frame_2_blue_blur, hsv_frame_2_blue_canny, lowThreshold_b*ratio_b, kernel_size_b);
   Canny(hsv_frame_2_green_blur, hsv_frame_2_green_canny, lowThreshold_g*ratio_g, kernel_size_g);
@@ -779,15 +776,15 @@ Mat Camera_1_center = Mat(3,1, CV_32F, Transfer_matrix_data);
   vector<float>radius_b_2( contours_b_2.size() );
   vector<float>radius_g_2( contours_g_2.size() );
   for( size_t i = 0; i < contours_r_2.size(); i++ ){
-  approxPolyDP( contours_r_2[i], contours_r_poly_2[i], 3, true );
+  approxPolyDP( contours_r_2[i], contours_r_poly_2[i], 3*scale, true );
   minEnclosingCircle( contours_r_poly_2[i], center_r_2[i], radius_r_2[i] );
   }
   for( size_t i = 0; i < contours_b_2.size(); i++ ){
-  approxPolyDP( contours_b_2[i], contours_b_poly_2[i], 3, true );
+  approxPolyDP( contours_b_2[i], contours_b_poly_2[i], 3*scale, true );
   minEnclosingCircle( contours_b_poly_2[i], center_b_2[i], radius_b_2[i] );
   }
   for( size_t i = 0; i < contours_g_2.size(); i++ ){
-  approxPolyDP( contours_g_2[i], contours_g_poly_2[i], 3, true );
+  approxPolyDP( contours_g_2[i], contours_g_poly_2[i], 3*scale, true );
   minEnclosingCircle( contours_g_poly_2[i], center_g_2[i], radius_g_2[i] );
   }
 
@@ -840,7 +837,7 @@ vector<Vec3f> camera2_green;
   Scalar color = Scalar( 0, 0, 255);
   drawContours( hsv_frame_2_red_canny, contours_r_poly_2, (int)i, color, 1, 8, vector<Vec4i>(), 0, Point() );
   vector<float> ball_position_r_2;
-  ball_position_r_2 = pixel2point_2(center_r_2[i], radius_r_2[i]);
+  ball_position_r_2 = pixel2point_2(camera_2.toCalibration(center_r_2[i]), camera_2.toCalibration(radius_r_2[i]));
   float ball_position_r_2_float[3];
   ball_position_r_2_float[0]=ball_position_r_2[0];
   ball_position_r_2_float[1]=ball_position_r_2[1];
@@ -944,7 +941,7 @@ vector<Vec3f> camera2_green;
   Scalar color = Scalar( 255, 0,0);
   drawContours( hsv_frame_2_blue_canny, contours_b_poly_2, (int)i, color, 1, 8, vector<Vec4i>(), 0, Point() );
   vector<float> ball_position_b_2;
-  ball_position_b_2 = pixel2point_2(center_b_2[i], radius_b_2[i]);
+  ball_position_b_2 = pixel2point_2(camera_2.toCalibration(center_b_2[i]), camera_2.toCalibration(radius_b_2[i]));
   float ball_position_b_2_float[3];
   ball_position_b_2_float[0]=ball_position_b_2[0];
   ball_position_b_2_float[1]=ball_position_b_2[1];
@@ -1048,7 +1045,7 @@ vector<Vec3f> camera2_green;
   Scalar color = Scalar( 0, 255, 0);
   drawContours( hsv_frame_2_green_canny, contours_g_poly_2, (int)i, color, 1, 8, vector<Vec4i>(), 0, Point() );
   vector<float> ball_position_g_2;
-  ball_position_g_2 = pixel2point_2(center_g_2[i], radius_g_2[i]);
+  ball_position_g_2 = pixel2point_2(camera_2.toCalibration(center_g_2[i]), camera_2.toCalibration(radius_g_2[i]));
   float ball_position_g_2_float[3];
   ball_position_g_2_float[0]=ball_position_g_2[0];
   ball_position_g_2_float[1]=ball_position_g_2[1];
@@ -2012,15 +2009,6 @@ cout<<"line_matching_green"<<endl;
 void imageCallback(const sensor_msgs::ImageConstPtr& msg)
 {
 
-   if(msg->height==480&&buffer.size().width==640){  //check the size of the image received. if the image have 640x480, then change the buffer size to 640x480.
-	std::cout<<"resized"<<std::endl;
-	cv::resize(buffer,buffer,cv::Size(1280,480));
-
-}
-   else{
-	//do nothing!
-   }
-
    try
    {
      buffer = cv_bridge::toCvShare(msg, "bgr8")->image;  //transfer the image data into buffer
@@ -0,0 +1,73 @@
+#ifndef WEBCAM_V4L2_CAMERA_H
+#define WEBCAM_V4L2_CAMERA_H
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <ros/time.h>
+#include <opencv2/core/core.hpp>
+
+namespace webcam {
+
+// One V4L2 capture device streaming into driver-owned mmap buffers.
+//
+// grab() only takes the next filled buffer from the driver and reads its
+// timestamp, so it returns as soon as the frame exists; the colour conversion
+// is left to retrieve(), which then hands the buffer back. With one thread per
+// device blocked in grab(), every camera is stamped the moment its frame is
+// ready instead of after the other cameras were read.
+class V4L2Camera {
+public:
+  enum Format { YUYV, MJPG };
+
+  V4L2Camera();
+  ~V4L2Camera();
+
+  // open device (e.g. "/dev/video0") and start streaming. The driver may pick
+  // another size or rate than asked for, see width()/height(). false and
+  // error() on failure.
+  bool open(const std::string& device, int width, int height, int fps, Format format, int buffers = 4);
+  void close();
+  bool isOpened() const { return fd_ >= 0; }
+
+  // wait up to timeout [s] for the next frame. stamp is when the driver
+  // finished the frame, in ROS time. false on timeout or error.
+  bool grab(ros::Time& stamp, double timeout = 1.0);
+  // convert the grabbed frame into dst as BGR and hand the buffer back. dst is
+  // only (re)allocated if it is not height x width CV_8UC3, so it can wrap the
+  // data of an outgoing message.
+  bool retrieve(cv::Mat& dst);
+  // hand the grabbed frame back unconverted
+  void release();
+
+  int width() const { return width_; }
+  int height() const { return height_; }
+  const std::string& device() const { return device_; }
+  const std::string& error() const { return error_; }
+
+private:
+  struct Buffer {
+    void* start;
+    size_t length;
+  };
+
+  // owns the mmap buffers
+  V4L2Camera(const V4L2Camera&);
+  V4L2Camera& operator=(const V4L2Camera&);
+
+  bool fail(const std::string& what);
+  bool requeue(int index);
+
+  int fd_;
+  std::string device_, error_;
+  Format format_;
+  int width_, height_;
+  size_t stride_;        // bytes per YUYV row
+  std::vector<Buffer> buffers_;
+  int grabbed_;          // index of the buffer taken by grab(), -1 if none
+  size_t grabbed_bytes_;
+};
+
+}
+
+#endif
@@ -0,0 +1,214 @@
+#include "webcam/v4l2_camera.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/select.h>
+#include <linux/videodev2.h>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+namespace webcam {
+
+// ioctl, retried when a signal interrupts it
+static int xioctl(int fd, unsigned long request, void* arg)
+{
+  int r;
+  do {
+    r = ioctl(fd, request, arg);
+  } while (r == -1 && errno == EINTR);
+  return r;
+}
+
+V4L2Camera::V4L2Camera()
+  : fd_(-1), format_(YUYV), width_(0), height_(0), stride_(0), grabbed_(-1), grabbed_bytes_(0)
+{
+}
+
+V4L2Camera::~V4L2Camera()
+{
+  close();
+}
+
+bool V4L2Camera::fail(const std::string& what)
+{
+  error_ = device_ + ": " + what + ": " + strerror(errno);
+  close();
+  return false;
+}
+
+bool V4L2Camera::open(const std::string& device, int width, int height, int fps, Format format, int buffers)
+{
+  close();
+  device_ = device;
+  format_ = format;
+
+  fd_ = ::open(device.c_str(), O_RDWR | O_NONBLOCK);
+  if (fd_ < 0) return fail("open");
+
+  v4l2_capability cap;
+  memset(&cap, 0, sizeof(cap));
+  if (xioctl(fd_, VIDIOC_QUERYCAP, &cap) == -1) return fail("VIDIOC_QUERYCAP");
+  if (!(cap.capabilities & V4L2_CAP_VIDEO_CAPTURE) || !(cap.capabilities & V4L2_CAP_STREAMING)) {
+    errno = ENODEV;
+    return fail("no streaming capture");
+  }
+
+  v4l2_format fmt;
+  memset(&fmt, 0, sizeof(fmt));
+  fmt.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  fmt.fmt.pix.width = width;
+  fmt.fmt.pix.height = height;
+  fmt.fmt.pix.pixelformat = (format == MJPG) ? V4L2_PIX_FMT_MJPEG : V4L2_PIX_FMT_YUYV;
+  fmt.fmt.pix.field = V4L2_FIELD_NONE;
+  if (xioctl(fd_, VIDIOC_S_FMT, &fmt) == -1) return fail("VIDIOC_S_FMT");
+  width_ = fmt.fmt.pix.width;
+  height_ = fmt.fmt.pix.height;
+  stride_ = fmt.fmt.pix.bytesperline ? fmt.fmt.pix.bytesperline : (size_t)width_*2;
+
+  // best effort, not every driver lets the rate be set
+  v4l2_streamparm parm;
+  memset(&parm, 0, sizeof(parm));
+  parm.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  parm.parm.capture.timeperframe.numerator = 1;
+  parm.parm.capture.timeperframe.denominator = fps;
+  xioctl(fd_, VIDIOC_S_PARM, &parm);
+
+  v4l2_requestbuffers req;
+  memset(&req, 0, sizeof(req));
+  req.count = buffers;
+  req.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  req.memory = V4L2_MEMORY_MMAP;
+  if (xioctl(fd_, VIDIOC_REQBUFS, &req) == -1) return fail("VIDIOC_REQBUFS");
+  if (req.count < 2) {
+    errno = ENOMEM;
+    return fail("not enough buffers");
+  }
+
+  buffers_.resize(req.count);
+  for (size_t i = 0; i < buffers_.size(); i++) {
+    buffers_[i].start = MAP_FAILED;
+    buffers_[i].length = 0;
+  }
+  for (size_t i = 0; i < buffers_.size(); i++) {
+    v4l2_buffer buf;
+    memset(&buf, 0, sizeof(buf));
+    buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    buf.memory = V4L2_MEMORY_MMAP;
+    buf.index = i;
+    if (xioctl(fd_, VIDIOC_QUERYBUF, &buf) == -1) return fail("VIDIOC_QUERYBUF");
+    buffers_[i].start = mmap(NULL, buf.length, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, buf.m.offset);
+    if (buffers_[i].start == MAP_FAILED) return fail("mmap");
+    buffers_[i].length = buf.length;
+    if (!requeue(i)) return fail("VIDIOC_QBUF");
+  }
+
+  v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  if (xioctl(fd_, VIDIOC_STREAMON, &type) == -1) return fail("VIDIOC_STREAMON");
+
+  error_.clear();
+  return true;
+}
+
+void V4L2Camera::close()
+{
+  if (fd_ < 0) return;
+
+  v4l2_buf_type type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  xioctl(fd_, VIDIOC_STREAMOFF, &type);
+  for (size_t i = 0; i < buffers_.size(); i++) {
+    if (buffers_[i].start != MAP_FAILED) munmap(buffers_[i].start, buffers_[i].length);
+  }
+  buffers_.clear();
+  ::close(fd_);
+  fd_ = -1;
+  grabbed_ = -1;
+}
+
+bool V4L2Camera::requeue(int index)
+{
+  v4l2_buffer buf;
+  memset(&buf, 0, sizeof(buf));
+  buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  buf.memory = V4L2_MEMORY_MMAP;
+  buf.index = index;
+  return xioctl(fd_, VIDIOC_QBUF, &buf) != -1;
+}
+
+bool V4L2Camera::grab(ros::Time& stamp, double timeout)
+{
+  if (fd_ < 0) return false;
+  release();
+
+  fd_set fds;
+  FD_ZERO(&fds);
+  FD_SET(fd_, &fds);
+  timeval tv;
+  tv.tv_sec = (long)timeout;
+  tv.tv_usec = (long)((timeout - tv.tv_sec)*1e6);
+  int r;
+  do {
+    r = select(fd_ + 1, &fds, NULL, NULL, &tv);
+  } while (r == -1 && errno == EINTR);
+  if (r <= 0) {
+    error_ = device_ + ((r == 0) ? ": timeout" : ": select failed");
+    return false;
+  }
+
+  v4l2_buffer buf;
+  memset(&buf, 0, sizeof(buf));
+  buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+  buf.memory = V4L2_MEMORY_MMAP;
+  if (xioctl(fd_, VIDIOC_DQBUF, &buf) == -1) {
+    error_ = device_ + ": VIDIOC_DQBUF: " + strerror(errno);
+    return false;
+  }
+  grabbed_ = buf.index;
+  grabbed_bytes_ = buf.bytesused;
+
+  // the driver stamps on CLOCK_MONOTONIC; shift that by how long ago it was
+  stamp = ros::Time::now();
+  if ((buf.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) == V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC) {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double age = (now.tv_sec - buf.timestamp.tv_sec) + (now.tv_nsec/1000 - buf.timestamp.tv_usec)*1e-6;
+    if (age > 0 && age < 1) stamp -= ros::Duration(age);
+  }
+  return true;
+}
+
+bool V4L2Camera::retrieve(cv::Mat& dst)
+{
+  if (grabbed_ < 0) return false;
+
+  const Buffer& b = buffers_[grabbed_];
+  dst.create(height_, width_, CV_8UC3);
+  bool ok = true;
+  if (format_ == YUYV) {
+    cv::Mat yuyv(height_, width_, CV_8UC2, b.start, stride_);
+    cv::cvtColor(yuyv, dst, cv::COLOR_YUV2BGR_YUYV);
+  }
+  else {
+    // decodes straight into dst as long as the frame has the negotiated size
+    cv::Mat jpeg(1, (int)grabbed_bytes_, CV_8UC1, b.start);
+    cv::imdecode(jpeg, cv::IMREAD_COLOR, &dst);
+    ok = dst.rows == height_ && dst.cols == width_;
+    if (!ok) error_ = device_ + ": bad MJPG frame";
+  }
+
+  release();
+  return ok;
+}
+
+void V4L2Camera::release()
+{
+  if (grabbed_ < 0) return;
+  requeue(grabbed_);
+  grabbed_ = -1;
+}
+
+}
@@ -1,56 +1,209 @@
 #include <ros/ros.h>
 #include <image_transport/image_transport.h>
 #include <opencv2/highgui/highgui.hpp>
-#include <cv_bridge/cv_bridge.h>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <sensor_msgs/image_encodings.h>
+#include <boost/thread.hpp>
+#include <boost/make_shared.hpp>
+#include <math.h>
+#include <string.h>
+
+#include "webcam/v4l2_camera.h"
+
+// One capture thread per camera. Each thread blocks in grab() on its own device,
+// so a frame is stamped by the driver the moment it is complete, and publishes it
+// on cameraN/image_raw right away. Frames of the two cameras whose stamps are
+// within max_skew are then paired:
+//   stereo/left/image_raw, stereo/right/image_raw : the pair with one common stamp,
+//       for message_filters::TimeSynchronizer
+//   camera/image : both halves side by side, as the old node published for ball_detection
+// Pair topics are only built while someone subscribes to them.
+
+struct Stream {
+  webcam::V4L2Camera cam;
+  std::string name;                 // frame_id and topic prefix
+  image_transport::Publisher pub;
+  sensor_msgs::ImageConstPtr latest;  // newest frame not paired yet
+};
+
+Stream streams[2];
+boost::mutex pair_mutex;
+image_transport::Publisher pub_left, pub_right, pub_concat;
+
+bool reduced = false;   // publish 320x240 instead of the capture size
+double max_skew;        // [s] frames further apart than this are not paired
+
+// statistics, under pair_mutex
+int pairs = 0, unpaired = 0;
+double skew_sum = 0;
+
+// the side by side image of the last pair, for the "show" window
+cv::Mat shown;
+bool show_new = false;
+
+sensor_msgs::ImagePtr restamped(const sensor_msgs::Image& msg, const ros::Time& stamp){
+  sensor_msgs::ImagePtr out = boost::make_shared<sensor_msgs::Image>(msg);
+  out->header.stamp = stamp;
+  return out;
+}
+
+void publish_pair(const sensor_msgs::ImageConstPtr& left, const sensor_msgs::ImageConstPtr& right, bool show){
+  ros::Time stamp = left->header.stamp + (right->header.stamp - left->header.stamp)*0.5;
+
+  if(pub_left.getNumSubscribers() > 0 || pub_right.getNumSubscribers() > 0){
+    pub_left.publish(restamped(*left, stamp));
+    pub_right.publish(restamped(*right, stamp));
+  }
+
+  if(pub_concat.getNumSubscribers() > 0 || show){
+    // hconcat, written straight into the outgoing message
+    sensor_msgs::ImagePtr msg = boost::make_shared<sensor_msgs::Image>();
+    msg->header.stamp = stamp;
+    msg->header.frame_id = "stereo";
+    msg->height = left->height;
+    msg->width = left->width + right->width;
+    msg->encoding = sensor_msgs::image_encodings::BGR8;
+    msg->step = msg->width*3;
+    msg->data.resize((size_t)msg->step*msg->height);
+    for(unsigned int r = 0; r < msg->height; r++){
+      unsigned char* row = &msg->data[(size_t)r*msg->step];
+      memcpy(row, &left->data[(size_t)r*left->step], left->width*3);
+      memcpy(row + left->width*3, &right->data[(size_t)r*right->step], right->width*3);
+    }
+    pub_concat.publish(msg);
+
+    if(show){
+      boost::mutex::scoped_lock lock(pair_mutex);
+      shown = cv::Mat(msg->height, msg->width, CV_8UC3, &msg->data[0]).clone();
+      show_new = true;
+    }
+  }
+}
+
+// store a new frame of stream k and pair it with the other camera's newest one
+void offer(int k, const sensor_msgs::ImageConstPtr& msg, bool show){
+  sensor_msgs::ImageConstPtr left, right;
+  {
+    boost::mutex::scoped_lock lock(pair_mutex);
+    if(streams[k].latest) unpaired++;   // replaced before a partner came
+    streams[k].latest = msg;
+
+    const sensor_msgs::ImageConstPtr& other = streams[1-k].latest;
+    if(!other || other->height != msg->height || other->width != msg->width) return;
+    double skew = fabs((msg->header.stamp - other->header.stamp).toSec());
+    if(skew > max_skew) return;
+
+    left = streams[0].latest;
+    right = streams[1].latest;
+    streams[0].latest.reset();
+    streams[1].latest.reset();
+    pairs++;
+    skew_sum += skew;
+  }
+  publish_pair(left, right, show);
+}
+
+void capture(int k, bool show){
+  Stream& s = streams[k];
+  cv::Mat full;   // capture size, only used when reduced
+  ros::Time stamp;
+
+  while(ros::ok()){
+    if(!s.cam.grab(stamp)){
+      ROS_WARN_THROTTLE(1, "%s", s.cam.error().c_str());
+      continue;
+    }
+
+    int width = reduced ? 320 : s.cam.width();
+    int height = reduced ? 240 : s.cam.height();
+    sensor_msgs::ImagePtr msg = boost::make_shared<sensor_msgs::Image>();
+    msg->header.stamp = stamp;
+    msg->header.frame_id = s.name;
+    msg->height = height;
+    msg->width = width;
+    msg->encoding = sensor_msgs::image_encodings::BGR8;
+    msg->step = width*3;
+    msg->data.resize((size_t)msg->step*height);
+
+    // converted straight into the message, no copy on the way
+    cv::Mat out(height, width, CV_8UC3, &msg->data[0]);
+    bool ok;
+    if(reduced){
+      ok = s.cam.retrieve(full);
+      if(ok) cv::resize(full, out, out.size());
+    }
+    else{
+      ok = s.cam.retrieve(out) && out.data == &msg->data[0];
+    }
+    if(!ok){
+      ROS_WARN_THROTTLE(1, "%s", s.cam.error().c_str());
+      continue;
+    }
+
+    s.pub.publish(msg);
+    offer(k, msg, show);
+  }
+}
 
 int main(int argc, char** argv)
 {
   ros::init(argc, argv, "webcam");   //init ros node. The name of node is decided here.
   ros::NodeHandle nh;  // create node handler
-  image_transport::ImageTransport it(nh);  //create image transport and connect it to the node handler created above
-  image_transport::Publisher pub = it.advertise("camera/image", 1);  //create a publisher that is connected to image traport(it), the topic name and queue size are decided.
+  image_transport::ImageTransport it(nh);
 
   ros::NodeHandle nh_private("~"); //create a private node handler to handle parameters related to the node
-  bool reduced = true; //boolean variable that decides whether you want to use reduced image or not-reduced image. If there is slow-down caused by big-sized data, then set it true.
-  nh_private.param<bool>("reduced", reduced, false); //declare ros parameter named "reduced", the value of ros parameter will be saved in the variable 'reduced'
+  nh_private.param<bool>("reduced", reduced, false); //if there is slow-down caused by big-sized data, then set it true.
   bool show = false; //boolean variable that decides whether you want to see the image via new window
-  nh_private.param<bool>("show",show,false); //declare ros parameter named "show",
-
-  cv::VideoCapture cap1 = cv::VideoCapture(0); //create cv::VideoCapture (*opencv function that capture images from camera)
-  cv::VideoCapture cap2 = cv::VideoCapture(1);
-  cv::Mat frame_1;  //assign a memory to save images with variable name 'frame'
-  cv::Mat frame_2;
-  cv::Mat buffer_1; //assign a memory to save images with variable name 'frame'
-  cv::Mat buffer_2;
-  cv::Mat buffer;
-  sensor_msgs::ImagePtr msg; //declare a pointer of sensor_msgs::Image.
-
-  ros::Rate loop_rate(30); //set loop rate. you can set hz here. The maximum hz of webcam device is 30hz. If you set the hz here larger than 30, it is meaningless.
-  while (nh.ok()) {
-    cap1 >> frame_1;  //transfer image captured by 'cap' to 'frame'
-    cap2 >> frame_2;
-    //이미지 데이터의 크기를 줄이기 위해 원본 이미지보다 낮은 320*240 화질로 변경함
-    if(reduced==true){
-	cv::resize(frame_1, buffer_1, cv::Size(320, 240)); //reduced the size of the image
-  //cv::resize(frame_2, buffer_2, cv::Size(320, 240));
-    }
-    else{
-	buffer_1 = frame_1;
-  buffer_2 = frame_2;
+  nh_private.param<bool>("show", show, false);
+
+  std::string device[2], format;
+  int width, height, fps;
+  nh_private.param<std::string>("device_1", device[0], "/dev/video0");
+  nh_private.param<std::string>("device_2", device[1], "/dev/video1");
+  nh_private.param("width", width, 640);
+  nh_private.param("height", height, 480);
+  nh_private.param("fps", fps, 30);
+  nh_private.param<std::string>("pixel_format", format, "yuyv"); // "yuyv" or "mjpeg"; two yuyv cameras at 30hz may not fit on one USB2 hub
+  // the cameras run free, so their frames are up to half a period apart; pair the nearest ones by default
+  nh_private.param("max_skew", max_skew, 0.5/fps);
+
+  for(int k = 0; k < 2; k++){
+    streams[k].name = (k == 0) ? "camera1" : "camera2";
+    if(!streams[k].cam.open(device[k], width, height, fps,
+                            (format == "mjpeg") ? webcam::V4L2Camera::MJPG : webcam::V4L2Camera::YUYV)){
+      ROS_ERROR("%s", streams[k].cam.error().c_str());
+      return -1;
     }
+    ROS_INFO("%s : %s %dx%d", streams[k].name.c_str(), device[k].c_str(), streams[k].cam.width(), streams[k].cam.height());
+    streams[k].pub = it.advertise(streams[k].name + "/image_raw", 1);
+  }
+  pub_left = it.advertise("stereo/left/image_raw", 1);
+  pub_right = it.advertise("stereo/right/image_raw", 1);
+  pub_concat = it.advertise("camera/image", 1);
 
-    if(show==true){
- 	cv::imshow("show_1",buffer_1);  //create a window that shows the image
-  //cv::imshow("show_2",buffer_2);
-        if(cv::waitKey(50)==113){  //wait for a key command. if 'q' is pressed, then program will be terminated.
-		return 0;
-	};
+  boost::thread capture_1(capture, 0, show);
+  boost::thread capture_2(capture, 1, show);
 
+  // windows belong to this thread
+  ros::Rate loop_rate(30);
+  while(nh.ok()){
+    cv::Mat frame;
+    {
+      boost::mutex::scoped_lock lock(pair_mutex);
+      if(show_new) frame = shown;
+      show_new = false;
+      if(pairs > 0) ROS_INFO_THROTTLE(5, "stereo : %d pairs, mean skew %.1f ms, %d frames unpaired", pairs, skew_sum/pairs*1000, unpaired);
     }
-    cv::hconcat(buffer_1,buffer_2,buffer);
-    msg = cv_bridge::CvImage(std_msgs::Header(), "bgr8", buffer).toImageMsg(); //converting a image 'buffer' to ros message
-        //리사이즈한 이미지를 publish
-    pub.publish(msg);  //publish a message
-    loop_rate.sleep(); //this will sleep the loop to satisfy hz you decided in the above line ros::Rate loop_rate(N)
+    if(show && !frame.empty()){
+      cv::imshow("show", frame);
+      if(cv::waitKey(1)==113) break;  //if 'q' is pressed, then program will be terminated.
+    }
+    ros::spinOnce();
+    loop_rate.sleep();
   }
+
+  ros::shutdown();
+  capture_1.join();
+  capture_2.join();
+  return 0;
 }
@@ -9,6 +9,8 @@
 #include <image_transport/image_transport.h>
 #include <cv_bridge/cv_bridge.h>
 #include <core_msgs/ball_position.h>
+#include "camera_model.h"
+#include "ball_segmenter.h"
 #include <std_msgs/ColorRGBA.h>
 //#include <visualization_msgs/Marker.h>
 using namespace std;
@@ -79,6 +81,8 @@ float fball_radius = 0.074 ; // meter
 Mat distCoeffs;
 float intrinsic_data[9] = {642.684732, 0, 339.646184, 0, 648.308290, 264.631910, 0, 0, 1};
 float distortion_data[5] = {0.040375, -0.095099, 0.015688, 0.003085, 0};
+CameraModel camera(intrinsic_data, distortion_data);
+BallSegmenter segmenter(2, true);
 
 // Initialization of variable for text drawing
 double fontScale = 2;
@@ -102,16 +106,7 @@ int iMin_tracking_ball_size = 8;
 
 core_msgs::ball_position ball_detect(Mat frame){
 
-	Mat bgr_frame, hsv_frame, hsv_frame_red, hsv_frame_red1, hsv_frame_red2, hsv_frame_blue, hsv_frame_green, hsv_frame_red_blur, hsv_frame_blue_blur, hsv_frame_green_blur, hsv_frame_red_canny, hsv_frame_blue_canny, hsv_frame_green_canny, result;
-    Mat calibrated_frame;
-    Mat intrinsic = Mat(3,3, CV_32FC1);
-    Mat distCoeffs;
-    Mat eq_red, eq_blue, eq_green;
-    intrinsic = Mat(3, 3, CV_32F, intrinsic_data);
-    distCoeffs = Mat(1, 5, CV_32F, distortion_data);
-    vector<Vec4i> hierarchy_r;
-    vector<Vec4i> hierarchy_b;
-	vector<Vec4i> hierarchy_g;
+	Mat calibrated_frame, result;
     vector<vector<Point> > contours_r;
     vector<vector<Point> > contours_b;
 	vector<vector<Point> > contours_g;
@@ -159,73 +154,27 @@ core_msgs::ball_position ball_detect(Mat frame){
 
         //if(frame.empty()) break;
 
-        undistort(frame, calibrated_frame, intrinsic, distCoeffs);
-        result = calibrated_frame.clone();
-        medianBlur(calibrated_frame, calibrated_frame, 3);
-        cvtColor(calibrated_frame, hsv_frame, cv::COLOR_BGR2HSV);
+        // balls are detected in the raw frame, at its own size, and only their contour points
+        // are rectified; the whole frame is rectified just for the result window
+        camera.rectify(frame, result);
+        segmenter.setScale(camera.scale());
+        medianBlur(frame, calibrated_frame, 3);
+        segmenter.setFrame(calibrated_frame);
 
         // Detect the object based on RGB and HSV Range Values
-        inRange(hsv_frame,Scalar(low_h_r,low_s_r,low_v_r),Scalar(high_h_r,high_s_r,high_v_r),hsv_frame_red1);
-        inRange(hsv_frame,Scalar(low_h2_r,low_s_r,low_v_r),Scalar(high_h2_r,high_s_r,high_v_r),hsv_frame_red2);
-        inRange(hsv_frame,Scalar(low_h_b,low_s_b,low_v_b),Scalar(high_h_b,high_s_b,high_v_b),hsv_frame_blue);
-		inRange(hsv_frame,Scalar(low_h_g,low_s_g,low_v_g),Scalar(high_h_g,high_s_g,high_v_g),hsv_frame_green);
-        addWeighted(hsv_frame_red1, 1.0, hsv_frame_red2, 1.0, 0.0, hsv_frame_red);
-        morphOps(hsv_frame_red);
-        morphOps(hsv_frame_blue);
-		morphOps(hsv_frame_green);
-
-        GaussianBlur(hsv_frame_red, hsv_frame_red_blur, cv::Size(9, 9), 2, 2);
-        GaussianBlur(hsv_frame_blue, hsv_frame_blue_blur, cv::Size(9, 9), 2, 2);
-		GaussianBlur(hsv_frame_green, hsv_frame_green_blur, cv::Size(9, 9), 2, 2);
-
-        equalizeHist(hsv_frame_red_blur, eq_red);
-        equalizeHist(hsv_frame_blue_blur, eq_blue);
-		equalizeHist(hsv_frame_green_blur, eq_green);
-
-        Canny(eq_red, hsv_frame_red_canny, lowThreshold_r, lowThreshold_r*ratio_r, kernel_size_r);
-        Canny(eq_blue, hsv_frame_blue_canny, lowThreshold_b, lowThreshold_b*ratio_b, kernel_size_b);
-		Canny(eq_green, hsv_frame_green_canny, lowThreshold_g, lowThreshold_g*ratio_g, kernel_size_g);
-/*
-		Mat hist1 = hsv_frame_green_blur, hist2 = eq_green;
-		resize(hist1, hist1, Size(), 0.2, 0.2, CV_INTER_AREA);
-		resize(hist2, hist2, Size(), 0.2, 0.2, CV_INTER_AREA);
-		MatND histogram1, histogram2;
-		const int* channel_numbers = {0};
-		float channel_range[] = {0.0, 255.0};
-		const float* channel_ranges = channel_range;
-		int number_bins = 255;
-
-		calcHist(&hist1, 1, channel_numbers, Mat(), histogram1, 1, &number_bins, &channel_ranges);
-		calcHist(&hist2, 1, channel_numbers, Mat(), histogram2, 1, &number_bins, &channel_ranges);
-
-		int hist_w = 1000; int hist_h = 400;
-		int bin_w = cvRound((double)hist_w/number_bins);
-
-		Mat histImage1(hist_h, hist_w, CV_8UC1, Scalar(0,0,0));
-		normalize(histogram1, histogram1, 0, histImage1.rows, NORM_MINMAX, -1, Mat());
-
-		Mat histImage2(hist_h, hist_w, CV_8UC1, Scalar(0,0,0));
-		normalize(histogram2, histogram2, 0, histImage2.rows, NORM_MINMAX, -1, Mat());
-
-
-		for (int i = 1;i<number_bins;i++){
-			line(histImage1, Point(bin_w*(i-1), hist_h - cvRound(histogram1.at<float>(i-1))), Point(bin_w*(i), hist_h - cvRound(histogram1.at<float>(i))), Scalar(255,0,0),2,8,0);
-			line(histImage2, Point(bin_w*(i-1), hist_h - cvRound(histogram2.at<float>(i-1))), Point(bin_w*(i), hist_h - cvRound(histogram2.at<float>(i))), Scalar(255,0,0),2,8,0);
-		}
-
-		
-		imshow("before histogram",histImage1);
-		imshow("after histogram",histImage2);
+        ColorRange red = {Scalar(low_h_r,low_s_r,low_v_r), Scalar(high_h_r,high_s_r,high_v_r),
+                          Scalar(low_h2_r,low_s_r,low_v_r), Scalar(high_h2_r,high_s_r,high_v_r), true,
+                          lowThreshold_r, ratio_r, kernel_size_r};
+        ColorRange blue = {Scalar(low_h_b,low_s_b,low_v_b), Scalar(high_h_b,high_s_b,high_v_b),
+                           Scalar(), Scalar(), false,
+                           lowThreshold_b, ratio_b, kernel_size_b};
+        ColorRange green = {Scalar(low_h_g,low_s_g,low_v_g), Scalar(high_h_g,high_s_g,high_v_g),
+                            Scalar(), Scalar(), false,
+                            lowThreshold_g, ratio_g, kernel_size_g};
+        segmenter.segment(red, contours_r);
+        segmenter.segment(blue, contours_b);
+        segmenter.segment(green, contours_g);
 
-*/
-        findContours(hsv_frame_red_canny, contours_r, hierarchy_r, RETR_CCOMP, CHAIN_APPROX_SIMPLE, Point(0, 0));
-        findContours(hsv_frame_blue_canny, contours_b, hierarchy_b, RETR_CCOMP, CHAIN_APPROX_SIMPLE, Point(0, 0));
-		findContours(hsv_frame_green_canny, contours_g, hierarchy_g, RETR_CCOMP, CHAIN_APPROX_SIMPLE, Point(0, 0));
-
-
-        vector<vector<Point> > contours_r_poly( contours_r.size() );
-        vector<vector<Point> > contours_b_poly( contours_b.size() );
-		vector<vector<Point> > contours_g_poly( contours_g.size() );
         vector<Point2f>center_r( contours_r.size() );
         vector<Point2f>center_b( contours_b.size() );
 		vector<Point2f>center_g( contours_g.size() );
@@ -235,8 +184,7 @@ core_msgs::ball_position ball_detect(Mat frame){
 
 		//Determine circle for red ball
         for( size_t i = 0; i < contours_r.size(); i++ ){
-            approxPolyDP( contours_r[i], contours_r_poly[i], 2, true );
-            minEnclosingCircle( contours_r_poly[i], center_r[i], radius_r[i] );
+            camera.rectifiedCircle( contours_r[i], center_r[i], radius_r[i] );
         }
         //cout << contours_r.size() << endl;
 
@@ -250,7 +198,6 @@ core_msgs::ball_position ball_detect(Mat frame){
                     if(radius_r[i] > radius_r[j]){
                         if(dis < radius_r[i]){
                             contours_r.erase(contours_r.begin() + j);
-                            contours_r_poly.erase(contours_r_poly.begin() + j);
                             center_r.erase(center_r.begin() + j);
                             radius_r.erase(radius_r.begin() + j);
                             j-=1;
@@ -260,7 +207,6 @@ core_msgs::ball_position ball_detect(Mat frame){
                     else if(radius_r[j] > radius_r[i]){
                         if(dis < radius_r[j]){
                             contours_r.erase(contours_r.begin() + i);
-                            contours_r_poly.erase(contours_r_poly.begin() + i);
                             center_r.erase(center_r.begin() + i);
                             radius_r.erase(radius_r.begin() + i);
                             j-=1;
@@ -273,8 +219,7 @@ core_msgs::ball_position ball_detect(Mat frame){
 
 		//Determine circle for blue ball
         for( size_t i = 0; i < contours_b.size(); i++ ){
-            approxPolyDP( contours_b[i], contours_b_poly[i], 2, true );
-            minEnclosingCircle( contours_b_poly[i], center_b[i], radius_b[i] );
+            camera.rectifiedCircle( contours_b[i], center_b[i], radius_b[i] );
         }
 
 		if(contours_b.size() > 1){
@@ -286,7 +231,6 @@ core_msgs::ball_position ball_detect(Mat frame){
                     if(radius_b[i] > radius_b[j]){
                         if(dis < radius_b[i]){
                             contours_b.erase(contours_b.begin() + j);
-                            contours_b_poly.erase(contours_b_poly.begin() + j);
                             center_b.erase(center_b.begin() + j);
                             radius_b.erase(radius_b.begin() + j);
                             j-=1;
@@ -296,7 +240,6 @@ core_msgs::ball_position ball_detect(Mat frame){
                     else if(radius_b[j] > radius_b[i]){
                         if(dis < radius_b[j]){
                             contours_b.erase(contours_b.begin() + i);
-                            contours_b_poly.erase(contours_b_poly.begin() + i);
                             center_b.erase(center_b.begin() + i);
                             radius_b.erase(radius_b.begin() + i);
                             j-=1;
@@ -308,8 +251,7 @@ core_msgs::ball_position ball_detect(Mat frame){
 
 		//Determine circle for green ball
 		for( size_t i = 0; i < contours_g.size(); i++ ){
-            approxPolyDP( contours_g[i], contours_g_poly[i], 2, true );
-            minEnclosingCircle( contours_g_poly[i], center_g[i], radius_g[i] );
+            camera.rectifiedCircle( contours_g[i], center_g[i], radius_g[i] );
         }
 
 		if(contours_g.size() > 1){
@@ -321,7 +263,6 @@ core_msgs::ball_position ball_detect(Mat frame){
                     if(radius_g[i] > radius_g[j]){
                         if(dis < radius_g[i]){
                             contours_g.erase(contours_g.begin() + j);
-                            contours_g_poly.erase(contours_g_poly.begin() + j);
                             center_g.erase(center_g.begin() + j);
                             radius_g.erase(radius_g.begin() + j);
                             j-=1;
@@ -331,7 +272,6 @@ core_msgs::ball_position ball_detect(Mat frame){
                     else if(radius_g[j] > radius_g[i]){
                         if(dis < radius_g[j]){
                             contours_g.erase(contours_g.begin() + i);
-                            contours_g_poly.erase(contours_g_poly.begin() + i);
                             center_g.erase(center_g.begin() + i);
                             radius_g.erase(radius_g.begin() + i);
                             j-=1;
@@ -487,7 +427,6 @@ core_msgs::ball_position ball_detect(Mat frame){
 				
               //  cout << i << "// center : " << center_r[i].x << ", " << center_r[i].y << "// radius : " << radius_r[i] << endl;
                 Scalar color = Scalar( 0, 0, 255);
-                drawContours( hsv_frame_red_canny, contours_r_poly, (int)i, color, 1, 8, vector<Vec4i>(), 0, Point() );
                 vector<float> ball_position_r;
 				//ROS_INFO("RED BALL, center : (%f, %f), radius : %f", center_r[i].x, center_r[i].y, radius_r[i]);
 
@@ -504,9 +443,9 @@ core_msgs::ball_position ball_detect(Mat frame){
 				out.img_x_red[j] = isx;
 				out.img_y_red[j] = sqrt(isz*isz + isy*isy - cam_height * cam_height) + y_offset;
                 text = "<" + index + ">, " + "x : " + floatToString(isx) + "," + "y : " + floatToString(out.img_y_red[j]);
-                Point2f text_loc(center_r[i].x - 200, center_r[i].y);
-                putText(result, text, text_loc,2,1,Scalar(0,255,0),2);
-                circle( result, center_r[i], (int)radius_r[i], color, 2, 8, 0 );
+                Point2f text_loc = camera.toImage(center_r[i]) - Point2f(200*camera.scale(), 0);
+                putText(result, text, text_loc,2,camera.scale(),Scalar(0,255,0),2);
+                circle( result, camera.toImage(center_r[i]), (int)camera.toImage(radius_r[i]), color, 2, 8, 0 );
 				
 				
 				//ROS_INFO("RED BALL, x : %f, y : %f", out.img_x_red[j], out.img_y_red[j]);
@@ -519,7 +458,6 @@ core_msgs::ball_position ball_detect(Mat frame){
             if(radius_b[i] > iMin_tracking_ball_size){
 				               
 				Scalar color = Scalar( 255, 0, 0);
-                drawContours( hsv_frame_blue_canny, contours_b_poly, (int)i, color, 1, 8, vector<Vec4i>(), 0, Point() );
                 vector<float> ball_position_b;
 				//ROS_INFO("BLUE BALL, center : (%f, %f), radius : %f", center_b[i].x, center_b[i].y, radius_b[i]);
 
@@ -537,9 +475,9 @@ core_msgs::ball_position ball_detect(Mat frame){
 				out.img_x_blue[j] = isx;
 				out.img_y_blue[j] = sqrt(isz*isz + isy*isy - cam_height * cam_height) + y_offset;
                 text = "<" + index + ">, " + "x : " + floatToString(isx) + "," + "y : " + floatToString(out.img_y_blue[j]);
-				Point2f text_loc(center_b[i].x - 200, center_b[i].y);
-                putText(result, text, text_loc,2,1,Scalar(0,255,0),2);
-                circle( result, center_b[i], (int)radius_b[i], color, 2, 8, 0 );
+				Point2f text_loc = camera.toImage(center_b[i]) - Point2f(200*camera.scale(), 0);
+                putText(result, text, text_loc,2,camera.scale(),Scalar(0,255,0),2);
+                circle( result, camera.toImage(center_b[i]), (int)camera.toImage(radius_b[i]), color, 2, 8, 0 );
 
 				
 				
@@ -554,7 +492,6 @@ core_msgs::ball_position ball_detect(Mat frame){
             if(radius_g[i] > iMin_tracking_ball_size){
 				
                 Scalar color = Scalar( 0, 255, 0);
-                drawContours( hsv_frame_green_canny, contours_g_poly, (int)i, color, 1, 8, vector<Vec4i>(), 0, Point() );
                 vector<float> ball_position_g;
 				//ROS_INFO("GREEN BALL, center : (%f, %f), radius : %f", center_g[i].x, center_g[i].y, radius_g[i]);                
 
@@ -571,9 +508,9 @@ core_msgs::ball_position ball_detect(Mat frame){
 				out.img_x_green[j] = isx;
 				out.img_y_green[j] = sqrt(isz*isz + isy*isy - cam_height * cam_height) + y_offset;
                 text = "<" + index + ">, " + "x : " + floatToString(isx) + "," + "y : " + floatToString(out.img_y_green[j]);
-				Point2f text_loc(center_g[i].x - 200, center_g[i].y);
-                putText(result, text, text_loc,2,1,Scalar(0,255,0),2);
-                circle( result, center_g[i], (int)radius_g[i], color, 2, 8, 0 );
+				Point2f text_loc = camera.toImage(center_g[i]) - Point2f(200*camera.scale(), 0);
+                putText(result, text, text_loc,2,camera.scale(),Scalar(0,255,0),2);
+                circle( result, camera.toImage(center_g[i]), (int)camera.toImage(radius_g[i]), color, 2, 8, 0 );
 
 				
 				
@@ -646,6 +583,14 @@ class pass{
 	public :
 		pass(){
 			image_transport::ImageTransport it(nh);
+			// coarse to fine segmentation, see BallSegmenter
+			bool pyramid;
+			ros::NodeHandle("~").param("pyramid", pyramid, false);
+			segmenter.setPyramid(pyramid);
+			// track the balls and search the whole frame only every full_scan_period frames, see BallSegmenter
+			int full_scan_period;
+			ros::NodeHandle("~").param("full_scan_period", full_scan_period, 0);
+			segmenter.setFullScanPeriod(full_scan_period);
 			pub = nh.advertise<core_msgs::ball_position>("/position_2", 100);
 			//pub_markers = nh.advertise<visualization_msgs::Marker>("/balls",1);
 			sub = it.subscribe("camera/image_2", 1, &pass::imageCallback, this);
@@ -654,18 +599,16 @@ class pass{
 
 		void imageCallback(const sensor_msgs::ImageConstPtr& msg){
 			Mat received;
-			Mat	new_rec;
 			try{
 				received = cv_bridge::toCvShare(msg, "bgr8")->image;
 			}
 
 			catch(cv_bridge::Exception& e){
 				ROS_ERROR("Could not convert from '%s' to 'bgr8'.", msg->encoding.c_str());
+				return;
 			}			
-			
-			if(received.size().width == 320) cv::resize(received, new_rec, cv::Size(640, 480));
 
-			pub.publish(ball_detect(new_rec));
+			pub.publish(ball_detect(received));
 			ROS_INFO("send position");
 
 		}
@@ -0,0 +1,244 @@
+#include "ball_segmenter.h"
+
+#include <algorithm>
+
+using namespace std;
+using namespace cv;
+
+BallSegmenter::BallSegmenter(double poly_epsilon, bool equalize)
+  : poly_epsilon_(poly_epsilon), equalize_(equalize), pyramid_(false), full_scan_period_(0),
+    hsv_ready_(false), frame_(0), call_(0)
+{
+  setScale(1);
+}
+
+BallSegmenter::Kernels BallSegmenter::kernels(double scale, double poly_epsilon)
+{
+  Kernels k;
+  //the element chosen here is a 3px by 3px rectangle at 640x480
+  int e = max(1, (int)(3*scale + 0.5));
+  //dilate with larger element so make sure object is nicely visible
+  int d = max(1, (int)(8*scale + 0.5));
+  k.erode = getStructuringElement(MORPH_RECT, Size(e, e));
+  k.dilate = getStructuringElement(MORPH_RECT, Size(d, d));
+  int b = (int)(9*scale + 0.5) | 1;  // GaussianBlur takes odd sizes only
+  k.blur = Size(b, b);
+  k.sigma = 2*scale;
+  k.epsilon = poly_epsilon*scale;
+  return k;
+}
+
+void BallSegmenter::setScale(double scale)
+{
+  full_ = kernels(scale, poly_epsilon_);
+  coarse_ = kernels(scale/2, poly_epsilon_);
+  pad_ = full_.dilate.cols*2 + full_.blur.width;
+  // smaller blobs are noise the detectors drop anyway, not worth a box
+  min_track_radius_ = 4*scale;
+}
+
+void BallSegmenter::setFullScanPeriod(int frames)
+{
+  full_scan_period_ = max(0, frames);
+  tracks_.clear();
+}
+
+void BallSegmenter::setFrame(const Mat& bgr)
+{
+  bgr_ = bgr;
+  hsv_ready_ = false;
+  frame_++;
+  call_ = 0;
+}
+
+void BallSegmenter::segment(const ColorRange& range, vector<vector<Point> >& polys)
+{
+  polys.clear();
+  if (full_scan_period_ == 0)
+  {
+    searchFrame(range, polys);
+    return;
+  }
+
+  // a call new to this segmenter searches the whole frame at once
+  bool first = call_ >= tracks_.size();
+  if (first) tracks_.resize(call_ + 1);
+  vector<Track>& tracks = tracks_[call_++];
+
+  if (!first && frame_ % full_scan_period_ != 0)
+  {
+    // nothing to follow : a ball coming into view waits for the next periodic search
+    if (tracks.empty()) return;
+
+    Rect frame_rect(0, 0, bgr_.cols, bgr_.rows);
+    rois_.clear();
+    for (size_t i = 0; i < tracks.size(); i++)
+    {
+      Point2f c = predictedCenter(tracks[i]);
+      float h = searchRadius(tracks[i]);
+      addRoi(Rect(cvFloor(c.x - h), cvFloor(c.y - h), cvCeil(2*h), cvCeil(2*h)) & frame_rect);
+    }
+    searchRois(range, polys);
+    if (updateTracks(polys, tracks, true)) return;
+    polys.clear();
+  }
+
+  searchFrame(range, polys);
+  updateTracks(polys, tracks, false);
+}
+
+float BallSegmenter::predictedRadius(const Track& t) const
+{
+  // depth ~ 1/radius goes on at the same rate
+  float inverse = 2/t.radius - 1/t.last_radius;
+  float r = (inverse > 0) ? 1/inverse : 2*t.radius;
+  return min(max(r, t.radius/2), 2*t.radius);
+}
+
+float BallSegmenter::searchRadius(const Track& t) const
+{
+  // room for the ball, for its speed to double and for the kernels
+  return 1.5f*predictedRadius(t) + (float)norm(t.velocity) + pad_;
+}
+
+void BallSegmenter::searchFrame(const ColorRange& range, vector<vector<Point> >& polys)
+{
+  if (!pyramid_)
+  {
+    if (!hsv_ready_) cvtColor(bgr_, hsv_, COLOR_BGR2HSV);
+    hsv_ready_ = true;
+    segmentHsv(hsv_, range, full_, Point(0, 0), polys);
+    return;
+  }
+
+  if (!hsv_ready_)
+  {
+    pyrDown(bgr_, coarse_bgr_);
+    cvtColor(coarse_bgr_, coarse_hsv_, COLOR_BGR2HSV);
+    hsv_ready_ = true;
+  }
+  coarse_polys_.clear();
+  segmentHsv(coarse_hsv_, range, coarse_, Point(0, 0), coarse_polys_);
+
+  // full size boxes, with room for the kernels to see the background around the ball
+  Rect frame_rect(0, 0, bgr_.cols, bgr_.rows);
+  rois_.clear();
+  for (size_t i = 0; i < coarse_polys_.size(); i++)
+  {
+    Rect r = boundingRect(coarse_polys_[i]);
+    addRoi(Rect(r.x*2 - pad_, r.y*2 - pad_, r.width*2 + 2*pad_, r.height*2 + 2*pad_) & frame_rect);
+  }
+  searchRois(range, polys);
+}
+
+void BallSegmenter::searchRois(const ColorRange& range, vector<vector<Point> >& polys)
+{
+  // the histogram equalization, if any, now sees only the box
+  for (size_t i = 0; i < rois_.size(); i++)
+  {
+    cvtColor(bgr_(rois_[i]), roi_hsv_, COLOR_BGR2HSV);
+    segmentHsv(roi_hsv_, range, full_, rois_[i].tl(), polys);
+  }
+}
+
+void BallSegmenter::addRoi(Rect r)
+{
+  if (r.area() <= 0) return;
+  // the inner and outer edge of a ball, or balls next to each other, give one box
+  for (size_t j = 0; j < rois_.size(); )
+  {
+    if ((r & rois_[j]).area() > 0)
+    {
+      r |= rois_[j];
+      rois_.erase(rois_.begin() + j);
+      j = 0;
+    }
+    else j++;
+  }
+  rois_.push_back(r);
+}
+
+bool BallSegmenter::updateTracks(const vector<vector<Point> >& polys, vector<Track>& tracks, bool keep_all)
+{
+  // the balls of this frame, largest first, without the inner edges
+  found_.clear();
+  for (size_t i = 0; i < polys.size(); i++)
+  {
+    Track t;
+    minEnclosingCircle(polys[i], t.center, t.radius);
+    if (t.radius < min_track_radius_) continue;
+    size_t j = 0;
+    while (j < found_.size() && found_[j].radius >= t.radius) j++;
+    found_.insert(found_.begin() + j, t);
+  }
+  for (size_t i = 0; i < found_.size(); i++)
+  {
+    for (size_t j = i + 1; j < found_.size(); )
+    {
+      if (norm(found_[j].center - found_[i].center) < found_[i].radius) found_.erase(found_.begin() + j);
+      else j++;
+    }
+  }
+
+  // each ball takes the nearest track that expected it there
+  vector<bool> matched(tracks.size(), false);
+  for (size_t i = 0; i < found_.size(); i++)
+  {
+    Track& t = found_[i];
+    int best = -1;
+    double best_distance = 0;
+    for (size_t j = 0; j < tracks.size(); j++)
+    {
+      if (matched[j]) continue;
+      double distance = norm(t.center - predictedCenter(tracks[j]));
+      if (distance < searchRadius(tracks[j]) && (best < 0 || distance < best_distance))
+      {
+        best = (int)j;
+        best_distance = distance;
+      }
+    }
+    if (best >= 0)
+    {
+      matched[best] = true;
+      t.velocity = t.center - tracks[best].center;
+      t.last_radius = tracks[best].radius;
+    }
+    else
+    {
+      t.velocity = Point2f(0, 0);
+      t.last_radius = t.radius;
+    }
+  }
+
+  if (keep_all && find(matched.begin(), matched.end(), false) != matched.end()) return false;
+  tracks = found_;
+  return true;
+}
+
+void BallSegmenter::segmentHsv(const Mat& hsv, const ColorRange& range, const Kernels& k,
+                               const Point& offset, vector<vector<Point> >& polys)
+{
+  inRange(hsv, range.low, range.high, mask_);
+  if (range.two_ranges)
+  {
+    inRange(hsv, range.low2, range.high2, mask2_);
+    addWeighted(mask_, 1.0, mask2_, 1.0, 0.0, mask_);
+  }
+
+  erode(mask_, mask_, k.erode);
+  erode(mask_, mask_, k.erode);
+  dilate(mask_, mask_, k.dilate);
+  dilate(mask_, mask_, k.dilate);
+
+  GaussianBlur(mask_, blur_, k.blur, k.sigma, k.sigma);
+  if (equalize_) equalizeHist(blur_, blur_);
+  Canny(blur_, edges_, range.canny_low, range.canny_low*range.canny_ratio, range.canny_kernel);
+  findContours(edges_, contours_, hierarchy_, RETR_CCOMP, CHAIN_APPROX_SIMPLE, offset);
+
+  size_t n = polys.size();
+  polys.resize(n + contours_.size());
+  for (size_t i = 0; i < contours_.size(); i++)
+  {
+    approxPolyDP(contours_[i], polys[n + i], k.epsilon, true);
+  }
+}
@@ -0,0 +1,111 @@
+#ifndef BALL_SEGMENTER_H
+#define BALL_SEGMENTER_H
+
+#include <vector>
+#include "opencv2/opencv.hpp"
+
+// HSV range of one ball colour and the Canny parameters of its trackbars.
+// Red wraps around hue 180, so it can take a second range that is OR'd in.
+struct ColorRange
+{
+  cv::Scalar low, high;
+  cv::Scalar low2, high2;  // second range, unused when two_ranges is false
+  bool two_ranges;
+  int canny_low, canny_ratio, canny_kernel;
+};
+
+// The threshold -> morphOps -> GaussianBlur -> Canny -> approxPolyDP chain of the
+// ball detectors, for frames of any size. The kernels and the polygon epsilon were
+// tuned on 640x480 frames; setScale() resizes them so that e.g. the 320x240 frames
+// of a "reduced" webcam are segmented as they came instead of on an upscaled copy.
+//
+// With setPyramid(true) the frame is first segmented at half its size (a quarter
+// of the pixels), and only the boxes around what was found there are converted
+// to HSV and segmented again at full size. The polygons come from the full size
+// boxes, so their precision stays, but balls of a radius close to the minimum
+// ball size may already be lost at half size.
+//
+// With setFullScanPeriod(n) the balls found are tracked: each one's position is
+// carried forward at its last image velocity, and its radius so that its depth
+// (proportional to 1/radius, as in pixel2point) changes at its last rate. Only
+// boxes around these predictions are segmented. The whole frame is searched on
+// every n-th frame, for balls that came into view, and whenever a tracked ball
+// is not found again in its box. A range with no tracked ball is not searched at
+// all in between, so a ball coming into view is found up to n-1 frames late.
+// The segment() calls of a frame are told apart by their order, so make them in
+// the same order on every frame.
+class BallSegmenter
+{
+public:
+  BallSegmenter(double poly_epsilon = 3, bool equalize = false);
+
+  // image pixels per pixel of the 640x480 frames the parameters were tuned on
+  void setScale(double scale);
+  void setPyramid(bool pyramid) { pyramid_ = pyramid; }
+  bool pyramid() const { return pyramid_; }
+  // frames between whole frame searches while tracking, 0 searches every frame
+  void setFullScanPeriod(int frames);
+  int fullScanPeriod() const { return full_scan_period_; }
+
+  // bgr : median-blurred BGR frame, read until the next setFrame(). Successive
+  // frames must have the same size while tracking.
+  void setFrame(const cv::Mat& bgr);
+
+  // approxPolyDP polygons of the edges of the range's blobs, in frame pixels
+  void segment(const ColorRange& range, std::vector<std::vector<cv::Point> >& polys);
+
+private:
+  struct Kernels
+  {
+    cv::Mat erode, dilate;
+    cv::Size blur;
+    double sigma, epsilon;
+  };
+  static Kernels kernels(double scale, double poly_epsilon);
+
+  // a ball of the last frame, in frame pixels
+  struct Track
+  {
+    cv::Point2f center, velocity;
+    float radius, last_radius;  // last_radius : radius one frame before
+  };
+  cv::Point2f predictedCenter(const Track& t) const { return t.center + t.velocity; }
+  float predictedRadius(const Track& t) const;
+  // half the side of the box the track is looked for in
+  float searchRadius(const Track& t) const;
+
+  void searchFrame(const ColorRange& range, std::vector<std::vector<cv::Point> >& polys);
+  void searchRois(const ColorRange& range, std::vector<std::vector<cv::Point> >& polys);
+  // adds r to rois_, joined with the boxes it overlaps
+  void addRoi(cv::Rect r);
+  // matches the balls of polys to tracks; with keep_all, leaves tracks as they were
+  // and returns false if one of them was not found again
+  bool updateTracks(const std::vector<std::vector<cv::Point> >& polys, std::vector<Track>& tracks, bool keep_all);
+
+  // polygons of one range in hsv, shifted by offset
+  void segmentHsv(const cv::Mat& hsv, const ColorRange& range, const Kernels& k,
+                  const cv::Point& offset, std::vector<std::vector<cv::Point> >& polys);
+
+  double poly_epsilon_;
+  bool equalize_;
+  bool pyramid_;
+  int full_scan_period_;
+  Kernels full_, coarse_;
+  int pad_;  // [px] room for the kernels to see the background around a ball in a box
+  float min_track_radius_;
+
+  cv::Mat bgr_, hsv_, coarse_hsv_;
+  bool hsv_ready_;  // hsv_ or coarse_hsv_, converted at the first whole frame search of a frame
+  unsigned int frame_;
+  size_t call_;  // segment() calls so far in this frame
+  std::vector<std::vector<Track> > tracks_;  // per segment() call of a frame
+
+  // per frame buffers, kept so that their memory is reused
+  cv::Mat coarse_bgr_, roi_hsv_, mask_, mask2_, blur_, edges_;
+  std::vector<std::vector<cv::Point> > contours_, coarse_polys_;
+  std::vector<cv::Vec4i> hierarchy_;
+  std::vector<cv::Rect> rois_;
+  std::vector<Track> found_;
+};
+
+#endif
@@ -0,0 +1,79 @@
+#include "camera_model.h"
+
+using namespace std;
+using namespace cv;
+
+CameraModel::CameraModel(const float* intrinsic_data, const float* distortion_data, const Size& calibration_size)
+{
+  setCalibration(intrinsic_data, distortion_data, calibration_size);
+}
+
+void CameraModel::setCalibration(const float* intrinsic_data, const float* distortion_data, const Size& calibration_size)
+{
+  // own copies, the tables stay valid whatever happens to the arrays
+  intrinsic_ = Mat(3, 3, CV_32F, (void*)intrinsic_data).clone();
+  dist_ = Mat(1, 5, CV_32F, (void*)distortion_data).clone();
+  calibration_size_ = calibration_size;
+  image_size_ = Size();
+  setImageSize(calibration_size);
+}
+
+void CameraModel::setImageSize(const Size& size)
+{
+  if (size == image_size_) return;
+  image_size_ = size;
+
+  // pixel centres sit at (i + 0.5)/scale - 0.5 of the calibration image
+  float s = (float)scale();
+  image_intrinsic_ = intrinsic_.clone();
+  image_intrinsic_.at<float>(0, 0) *= s;
+  image_intrinsic_.at<float>(0, 2) = (intrinsic_.at<float>(0, 2) + 0.5f)*s - 0.5f;
+  image_intrinsic_.at<float>(1, 1) *= s;
+  image_intrinsic_.at<float>(1, 2) = (intrinsic_.at<float>(1, 2) + 0.5f)*s - 0.5f;
+
+  map1_.release();
+  map2_.release();
+}
+
+void CameraModel::rectify(const Mat& src, Mat& dst)
+{
+  setImageSize(src.size());
+  if (map1_.empty())
+  {
+    initUndistortRectifyMap(image_intrinsic_, dist_, Mat(), image_intrinsic_, src.size(), CV_16SC2, map1_, map2_);
+  }
+  remap(src, dst, map1_, map2_, INTER_LINEAR, BORDER_CONSTANT);
+}
+
+void CameraModel::rectifyPoints(const vector<Point>& src, vector<Point2f>& dst) const
+{
+  dst.assign(src.begin(), src.end());
+  rectifyPoints(dst);
+}
+
+void CameraModel::rectifyPoints(vector<Point2f>& points) const
+{
+  if (points.empty()) return;
+  vector<Point2f> raw;
+  raw.swap(points);
+  undistortPoints(raw, points, image_intrinsic_, dist_, noArray(), intrinsic_);
+}
+
+void CameraModel::rectifiedCircle(const vector<Point>& points, Point2f& center, float& radius) const
+{
+  vector<Point2f> rectified;
+  rectifyPoints(points, rectified);
+  minEnclosingCircle(rectified, center, radius);
+}
+
+Point2f CameraModel::toCalibration(const Point2f& p) const
+{
+  float s = (float)scale();
+  return Point2f((p.x + 0.5f)/s - 0.5f, (p.y + 0.5f)/s - 0.5f);
+}
+
+Point2f CameraModel::toImage(const Point2f& p) const
+{
+  float s = (float)scale();
+  return Point2f((p.x + 0.5f)*s - 0.5f, (p.y + 0.5f)*s - 0.5f);
+}
@@ -27,6 +27,8 @@
 
 #include "opencv2/opencv.hpp"
 
+#include "velocity_profile.h"
+
 
 #define RAD2DEG(x) ((x)*180./M_PI)
 
@@ -102,7 +104,7 @@ int collection=0;// number of collected blue balls
 
 int action;
 
-float acc=0.1;//acceleration when moving
+VelocityProfile profile;//acceleration and jerk limited velocities, written to data[0], data[1], data[4] every tick
 
 float suc=10;//variable to count suction time and 'collection'
 
@@ -394,37 +396,15 @@ void sleep_count(float sleeprate){
 
 void move_forward(float v){
 	//move slowly when red ball is close in the forward direction, except for the releasing step
-	//accelerate til speed 0.5
+	//otherwise move as speed v; the profile ramps towards it
 	if(web1_red_Y > 2.52 && collection < 3){
-		if(data[1] < 0.5){
-		 data[0] = 0;
-		 data[1] = data[1]+acc;
-		 data[4] = 0;
-		 data[5] = 0;
-	  }
-		else if(data[1] > 0.5){
-		 data[0] = 0;
-		 data[1] = data[1]-acc;
-		 data[4] = 0;
-		 data[5] = 0;
-	  }
+		profile.setVelocity(0, 0.5, 0);
 	}
-	 //move as speed v, when red ball is not close to the ball
-	 //accelerate til speed v
-	 else{
-		 if(data[1] < v){
-	 	 data[0] = 0;
-	 	 data[1] = data[1]+acc;
-	 	 data[4] = 0;
-	 	 data[5] = 0;
-	   }
-	 	else if(data[1] > v){
-	 	 data[	0] = 0;
-	 	 data[1] = data[1]-acc;
-	 	 data[4] = 0;
-	 	 data[5] = 0;
-	   }
-	 }
+	else{
+		profile.setVelocity(0, v, 0);
+	}
+	profile.step(t);
+	profile.write(data);
 	suction_check();
 	write(c_socket, data, sizeof(data));
   cout<<"void move forward"<<endl;
@@ -433,10 +413,9 @@ void move_forward(float v){
 
 void turn_CW(float w){
  //turn CW with speed of w
- data[0] = 0;
- data[1] = 0;
- data[4] = w;
- data[5] = 0;
+ profile.setVelocity(0, 0, w);
+ profile.step(t);
+ profile.write(data);
  suction_check();
  write(c_socket, data, sizeof(data));
  cout<<"void turn CW"<<endl;
@@ -445,10 +424,9 @@ void turn_CW(float w){
 
 void turn_CCW(float w){
  //turn CCW with speed of w
- data[0] = 0;
- data[1] = 0;
- data[4] = -w;
- data[5] = 0;
+ profile.setVelocity(0, 0, -w);
+ profile.step(t);
+ profile.write(data);
  suction_check();
  write(c_socket, data, sizeof(data));
  cout<<"void turn CCW"<<endl;
@@ -457,13 +435,10 @@ ROS_INFO("%f, %f, %f, %f, %f", data[0], data[1], data[4], data[5],	data[21]);
 
 
 void move_left(float v){
-	//move left, accelerate til speed 0.8
-	if(data[0]>-v){
-	data[0] = data[0]-acc;
-	data[1] = 0;
-	data[4] = 0;
-	data[5] = 0;
-   }
+	//move left, accelerate til speed v
+	profile.setVelocity(-v, 0, 0);
+	profile.step(t);
+	profile.write(data);
 	 suction_check();
 	write(c_socket, data, sizeof(data));
 	cout<<"void move left"<<endl;
@@ -471,13 +446,10 @@ void move_left(float v){
 }
 
 void move_right(float v){
-	//move right, accelerate til speed 0.8
-	if(data[0]<v){
-	data[0] = data[0]+acc;
-	data[1] = 0;
-	data[4] = 0;
-	data[5] = 0;
-}
+	//move right, accelerate til speed v
+	profile.setVelocity(v, 0, 0);
+	profile.step(t);
+	profile.write(data);
   suction_check();
 	write(c_socket, data, sizeof(data));
 	cout<<"void move right"<<endl;
@@ -604,10 +576,9 @@ void release(){
                      }
                      for(float k=0; k<2; k=k+t){
                       data[20]=1;
-                      data[0]=0;
-                      data[1]=0;
-                      data[4]=0;
-                      data[5]=0;
+                      profile.stop();
+                      profile.step(t);
+                      profile.write(data);
                       write(c_socket, data, sizeof(data));
                       sleep_count(t);
                      }
@@ -623,10 +594,9 @@ void release(){
                      }
                      for(float k=0; k<2; k=k+t){
                         data[20]=1;
-                        data[0]=0;
-                        data[1]=0;
-                        data[4]=0;
-                        data[5]=0;
+                        profile.stop();
+                        profile.step(t);
+                        profile.write(data);
                       write(c_socket, data, sizeof(data));
                       sleep_count(t);
                      }
@@ -773,7 +743,6 @@ int main(int argc, char **argv)
 									ros::spinOnce();
 			 	 				  sleep_count(t);
 						 			 }
-						      float k = 0;
 						      // while(k<0.8 && web1_red_Y < 3.5){
 									// 	//go forward for a while
 									// 	move_forward(1);
@@ -782,29 +751,30 @@ int main(int argc, char **argv)
 									// 	k=k+t;
 									// }
 									bool c = true;
-									while(k<0.8 && c){
+									//go forward for a while - as far as 0.8s at full speed, ~1.2s with the ramps; given up after twice that
+									float k = 0;
+									profile.stop();
+									profile.forward.moveBy(0.8);
+									while(!profile.forward.done() && c && k<2.4 && ros::ok()){
 										ros::spinOnce();
-										//go forward for a while
 										if(web2_blue_number != 0){
 											pick_up();
 											c = false;
 										}
-										data[0] = 0;
-							 	 	  data[1] = 1;
-							 	 	  data[4] = 0;
-							 	 	  data[5] = 0;
+										profile.step(t);
+										profile.write(data);
 										sleep_count(t);
 										suction_check();
 										write(c_socket, data, sizeof(data));
 										k=k+t;
 									}
-									//turn CW for a while
+									//turn CW for a while - as far as 0.5s at speed 0.8, ~0.7s with the ramps; given up after twice that
 									k=0;
-									while(k<0.5 && c){
-										data[0] = 0;
-										data[1] = 0;
-										data[4] = 0.8;
-										data[5] = 0;
+									profile.rotation.moveBy(0.4);
+									while(!profile.rotation.done() && c && k<1.4 && ros::ok()){
+										ros::spinOnce();
+										profile.step(t);
+										profile.write(data);
 										suction_check();
 										write(c_socket, data, sizeof(data));
 										cout<<"open loop turning CW"<<endl;
@@ -823,18 +793,18 @@ int main(int argc, char **argv)
 				 				 sleep_count(t);
 						}
 								 bool c = true;
+								 //go forward for a while - as far as 0.8s at full speed, ~1.2s with the ramps; given up after twice that
 								 float k = 0;
-								 while(k<0.8 && c){
+								 profile.stop();
+								 profile.forward.moveBy(0.8);
+								 while(!profile.forward.done() && c && k<2.4 && ros::ok()){
 									 ros::spinOnce();
-									 //go forward for a while
 									 if(web2_blue_number != 0){
 										 pick_up();
 										 c = false;
 									 }
-									 data[0] = 0;
-									 data[1] = 1;
-									 data[4] = 0;
-									 data[5] = 0;
+									 profile.step(t);
+									 profile.write(data);
 									 sleep_count(t);
 									 suction_check();
 									 write(c_socket, data, sizeof(data));
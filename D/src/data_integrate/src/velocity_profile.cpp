@@ -0,0 +1,167 @@
+#include "velocity_profile.h"
+
+#include <math.h>
+#include <algorithm>
+
+using namespace std;
+
+// a velocity or distance this close to its target counts as reached
+static const float EPS = 1e-3;
+
+static float sign(float x){
+  return (x > 0) ? 1.f : ((x < 0) ? -1.f : 0.f);
+}
+
+AxisProfile::AxisProfile(const ProfileLimits& limits)
+  : limits_(limits), v_(0), a_(0), target_(0), distance_mode_(false), remaining_(0)
+{
+}
+
+void AxisProfile::setVelocity(float v){
+  target_ = max(-limits_.v_max, min(v, limits_.v_max));
+  distance_mode_ = false;
+  remaining_ = 0;
+}
+
+void AxisProfile::moveBy(float d){
+  distance_mode_ = true;
+  remaining_ = d;
+}
+
+void AxisProfile::reset(){
+  v_ = a_ = target_ = 0;
+  distance_mode_ = false;
+  remaining_ = 0;
+}
+
+bool AxisProfile::done() const{
+  if(distance_mode_) return fabs(remaining_) < EPS && fabs(v_) < EPS && fabs(a_) < EPS;
+  return fabs(target_ - v_) < EPS && fabs(a_) < EPS;
+}
+
+// largest x with x^2/2k + x*dt/2 <= d : the ramp x -> 0 at slope k, taken in steps of dt, covers that much
+static float rampLimit(float k, float d, float dt){
+  return k*(sqrt(dt*dt/4 + 2*d/k) - dt/2);
+}
+
+// advance (x, v, a) by t at constant jerk j
+static void integrate(float& x, float& v, float& a, float j, float t){
+  x += v*t + a*t*t/2 + j*t*t*t/6;
+  v += a*t + j*t*t/2;
+  a += j*t;
+}
+
+// distance covered from (v, a) when braking to rest as hard as the limits allow :
+// jerk to the peak deceleration, hold it if a_max is reached, jerk back to zero as v reaches zero
+static float stopDistance(float v, float a, float A, float J){
+  // braking is against the velocity left once a is taken back to zero
+  float s = (v + a*fabs(a)/(2*J) < 0) ? -1.f : 1.f;
+  v *= s; a *= s;
+  float peak2 = (a*a + 2*J*v)/2;
+  float peak = -min(A, sqrt(max(0.f, peak2)));
+  float hold = (peak2 > A*A) ? (v + (a*a - 2*A*A)/(2*J))/A : 0;
+  float x = 0;
+  integrate(x, v, a, -J, (a - peak)/J);
+  integrate(x, v, a, 0, hold);
+  integrate(x, v, a, J, -peak/J);
+  return s*x;
+}
+
+// largest a whose ramp a, a - J*dt, ... down to zero, one step per tick, gains no more than e :
+// m steps gain dt*(m*a - J*dt*m(m-1)/2), and each tick on it leaves the next step one J*dt lower
+static float rampAccel(float J, float e, float dt){
+  float jdt2 = J*dt*dt;
+  float m = max(1.f, ceil((sqrt(1 + 8*e/jdt2) - 1)/2));
+  return (e/dt + J*dt*m*(m - 1)/2)/m;
+}
+
+// acceleration that moves v towards vt and lands on it, within da of a
+static float track(float v, float a, float vt, float A, float J, float da, float dt){
+  float e = vt - v;
+  float a_des = sign(e)*min(A, fabs(e)/dt);
+  if(J > 0) a_des = sign(e)*min(fabs(a_des), rampAccel(J, fabs(e), dt));
+  return max(a - da, min(a_des, a + da));
+}
+
+float AxisProfile::step(float dt){
+  if(dt <= 0) return v_;
+  const float A = limits_.a_max, J = limits_.j_max;
+  // how far the acceleration may move in one tick
+  const float da = (J > 0) ? J*dt : 2*A;
+
+  if(!distance_mode_){
+    a_ = track(v_, a_, target_, A, J, da, dt);
+    v_ += a_*dt;
+    return v_;
+  }
+
+  // stopping this tick covers v*dt/2; take it when that ends within half a tick of travel of
+  // the target (or past it) and the jerk allows it, the leftover is dropped
+  float a_stop = -v_/dt;
+  float after = remaining_ - v_/2*dt;
+  if(fabs(a_stop - a_) <= da && fabs(a_stop) <= min(A, da) &&
+     (fabs(remaining_) < EPS || sign(after) != sign(remaining_) || fabs(after) <= fabs(v_)*dt/2)){
+    remaining_ = 0;
+    v_ = a_ = 0;
+    return v_;
+  }
+
+  // work towards positive remaining_
+  float s = (remaining_ < 0) ? -1.f : 1.f;
+  float r = s*remaining_, v = s*v_, a = s*a_;
+  float a_next;
+  if(J <= 0){
+    a_next = track(v, a, min(limits_.v_max, rampLimit(A, r, dt)), A, J, da, dt);
+  }
+  else{
+    // head for v_max, but take the largest acceleration from which the axis still stops within
+    // what is left after this tick; a bisection keeps the cost fixed
+    float hi = track(v, a, limits_.v_max, A, J, da, dt);
+    float lo = max(a - da, -A);
+    auto fits = [&](float a_try){
+      float v1 = v + a_try*dt;
+      return stopDistance(v1, a_try, A, J) <= r - (v + v1)/2*dt;
+    };
+    if(hi <= lo || fits(hi)) a_next = hi;
+    else if(!fits(lo)) a_next = lo;
+    else{
+      for(int i=0; i<20; i++){
+        float mid = (lo + hi)/2;
+        if(fits(mid)) lo = mid; else hi = mid;
+      }
+      a_next = lo;
+    }
+  }
+
+  a_ = s*a_next;
+  float v_prev = v_;
+  v_ += a_*dt;
+  remaining_ -= (v_prev + v_)/2*dt;
+  return v_;
+}
+
+VelocityProfile::VelocityProfile()
+  : lateral(ProfileLimits(1, 4, 40)),
+    forward(ProfileLimits(1, 4, 40)),
+    rotation(ProfileLimits(1, 8, 80))
+{
+}
+
+void VelocityProfile::setVelocity(float vx, float vy, float w){
+  lateral.setVelocity(vx);
+  forward.setVelocity(vy);
+  rotation.setVelocity(w);
+}
+
+void VelocityProfile::step(float dt){
+  lateral.step(dt);
+  forward.step(dt);
+  rotation.step(dt);
+}
+
+void VelocityProfile::write(float* data) const{
+  data[0] = lateral.velocity();
+  data[1] = forward.velocity();
+  data[4] = rotation.velocity();
+  data[5] = 0;
+}
@@ -0,0 +1,71 @@
+#ifndef VELOCITY_PROFILE_H
+#define VELOCITY_PROFILE_H
+
+// Speed limits of one axis, in myRIO command units (data[] value, 1 = full stick).
+// j_max <= 0 gives a trapezoidal profile (acceleration jumps), otherwise an
+// S-curve whose acceleration itself ramps at j_max.
+struct ProfileLimits{
+  float v_max;  // [unit]
+  float a_max;  // [unit/s]
+  float j_max;  // [unit/s^2]
+
+  ProfileLimits(float v = 1, float a = 4, float j = 40) : v_max(v), a_max(a), j_max(j) {}
+};
+
+// One axis of the command frame. Either follows a target velocity, or drives an
+// open-loop distance (velocity integrated over time, unit*s) and stops on it.
+// step() costs the same every tick and never moves the acceleration by more
+// than j_max*dt : a velocity is approached on a ramp that lands on it exactly,
+// a distance with the largest acceleration from which the axis can still stop
+// within what is left. The last tick of a move stops the axis outright once
+// that is within the jerk limit and ends within half a tick of travel.
+class AxisProfile{
+public:
+  explicit AxisProfile(const ProfileLimits& limits = ProfileLimits());
+
+  void setLimits(const ProfileLimits& limits) { limits_ = limits; }
+  const ProfileLimits& limits() const { return limits_; }
+
+  // follow velocity v, clamped to v_max
+  void setVelocity(float v);
+  // move by d from here and stop; the sign gives the direction
+  void moveBy(float d);
+  // drop to zero at once, for emergencies only
+  void reset();
+
+  // advance by dt [s], returns the new velocity
+  float step(float dt);
+
+  float velocity() const { return v_; }
+  float acceleration() const { return a_; }
+  // distance left of the last moveBy(), 0 in velocity mode
+  float remaining() const { return distance_mode_ ? remaining_ : 0; }
+  // velocity reached, or distance covered and stopped
+  bool done() const;
+
+private:
+  ProfileLimits limits_;
+  float v_, a_;
+  float target_;
+  bool distance_mode_;
+  float remaining_;
+};
+
+// The three axes the myRIO drives : data[0] lateral (right +), data[1] forward,
+// data[4] rotation (CW +).
+class VelocityProfile{
+public:
+  VelocityProfile();
+
+  AxisProfile lateral, forward, rotation;
+
+  void setVelocity(float vx, float vy, float w);
+  void stop() { setVelocity(0, 0, 0); }
+  void step(float dt);
+  bool done() const { return lateral.done() && forward.done() && rotation.done(); }
+
+  // write the velocities into the 24-float command frame
+  void write(float* data) const;
+};
+
+#endif
@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+#include <math.h>
+#include <algorithm>
+#include <random>
+
+#include "../src/velocity_profile.h"
+
+namespace {
+
+// Steps an axis and checks every tick against its limits, on the finite differences
+// of the velocity the myRIO actually receives.
+struct Drive {
+  ProfileLimits limits;
+  float dt;
+  float v, a;      // last commanded velocity and its finite-difference acceleration
+  double x;        // distance driven, trapezoid like the profile integrates it
+  int ticks;
+  bool jerk_ok, accel_ok;
+
+  Drive(const ProfileLimits& l, float dt_)
+    : limits(l), dt(dt_), v(0), a(0), x(0), ticks(0), jerk_ok(true), accel_ok(true) {}
+
+  void step(AxisProfile& axis) {
+    float v1 = axis.step(dt);
+    float a1 = (v1 - v)/dt;
+    if(limits.j_max > 0 && fabs(a1 - a) > limits.j_max*dt*1.01f + 1e-3f) jerk_ok = false;
+    if(fabs(a1) > limits.a_max*1.01f + 1e-3f) accel_ok = false;
+    x += (v + v1)/2*dt;
+    v = v1;
+    a = a1;
+    ticks++;
+  }
+};
+
+// generous bound on the ticks a move may take : cruise, the ramps at both ends, and undoing v0
+int tickCap(const ProfileLimits& l, float d, float v0, float dt)
+{
+  float ramp = l.j_max > 0 ? l.a_max/l.j_max : 0;
+  float t = fabs(d)/l.v_max + 2*l.v_max/l.a_max + 2*ramp + 2*fabs(v0)/l.a_max;
+  return (int)(4*t/dt) + 200;
+}
+
+}
+
+// the default limits at a 10 Hz tick used to dither around the target forever
+TEST(AxisProfile, MoveFinishesWithDefaultLimits)
+{
+  const float dts[] = { 0.1f, 0.05f, 0.025f };
+  const float ds[] = { 0.8f, 0.2f, 0.008f, 2.0f, -0.5f };
+  for(float dt : dts) for(float d : ds) {
+    AxisProfile axis;
+    Drive drive(axis.limits(), dt);
+    axis.moveBy(d);
+    int cap = tickCap(axis.limits(), d, 0, dt);
+    while(!axis.done() && drive.ticks < cap) drive.step(axis);
+
+    EXPECT_TRUE(axis.done()) << "dt " << dt << " d " << d;
+    EXPECT_TRUE(drive.jerk_ok) << "dt " << dt << " d " << d;
+    EXPECT_NEAR(drive.x, d, std::max(2e-3f, axis.limits().j_max*dt*dt*dt)) << "dt " << dt;
+  }
+}
+
+// random limits, tick lengths and moves started while the axis is already moving
+TEST(AxisProfile, MovesConvergeAcrossLimitsAndTicks)
+{
+  std::mt19937 rng(20);
+  std::uniform_real_distribution<float> u(0, 1);
+  for(int i=0; i<3000; i++) {
+    ProfileLimits limits(0.2f + 2*u(rng), 0.5f + 10*u(rng), (i%5 == 0) ? 0 : 5 + 200*u(rng));
+    float dt = (i%3 == 0) ? 0.1f : ((i%3 == 1) ? 0.025f : 0.005f + 0.1f*u(rng));
+    AxisProfile axis(limits);
+    Drive drive(limits, dt);
+
+    axis.setVelocity((2*u(rng) - 1)*limits.v_max);
+    for(int k=(int)(40*u(rng)); k>0; k--) drive.step(axis);
+
+    float d = (2*u(rng) - 1)*3;
+    if(i%7 == 0) d *= 0.01f;
+    double x0 = drive.x;
+    int cap = tickCap(limits, d, drive.v, dt);
+    drive.ticks = 0;
+    axis.moveBy(d);
+    while(!axis.done() && drive.ticks < cap) drive.step(axis);
+
+    SCOPED_TRACE(testing::Message() << "run " << i << " v_max " << limits.v_max << " a_max " << limits.a_max
+                 << " j_max " << limits.j_max << " dt " << dt << " d " << d);
+    ASSERT_TRUE(axis.done());
+    EXPECT_TRUE(drive.jerk_ok);
+    EXPECT_TRUE(drive.accel_ok);
+    // the last tick drops less than half a tick of travel at a speed it may stop from
+    float tol = limits.j_max > 0 ? limits.j_max*dt*dt*dt : limits.a_max*dt*dt;
+    EXPECT_NEAR(drive.x - x0, d, std::max(2e-3f, tol));
+  }
+}
+
+TEST(AxisProfile, VelocityLandsOnTarget)
+{
+  std::mt19937 rng(21);
+  std::uniform_real_distribution<float> u(0, 1);
+  for(int i=0; i<3000; i++) {
+    ProfileLimits limits(0.2f + 2*u(rng), 0.5f + 10*u(rng), (i%5 == 0) ? 0 : 5 + 200*u(rng));
+    float dt = 0.005f + 0.1f*u(rng);
+    AxisProfile axis(limits);
+    Drive drive(limits, dt);
+
+    // retarget a few times mid-ramp, then let the last target settle
+    float target = 0;
+    for(int seg=0; seg<4; seg++) {
+      target = (2*u(rng) - 1)*limits.v_max;
+      axis.setVelocity(target);
+      int cap = tickCap(limits, 0, limits.v_max, dt);
+      int n = (seg < 3) ? (int)(u(rng)*cap) : cap;
+      for(int k=0; k<n && !(seg == 3 && axis.done()); k++) {
+        float before = fabs(drive.v);
+        drive.step(axis);
+        EXPECT_FALSE(fabs(drive.v) > limits.v_max*1.001f + 1e-4f && fabs(drive.v) > before) << "run " << i;
+      }
+    }
+
+    SCOPED_TRACE(testing::Message() << "run " << i << " j_max " << limits.j_max << " dt " << dt);
+    ASSERT_TRUE(axis.done());
+    EXPECT_NEAR(drive.v, target, 1e-3);
+    EXPECT_TRUE(drive.jerk_ok);
+    EXPECT_TRUE(drive.accel_ok);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
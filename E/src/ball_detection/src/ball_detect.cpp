@@ -4,6 +4,7 @@
 #include <cv_bridge/cv_bridge.h>
 #include "core_msgs/ball_position.h"
 #include "opencv2/opencv.hpp"
+#include "camera_model.h"
 #include <visualization_msgs/Marker.h>
 #include <std_msgs/ColorRGBA.h>
 
@@ -85,6 +86,7 @@ float intrinsic_data[9] = {638.301619, 0.000000, 308.272626,
         0.000000, 0.000000, 1.000000};
 
 float distortion_data[5] = {0.034734, -0.154281, -0.003674, -0.001274, 0.000000};
+CameraModel camera(intrinsic_data, distortion_data);
 
 // Initialization of variable for text drawing
 double fontScale = 1;
@@ -103,10 +105,6 @@ void ball_detect(){
   result;
 
     Mat calibrated_frame;
-    Mat intrinsic = Mat(3,3, CV_32FC1);
-    Mat distCoeffs;
-    intrinsic = Mat(3, 3, CV_32F, intrinsic_data);
-    distCoeffs = Mat(1, 5, CV_32F, distortion_data);
     vector<Vec4i> hierarchy_r;
     vector<Vec4i> hierarchy_b;
     vector<Vec4i> hierarchy_g;
@@ -121,9 +119,9 @@ void ball_detect(){
          // frame = buffer;
      // }
 
-	undistort(frame, calibrated_frame, intrinsic, distCoeffs);
-	result = calibrated_frame.clone();
-	medianBlur(calibrated_frame, calibrated_frame, 3);
+	// balls are detected in the raw frame and only their contour points are rectified.
+	// for the result window, fill it with camera.rectify(frame, result) and uncomment the drawing
+	medianBlur(frame, calibrated_frame, 3);
 	cvtColor(calibrated_frame, hsv_frame, cv::COLOR_BGR2HSV);
 
 	// Detect the object based on RGB and HSV Range Values
@@ -165,11 +163,11 @@ void ball_detect(){
 
 	for( size_t i = 0; i < contours_r.size(); i++ ){
 		approxPolyDP( contours_r[i], contours_r_poly[i], 3, true );
-		minEnclosingCircle( contours_r_poly[i], center_r[i], radius_r[i] );
+		camera.rectifiedCircle( contours_r_poly[i], center_r[i], radius_r[i] );
 	}
 	for( size_t i = 0; i < contours_b.size(); i++ ){
 		approxPolyDP( contours_b[i], contours_b_poly[i], 3, true );
-		minEnclosingCircle( contours_b_poly[i], center_b[i], radius_b[i] );
+		camera.rectifiedCircle( contours_b_poly[i], center_b[i], radius_b[i] );
 	}
 	// for( size_t i = 0; i < contours_g.size(); i++ ){
 		// approxPolyDP( contours_g[i], contours_g_poly[i], 3, true );
@@ -344,8 +342,8 @@ void ball_detect(){
                         msg.img_y2[i] = (480-center_r[i].y);
 
 			text = "R:" + center;
-			putText(result, text, center_r[i],2,1,Scalar(0,255,0),2);
-			circle( result, center_r[i], (int)radius_r[i], color, 2, 8, 0 );
+			// putText(result, text, center_r[i],2,1,Scalar(0,255,0),2);
+			// circle( result, center_r[i], (int)radius_r[i], color, 2, 8, 0 );
 		}
 	}
 
@@ -367,8 +365,8 @@ void ball_detect(){
                         msg.img_y[i] = (480-center_b[i].y);
 
 			text = "B:" + center;
-			putText(result, text, center_b[i],2,1,Scalar(0,255,0),2);
-			circle( result, center_b[i], (int)radius_b[i], color, 2, 8, 0 );
+			// putText(result, text, center_b[i],2,1,Scalar(0,255,0),2);
+			// circle( result, center_b[i], (int)radius_b[i], color, 2, 8, 0 );
 		}
 	}
 	// for( size_t i = 0; i< contours_g.size(); i++ ){
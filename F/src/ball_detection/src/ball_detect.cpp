@@ -5,6 +5,7 @@
 #include <cv_bridge/cv_bridge.h>
 #include "core_msgs/ball_position.h"
 #include "opencv2/opencv.hpp"
+#include "camera_model.h"
 #include <visualization_msgs/Marker.h>
 #include <std_msgs/ColorRGBA.h>
 #include <iostream>
@@ -105,6 +106,8 @@ float distortion_data[5] = {0.022867, -0.043961, 0.002345, -0.009070, 0};
 
 float intrinsic_data2[9] = {643.261791, 0, 313.614993, 0, 646.846154, 215.713748, 0, 0, 1};
 float distortion_data2[5] = {0.031861, -0.138421, 0.00654, -0.001543, 0};
+CameraModel camera(intrinsic_data, distortion_data);
+CameraModel camera2(intrinsic_data2, distortion_data2);
 // Initialization of variable for text drawing
 double fontScale = 2;
 int thickness = 3;
@@ -154,14 +157,6 @@ int main(int argc, char **argv){
   hsv_frame_red_canny, hsv_frame_blue_canny,hsv_frame_blue_canny2, hsv_frame_green_canny, result,result2;
   Mat hsv_frame_green2, hsv_frame_green_blur2, hsv_frame_green_canny2;
   Mat calibrated_frame, calibrated_frame2;
-  Mat intrinsic = Mat(3,3, CV_32FC1);
-  Mat intrinsic2 = Mat(3,3, CV_32FC1);
-  Mat distCoeffs;
-  Mat distCoeffs2;
-  intrinsic = Mat(3, 3, CV_32F, intrinsic_data);
-  distCoeffs = Mat(1, 5, CV_32F, distortion_data);
-  intrinsic2 = Mat(3, 3, CV_32F, intrinsic_data2);
-  distCoeffs2 = Mat(1, 5, CV_32F, distortion_data2);
 
   vector<Vec4i> hierarchy_r;
   vector<Vec4i> hierarchy_b;
@@ -242,15 +237,14 @@ int main(int argc, char **argv){
     break;
 
 
-    //카메라 켈리브레이션을 통해 얻어낸 메트릭스를 이용해서 영상을 켈리브레이션하고 메디안블러를 한 후 RGB색을 HSV색으로 변환한다.
-    undistort(frame, calibrated_frame, intrinsic, distCoeffs);
-    result = calibrated_frame.clone();
-    medianBlur(calibrated_frame, calibrated_frame, 3);
+    //메디안블러를 한 후 RGB색을 HSV색으로 변환한다. 공은 원본 영상에서 찾고, 찾은 컨투어의 점만 켈리브레이션한다.
+    //화면과 rosbag에 보낼 result만 미리 만들어 둔 remap 테이블로 영상 전체를 켈리브레이션한다.
+    camera.rectify(frame, result);
+    medianBlur(frame, calibrated_frame, 3);
     cvtColor(calibrated_frame, hsv_frame, cv::COLOR_BGR2HSV);
 
-    undistort(frame2, calibrated_frame2, intrinsic2, distCoeffs2);
-    result2 = calibrated_frame2.clone();
-    medianBlur(calibrated_frame2, calibrated_frame2, 3);
+    camera2.rectify(frame2, result2);
+    medianBlur(frame2, calibrated_frame2, 3);
     cvtColor(calibrated_frame2, hsv_frame2, cv::COLOR_BGR2HSV);
 
     // Detect the object based on RGB and HSV Range Values
@@ -316,36 +310,36 @@ int main(int argc, char **argv){
     vector<float>radius_g(contours_g.size());
     vector<float>radius_g2(contours_g2.size());
 
-    //컨투어를 approxPolyDP함수를 이용해 다항식으로 변환시킨 후 minEnclosingCircle함수를 통해 그 컨투어의 외접원에 대한 중심과 반지름을 얻어내는 코드이다.
+    //컨투어를 approxPolyDP함수를 이용해 다항식으로 변환시킨 후 rectifiedCircle함수로 켈리브레이션한 점들의 외접원에 대한 중심과 반지름을 얻어내는 코드이다.
     //실제 실행시켜보면 반지름이 너무 크게잡혀서 이를 거리별로 값을 구한 후 실제 값과 1차추세선을 이용해 켈리브레이션한 것이 마지막에 radius_r[i] = ~~~이다.
     for(size_t i = 0; i <contours_r.size(); i++){
     approxPolyDP(contours_r[i], contours_r_poly[i], 3, true);
-    minEnclosingCircle(contours_r_poly[i], center_r[i], radius_r[i]);
+    camera.rectifiedCircle(contours_r_poly[i], center_r[i], radius_r[i]);
     radius_r[i] = 0.7536*radius_r[i]+0.6771;
     }
 
 
     for( size_t i = 0; i < contours_b.size(); i++ ){
         approxPolyDP( contours_b[i], contours_b_poly[i], 3, true );
-        minEnclosingCircle( contours_b_poly[i], center_b[i], radius_b[i] );
+        camera.rectifiedCircle( contours_b_poly[i], center_b[i], radius_b[i] );
         radius_b[i] = 0.8538*radius_b[i]-4.0814;
     }
 
     for( size_t i = 0; i < contours_b2.size(); i++ ){
         approxPolyDP( contours_b2[i], contours_b_poly2[i], 3, true );
-        minEnclosingCircle( contours_b_poly2[i], center_b2[i], radius_b2[i] );
+        camera2.rectifiedCircle( contours_b_poly2[i], center_b2[i], radius_b2[i] );
         radius_b2[i] = 0.8538*radius_b2[i]-4.0814;
     }
 
     for(size_t i = 0; i < contours_g.size(); i++){
       approxPolyDP(contours_g[i], contours_g_poly[i], 3, true);
-      minEnclosingCircle(contours_g_poly[i], center_g[i], radius_g[i]);
+      camera.rectifiedCircle(contours_g_poly[i], center_g[i], radius_g[i]);
       radius_g[i] = 0.7224*radius_g[i]+1.8049;
     }
 
     for(size_t i = 0; i < contours_g2.size(); i++){
       approxPolyDP(contours_g2[i], contours_g_poly2[i], 3, true);
-      minEnclosingCircle(contours_g_poly2[i], center_g2[i], radius_g2[i]);
+      camera2.rectifiedCircle(contours_g_poly2[i], center_g2[i], radius_g2[i]);
       radius_g2[i] = 0.7224*radius_g2[i]+0.421;
     }
 
@@ -0,0 +1,71 @@
+#ifndef CAMERA_MODEL_H
+#define CAMERA_MODEL_H
+
+#include <vector>
+#include "opencv2/opencv.hpp"
+
+// Pinhole camera with lens distortion, from the intrinsic_data / distortion_data
+// arrays the detectors keep. The rectified image has the same camera matrix, as
+// with cv::undistort, so pixel2point() works unchanged on rectified coordinates.
+//
+// rectify() remaps a whole image through fixed-point (CV_16SC2) tables that are
+// built once per calibration and image size, instead of on every frame as
+// cv::undistort does. When only the balls are needed, rectifyPoints() maps the
+// contour points found in the raw frame, which costs microseconds.
+//
+// Frames need not have the calibration size: for e.g. the 320x240 frames of a
+// "reduced" webcam the camera matrix is scaled down, so the detector works on
+// the frame as it came instead of on an upscaled copy. rectifyPoints() still
+// returns rectified coordinates of the calibration size, where pixel2point()
+// and the pixel size thresholds of the detectors hold.
+class CameraModel
+{
+public:
+  CameraModel() {}
+  CameraModel(const float* intrinsic_data, const float* distortion_data,
+              const cv::Size& calibration_size = cv::Size(640, 480));
+
+  // intrinsic_data : 3x3 row-major, distortion_data : k1 k2 p1 p2 k3, for
+  // calibration_size images
+  void setCalibration(const float* intrinsic_data, const float* distortion_data,
+                      const cv::Size& calibration_size = cv::Size(640, 480));
+
+  const cv::Mat& intrinsic() const { return intrinsic_; }
+  const cv::Mat& distCoeffs() const { return dist_; }
+  const cv::Size& calibrationSize() const { return calibration_size_; }
+
+  // size of the frames the raw points come from, the calibration size until
+  // set. Same aspect ratio as the calibration. rectify() sets it from its input.
+  void setImageSize(const cv::Size& size);
+  const cv::Size& imageSize() const { return image_size_; }
+  // image pixels per calibration pixel
+  double scale() const { return (double)image_size_.width/calibration_size_.width; }
+  // camera matrix scaled to imageSize()
+  const cv::Mat& imageIntrinsic() const { return image_intrinsic_; }
+
+  // same result as undistort(src, dst, <intrinsic() scaled to src>, distCoeffs()),
+  // dst has the size of src and must not be src
+  void rectify(const cv::Mat& src, cv::Mat& dst);
+
+  // raw pixel coordinates of an imageSize() frame to rectified ones of the calibration size
+  void rectifyPoints(const std::vector<cv::Point>& src, std::vector<cv::Point2f>& dst) const;
+  void rectifyPoints(std::vector<cv::Point2f>& points) const;
+
+  // minEnclosingCircle of the rectified points, e.g. of an approxPolyDP contour from the raw frame
+  void rectifiedCircle(const std::vector<cv::Point>& points, cv::Point2f& center, float& radius) const;
+
+  // rectified coordinates and lengths between imageSize() and the calibration size
+  cv::Point2f toCalibration(const cv::Point2f& p) const;
+  float toCalibration(float length) const { return length/scale(); }
+  cv::Point2f toImage(const cv::Point2f& p) const;
+  float toImage(float length) const { return length*scale(); }
+
+private:
+  cv::Mat intrinsic_, dist_;
+  cv::Size calibration_size_;
+  cv::Size image_size_;
+  cv::Mat image_intrinsic_;
+  cv::Mat map1_, map2_;  // built for image_size_, empty until the first rectify()
+};
+
+#endif
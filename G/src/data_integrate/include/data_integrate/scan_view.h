@@ -0,0 +1,83 @@
+#ifndef DATA_INTEGRATE_SCAN_VIEW_H
+#define DATA_INTEGRATE_SCAN_VIEW_H
+
+#include <stddef.h>
+#include <memory>
+#include <vector>
+
+#include "sensor_msgs/LaserScan.h"
+
+namespace scan_view {
+
+/* sin/cos of every beam angle, shared by all scans with the same geometry */
+struct BeamTable {
+  float angle_min;        // [rad]
+  float angle_increment;  // [rad]
+  std::vector<float> cos_a, sin_a;
+
+  BeamTable(float angle_min_, float angle_increment_, size_t size);
+  bool matches(float angle_min_, float angle_increment_, size_t size) const;
+};
+
+/*
+ * Scan : one lidar scan, never modified after ScanView::update() publishes it.
+ * Beams without a valid return have range = INFINITY and x = y = FAR, so the
+ * queries below need no branch to skip them.
+ */
+struct Scan {
+  static const float FAR;   // coordinate [m] given to invalid beams
+
+  double stamp;                         // [s]
+  std::shared_ptr<const BeamTable> beams;
+  std::vector<float> range;             // [m]
+  std::vector<float> x, y;              // [m], x forward, y left
+
+  size_t size() const { return range.size(); }
+  float angle(size_t i) const { return beams->angle_min + beams->angle_increment * i; }
+  float degree(size_t i) const;
+
+  /* beam closest to `rad`, wrapped into the scan; O(1) */
+  size_t index(float rad) const;
+
+  /* beam with the smallest valid range, or 0 if none */
+  size_t nearest() const;
+
+  /* smallest range in the window [from, to] (radians, counter-clockwise, may
+   * wrap through +-pi); INFINITY if every beam there is invalid */
+  float minRange(float from, float to) const;
+
+  /* free space beside the straight path ahead : the closest point with
+   * 0 < x < length on each side of the robot, as lateral distances [m] */
+  void corridor(float length, float& left, float& right) const;
+  float corridorWidth(float length) const;
+
+  /* distance [m] of the closest point to segment (ax,ay)-(bx,by), robot frame;
+   * INFINITY if the scan has no valid beam. *index receives the beam if given */
+  float nearestToSegment(float ax, float ay, float bx, float by, size_t* index = NULL) const;
+};
+
+typedef std::shared_ptr<const Scan> ScanPtr;
+
+/*
+ * ScanView : the lidar callback update()s it, everyone else reads latest().
+ * Each update builds a new Scan and swaps the shared pointer, so a reader
+ * keeps a consistent scan for as long as it holds the pointer, without
+ * copying the ranges or taking a lock around them.
+ */
+class ScanView {
+public:
+  ScanView() {}
+
+  void update(const sensor_msgs::LaserScan& msg);
+
+  /* newest scan, or NULL before the first one */
+  ScanPtr latest() const { return std::atomic_load(&scan_); }
+
+private:
+  std::shared_ptr<const BeamTable> beams_;   // update() side only
+  std::shared_ptr<const Scan> scan_;
+};
+
+}
+
+#endif
@@ -25,6 +25,7 @@
 #include "std_msgs/Int8.h"           // header for using ROS message types of int8 data
 #include "std_msgs/String.h"         // header for using ROS messgae types of string data
 #include "opencv2/opencv.hpp"        // header for using opencv functions
+#include "data_integrate/scan_view.h"   // header for shared lidar scan snapshots and sector queries
 using namespace std;
 
 //******************************************************************/
@@ -35,14 +36,8 @@ using namespace std;
 #define RAD2DEG(x) ((x)*180./M_PI)  // define function that angle changes radian to degree
 #define PORT 3000    // varaible for Network byte that used in callback function
 #define IPADDR "172.16.0.1" // myRIO ipaddress
-boost::mutex map_mutex;  // variable for using in callback function
-
-int lidar_size;            // size of lidar data array
-float lidar_degree[400];   // angle datas of lidar (unit:degree)
-float lidar_distance[400]; // distance datas from lidar to walls (unit:mm)
-float lidar_zero_degree;   // distnace data that robot angle is zero (unit:mm)
-int zero_degree;           // index of lidar_degree that is zero in absolute coordinate system
-int least_distance;        // index of lidar_distance that
+scan_view::ScanView lidar_view; // newest lidar scan, shared without copying (unit:m, rad)
+float lidar_zero_degree;   // distnace data that robot angle is zero (unit:m)
 
 int blue_number;           // number of blue ball
 int red_number;            // number of red ball
@@ -70,7 +65,7 @@ float data[24];            // signal from xbox
 
 int check = 0;             // variable for checker function
 
-int corners[4];            // index of lidar_degree that is angle of corner of walls 
+int corners[4];            // beam index of the corners of walls in the scan find_corners() looked at
 
 //********************************************************************/
 
@@ -166,6 +161,13 @@ void move_backward(float distance){
   ros::Duration(0.3).sleep();
 }
 
+//angle of the nearest wall point in degree, 0 before the first scan
+float nearest_degree(){
+  scan_view::ScanPtr scan = lidar_view.latest();
+  if(!scan || !scan->size()) return 0;
+  return scan->degree(scan->nearest());
+}
+
 //We do not use
 void turn_lidar(float angle, int direction){//direction = 1 좌회전, direction = 0 우회전 1
   ros::spinOnce();
@@ -173,15 +175,15 @@ void turn_lidar(float angle, int direction){//direction = 1 좌회전, direction
     turn_lidar(angle/2,direction);
     turn_lidar(angle/2,direction);
   }
-  float initial_angle = lidar_degree[least_distance];
-  float moved_angle = lidar_degree[least_distance] - initial_angle;
+  float initial_angle = nearest_degree();
+  float moved_angle = nearest_degree() - initial_angle;
   while(abs(moved_angle)<angle){
     ros::spinOnce();
     dataInit();
     data[15+direction] = 1;
     write(c_socket,data,sizeof(data));
 
-    moved_angle = lidar_degree[least_distance] - initial_angle;
+    moved_angle = nearest_degree() - initial_angle;
     if(abs(moved_angle)>180){
       if(moved_angle<0){
         moved_angle = moved_angle + 180;
@@ -515,26 +517,26 @@ int checker() {//See if near ball is close enough and return 1 if it's close eno
 /*****************************************************3차적인 함수들 (Return to Base)*******************************************************/
 
 //This function find four corners and store degree and distance value from -180 degree to 180 degree
-void find_corners() {
-	ros::spinOnce();
+void find_corners(const scan_view::Scan& scan) {
 	int corner_num = 0;
+	int lidar_size = scan.size();
 
 	for (int i = 0; i < lidar_size; i++) {
-		if (isinf(lidar_distance[i])) continue;//if corresponding distance value is null value, lidar returns infinite value, so we need to neglect such value.
+		if (isinf(scan.range[i])) continue;//if corresponding distance value is null value, lidar returns infinite value, so we need to neglect such value.
 		float differenceSum = 0;//To check the corresponding angle is corner angle, we need to sum up differences
 		for (int j = i - 25; j < i + 25; j++) {//check for +-25 degree to seek corners
-			if (isinf(lidar_distance[j])) {//if corresponding distance value is null value, lidar returns infinite value, so we need to neglect such value.
-				continue;
-			}
 			int k = j;
 			if (j < 0) k = lidar_size + j;//if the value is smaller than 0, its real value is 180 - value.
-			if (j > lidar_size) k = j - lidar_size;//vise versa
-			differenceSum = differenceSum + 1 - lidar_distance[k] / lidar_distance[i];//Sum up all differences
+			if (j >= lidar_size) k = j - lidar_size;//vise versa
+			if (isinf(scan.range[k])) {//if corresponding distance value is null value, lidar returns infinite value, so we need to neglect such value.
+				continue;
+			}
+			differenceSum = differenceSum + 1 - scan.range[k] / scan.range[i];//Sum up all differences
 		}
 		if (differenceSum > 1.0) {//if the difference sum is larger than certain value, it means there's corner-like region.
 			corners[corner_num] = i;
-			//cout<<"corner"<<corner_num+1<<" angle is "<<lidar_degree[corners[corner_num]]<<endl;
-			//cout<<"corner"<<corner_num+1<<" distance is "<<lidar_distance[corners[corner_num]]<<endl;
+			//cout<<"corner"<<corner_num+1<<" angle is "<<scan.degree(corners[corner_num])<<endl;
+			//cout<<"corner"<<corner_num+1<<" distance is "<<scan.range[corners[corner_num]]<<endl;
 			corner_num++;
 			i = i + 20;//if corner is detected, it means there's no corner in +-20 degree.
 		}
@@ -546,7 +548,11 @@ void find_corners() {
 }
 
 float find_goal() {//return goal's angle in degree.
-	find_corners();//before finding goal, update corner's position
+	ros::spinOnce();
+	scan_view::ScanPtr scan = lidar_view.latest();//corners and angles below all come from this one scan
+	if (!scan) return 0;
+	const std::vector<float>& lidar_distance = scan->range;
+	find_corners(*scan);//before finding goal, update corner's position
 	int farthest = 0;
 
 	//initialize values.
@@ -571,17 +577,17 @@ float find_goal() {//return goal's angle in degree.
 	else if (farthest == corners[0]) partner2 = 3;
 
 	//Need to get angle between farthest and partner and partners' distance.
-	angle_partner1 = (lidar_degree[corners[partner1]] - lidar_degree[corners[farthest]]) * M_PI / 180;
+	angle_partner1 = (scan->degree(corners[partner1]) - scan->degree(corners[farthest])) * M_PI / 180;
 	partner1_distance = lidar_distance[corners[partner1]];
-	angle_partner2 = (lidar_degree[corners[farthest]] - lidar_degree[corners[partner2]]) * M_PI / 180;
+	angle_partner2 = (scan->degree(corners[farthest]) - scan->degree(corners[partner2])) * M_PI / 180;
 	partner2_distance = lidar_distance[corners[partner2]];
 
 	//partner angle exceptional cases. if partner and farthest is located at boundaries.
-	if (abs(lidar_degree[corners[partner1]]) + abs(lidar_degree[corners[farthest]]) > 180 && lidar_degree[corners[partner1]] * lidar_degree[corners[farthest]] < 0) {
-		angle_partner1 = 360 - (abs(lidar_degree[corners[partner1]]) + abs(lidar_degree[corners[farthest]])) * M_PI / 180;
+	if (abs(scan->degree(corners[partner1])) + abs(scan->degree(corners[farthest])) > 180 && scan->degree(corners[partner1]) * scan->degree(corners[farthest]) < 0) {
+		angle_partner1 = 360 - (abs(scan->degree(corners[partner1])) + abs(scan->degree(corners[farthest]))) * M_PI / 180;
 	}
-	if (abs(lidar_degree[corners[partner2]]) + abs(lidar_degree[corners[farthest]]) > 180 && lidar_degree[corners[partner2]] * lidar_degree[corners[farthest]] < 0) {
-		angle_partner2 = 360 - (abs(lidar_degree[corners[partner2]]) + abs(lidar_degree[corners[farthest]])) * M_PI / 180;
+	if (abs(scan->degree(corners[partner2])) + abs(scan->degree(corners[farthest])) > 180 && scan->degree(corners[partner2]) * scan->degree(corners[farthest]) < 0) {
+		angle_partner2 = 360 - (abs(scan->degree(corners[partner2])) + abs(scan->degree(corners[farthest]))) * M_PI / 180;
 	}
 
 	//calculate square of sides and substract each other to compare which one is smaller.
@@ -593,10 +599,10 @@ float find_goal() {//return goal's angle in degree.
 	else {
 		real_partner = partner2;
 	}
-	float ans = (lidar_degree[corners[farthest]] + lidar_degree[corners[real_partner]]) / 2;//value to return.
+	float ans = (scan->degree(corners[farthest]) + scan->degree(corners[real_partner])) / 2;//value to return.
 
 	//if answer value is extreme cases, we need to calibrate.
-	if (abs(lidar_degree[corners[farthest]]) + abs(lidar_degree[corners[real_partner]]) > 180 && lidar_degree[corners[farthest]] * lidar_degree[corners[real_partner]] < 0) {
+	if (abs(scan->degree(corners[farthest])) + abs(scan->degree(corners[real_partner])) > 180 && scan->degree(corners[farthest]) * scan->degree(corners[real_partner]) < 0) {
 		if (ans < 0) return 180 + ans;
 		else return -180 + ans;
 	}
@@ -820,25 +826,13 @@ void camera_Callback(const core_msgs::ball_position::ConstPtr& position)
 
 void lidar_Callback(const sensor_msgs::LaserScan::ConstPtr& scan)
 {
-  map_mutex.lock();  // protect collision of two callback functions
-  int count = scan->scan_time / scan->time_increment; // compute lidar size by scan message
-  lidar_size=count;  // put size of lidar angle data
-  zero_degree = 0;   // initialize zero_degree
-  least_distance = 0;  // initialize least_distance 
-  for(int i = 0; i < count; i++)
-    {
-      lidar_degree[i] = RAD2DEG(scan->angle_min + scan->angle_increment * i);  // put real angle of robot that unit is degree
-      if(static_cast<int>(lidar_degree[i]+0.5) == 0){zero_degree = i;}  // check that the angle is zero
-      lidar_distance[i]=scan->ranges[i];  // put distances of robot at each angles
-      if(lidar_distance[i]<lidar_distance[least_distance]){least_distance = i;}  // put the least distance of robot
-    }
-  if(isinf(scan->ranges[zero_degree])){   // check range is infinite
-    lidar_zero_degree = lidar_zero_degree; 
-  }
-  else{
-    lidar_zero_degree = scan->ranges[zero_degree];  // put the distance of robot when is zero
+  lidar_view.update(*scan);  // publish the scan as a new snapshot, readers keep theirs
+  scan_view::ScanPtr view = lidar_view.latest();
+  if(!view->size()) return;
+  float zero_range = view->range[view->index(0)];  // distance of robot when angle is zero
+  if(!isinf(zero_range)){   // keep the last valid value when range is infinite
+    lidar_zero_degree = zero_range;
   }
-  map_mutex.unlock();
 }
 
 int main(int argc, char **argv){
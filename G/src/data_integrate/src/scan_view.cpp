@@ -0,0 +1,218 @@
+#include "data_integrate/scan_view.h"
+
+#include <algorithm>
+#include <math.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace scan_view {
+
+const float Scan::FAR = 1e6f;
+
+namespace {
+
+/* smallest of p[0..n) */
+float min_of(const float* p, size_t n)
+{
+  float m = INFINITY;
+  size_t i = 0;
+#ifdef __SSE2__
+  __m128 vm = _mm_set1_ps(INFINITY);
+  for(; i + 4 <= n; i += 4)
+    vm = _mm_min_ps(vm, _mm_loadu_ps(p + i));
+  float lanes[4];
+  _mm_storeu_ps(lanes, vm);
+  m = std::min(std::min(lanes[0], lanes[1]), std::min(lanes[2], lanes[3]));
+#endif
+  for(; i < n; i++)
+    m = std::min(m, p[i]);
+  return m;
+}
+
+}
+
+BeamTable::BeamTable(float angle_min_, float angle_increment_, size_t size)
+  : angle_min(angle_min_)
+  , angle_increment(angle_increment_)
+  , cos_a(size)
+  , sin_a(size)
+{
+  for(size_t i=0; i<size; i++) {
+    double a = angle_min + (double) angle_increment * i;
+    cos_a[i] = (float) cos(a);
+    sin_a[i] = (float) sin(a);
+  }
+}
+
+bool BeamTable::matches(float angle_min_, float angle_increment_, size_t size) const
+{
+  return angle_min == angle_min_ && angle_increment == angle_increment_ && cos_a.size() == size;
+}
+
+float Scan::degree(size_t i) const
+{
+  return angle(i) * (float) (180. / M_PI);
+}
+
+size_t Scan::index(float rad) const
+{
+  long n = (long) size();
+  if(!n) return 0;
+  long i = lround((rad - beams->angle_min) / beams->angle_increment);
+  i %= n;
+  if(i < 0) i += n;
+  return (size_t) i;
+}
+
+size_t Scan::nearest() const
+{
+  float m = min_of(range.data(), size());
+  for(size_t i=0; i<size(); i++)
+    if(range[i] == m) return i;
+  return 0;
+}
+
+float Scan::minRange(float from, float to) const
+{
+  if(!size()) return INFINITY;
+  size_t a = index(from);
+  size_t b = index(to);
+  if(a <= b)
+    return min_of(&range[a], b - a + 1);
+  return std::min(min_of(&range[a], size() - a), min_of(&range[0], b + 1));
+}
+
+void Scan::corridor(float length, float& left, float& right) const
+{
+  const size_t n = size();
+  const float* px = x.data();
+  const float* py = y.data();
+  left = right = INFINITY;
+  size_t i = 0;
+
+#ifdef __SSE2__
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 len = _mm_set1_ps(length);
+  const __m128 inf = _mm_set1_ps(INFINITY);
+  __m128 vl = inf, vr = inf;
+  for(; i + 4 <= n; i += 4) {
+    __m128 vx = _mm_loadu_ps(px + i);
+    __m128 vy = _mm_loadu_ps(py + i);
+    __m128 ahead = _mm_and_ps(_mm_cmpgt_ps(vx, zero), _mm_cmplt_ps(vx, len));
+    __m128 is_left = _mm_and_ps(ahead, _mm_cmpge_ps(vy, zero));
+    __m128 is_right = _mm_andnot_ps(_mm_cmpge_ps(vy, zero), ahead);
+    /* lanes outside the corridor side become +inf */
+    vl = _mm_min_ps(vl, _mm_or_ps(_mm_and_ps(is_left, vy), _mm_andnot_ps(is_left, inf)));
+    vr = _mm_min_ps(vr, _mm_or_ps(_mm_and_ps(is_right, _mm_sub_ps(zero, vy)), _mm_andnot_ps(is_right, inf)));
+  }
+  float lanes[4];
+  _mm_storeu_ps(lanes, vl);
+  left = std::min(std::min(lanes[0], lanes[1]), std::min(lanes[2], lanes[3]));
+  _mm_storeu_ps(lanes, vr);
+  right = std::min(std::min(lanes[0], lanes[1]), std::min(lanes[2], lanes[3]));
+#endif
+
+  for(; i < n; i++) {
+    if(px[i] <= 0 || px[i] >= length) continue;
+    if(py[i] >= 0) left = std::min(left, py[i]);
+    else right = std::min(right, -py[i]);
+  }
+}
+
+float Scan::corridorWidth(float length) const
+{
+  float left, right;
+  corridor(length, left, right);
+  return left + right;
+}
+
+float Scan::nearestToSegment(float ax, float ay, float bx, float by, size_t* index) const
+{
+  const size_t n = size();
+  const float* px = x.data();
+  const float* py = y.data();
+  const float dx = bx - ax, dy = by - ay;
+  const float len2 = dx*dx + dy*dy;
+  const float inv_len2 = (len2 > 0) ? 1.0f / len2 : 0.0f;
+
+  float best = INFINITY;
+  size_t best_i = 0;
+  size_t i = 0;
+
+#ifdef __SSE2__
+  const __m128 vax = _mm_set1_ps(ax), vay = _mm_set1_ps(ay);
+  const __m128 vdx = _mm_set1_ps(dx), vdy = _mm_set1_ps(dy);
+  const __m128 vinv = _mm_set1_ps(inv_len2);
+  const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+  __m128 vbest = _mm_set1_ps(INFINITY);
+  __m128i vbest_i = _mm_setzero_si128();
+  __m128i vi = _mm_setr_epi32(0, 1, 2, 3);
+  const __m128i four = _mm_set1_epi32(4);
+
+  for(; i + 4 <= n; i += 4, vi = _mm_add_epi32(vi, four)) {
+    __m128 rx = _mm_sub_ps(_mm_loadu_ps(px + i), vax);
+    __m128 ry = _mm_sub_ps(_mm_loadu_ps(py + i), vay);
+    __m128 t = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(rx, vdx), _mm_mul_ps(ry, vdy)), vinv);
+    t = _mm_min_ps(_mm_max_ps(t, zero), one);
+    __m128 ex = _mm_sub_ps(rx, _mm_mul_ps(t, vdx));
+    __m128 ey = _mm_sub_ps(ry, _mm_mul_ps(t, vdy));
+    __m128 d2 = _mm_add_ps(_mm_mul_ps(ex, ex), _mm_mul_ps(ey, ey));
+
+    __m128 closer = _mm_cmplt_ps(d2, vbest);
+    __m128i ci = _mm_castps_si128(closer);
+    vbest = _mm_min_ps(vbest, d2);
+    vbest_i = _mm_or_si128(_mm_and_si128(ci, vi), _mm_andnot_si128(ci, vbest_i));
+  }
+
+  float lanes[4];
+  int lane_i[4];
+  _mm_storeu_ps(lanes, vbest);
+  _mm_storeu_si128((__m128i*) lane_i, vbest_i);
+  for(int k=0; k<4; k++) {
+    if(lanes[k] < best || (lanes[k] == best && (size_t) lane_i[k] < best_i)) {
+      best = lanes[k];
+      best_i = (size_t) lane_i[k];
+    }
+  }
+#endif
+
+  for(; i < n; i++) {
+    float rx = px[i] - ax, ry = py[i] - ay;
+    float t = std::min(std::max((rx*dx + ry*dy) * inv_len2, 0.0f), 1.0f);
+    float ex = rx - t*dx, ey = ry - t*dy;
+    float d2 = ex*ex + ey*ey;
+    if(d2 < best) { best = d2; best_i = i; }
+  }
+
+  if(index) *index = best_i;
+  /* invalid beams sit at FAR; a closest point that far means nothing valid */
+  return (best >= Scan::FAR * Scan::FAR * 0.25f) ? INFINITY : sqrtf(best);
+}
+
+void ScanView::update(const sensor_msgs::LaserScan& msg)
+{
+  const size_t n = msg.ranges.size();   // not scan_time / time_increment
+  if(!beams_ || !beams_->matches(msg.angle_min, msg.angle_increment, n))
+    beams_ = std::make_shared<BeamTable>(msg.angle_min, msg.angle_increment, n);
+
+  std::shared_ptr<Scan> scan = std::make_shared<Scan>();
+  scan->stamp = msg.header.stamp.toSec();
+  scan->beams = beams_;
+  scan->range.resize(n);
+  scan->x.resize(n);
+  scan->y.resize(n);
+
+  for(size_t i=0; i<n; i++) {
+    float r = msg.ranges[i];
+    bool valid = isfinite(r) && r >= msg.range_min && r <= msg.range_max;
+    scan->range[i] = valid ? r : INFINITY;
+    scan->x[i] = valid ? r * beams_->cos_a[i] : Scan::FAR;
+    scan->y[i] = valid ? r * beams_->sin_a[i] : Scan::FAR;
+  }
+
+  std::atomic_store(&scan_, std::shared_ptr<const Scan>(scan));
+}
+
+}
@@ -135,11 +135,7 @@ void lidar_cb(sensor_msgs::LaserScan msg){ //call back function
 
         pos[0] = transMtx_now(0,3); // 현재의 transformation matrix의 1행 4열 요소가 x position을 의미하고, 2행 4열 요소가 y position을 의미한다.
         pos[1] = transMtx_now(1,3);
-        if(transMtx_now(1,0)>=0){   // 1행 1열 요소가 cos(theta) 정보를 갖는데, 함수 acos가 항상 양의 값을 리턴해 sin(theta)의 음양을 통해 theta의 올바른 부호를 결정.
-          pos[2] = abs(acos(transMtx_now(0,0)));
-        }else{
-          pos[2] = -abs(acos(transMtx_now(0,0)));
-        }
+        pos[2] = atan2(transMtx_now(1,0), transMtx_now(0,0)); // 2행 1열(sin)과 1행 1열(cos)을 함께 써서 theta의 부호와 크기를 한 번에 결정. acos는 반올림된 cos가 1을 넘으면 nan이 된다.
 
         // TO DO END
 
@@ -0,0 +1,172 @@
+#include "ball_detector.h"
+
+#include <math.h>
+#include <sstream>
+#include <string>
+#include <opencv2/imgproc/imgproc.hpp>
+
+using namespace std;
+using namespace cv;
+
+namespace ball_track {
+
+// row -> distance fits of the two cameras, measured on the field
+static float frontDepth(float y)
+{
+  return 0.000006*pow(y,2)-0.005*y+1.2548;
+}
+
+static float topDepth(float y)
+{
+  return pow(y,-1.653)*10945;
+}
+
+DetectorConfig frontCamera()
+{
+  DetectorConfig c = {
+    {0, 195, 50, 15, 255, 255},     // red
+    {155, 195, 50, 180, 255, 255},  // red, around hue 180
+    {90, 120, 70, 113, 255, 255},   // blue
+    {30, 75, 80, 80, 255, 255},     // green
+    {625.65, 0, 323.54, 0, 631.2, 254.9, 0, 0, 1},
+    {0.06263, -0.24675, 0.011155, 0.005235, 0},
+    0.074,
+    25,
+    15, 605,
+    true,
+    frontDepth
+  };
+  return c;
+}
+
+DetectorConfig topCamera()
+{
+  DetectorConfig c = {
+    {0, 195, 50, 15, 255, 255},
+    {155, 195, 50, 180, 255, 255},
+    {90, 160, 70, 113, 255, 255},
+    {40, 75, 80, 80, 255, 255},
+    {646.25, 0, 321.3, 0, 650, 245.45, 0, 0, 1},
+    {0.09667, -0.26965, -0.000857, 0, 0},
+    0.076,
+    6,
+    -1, 1e6,  // no limit
+    false,
+    topDepth
+  };
+  return c;
+}
+
+void morphOps(Mat& thresh)
+{
+  //the element chosen here is a 3px by 3px rectangle
+  static const Mat erodeElement = getStructuringElement(MORPH_RECT, Size(3,3));
+  //dilate with larger element so make sure object is nicely visible
+  static const Mat dilateElement = getStructuringElement(MORPH_RECT, Size(8,8));
+  erode(thresh, thresh, erodeElement);
+  erode(thresh, thresh, erodeElement);
+  dilate(thresh, thresh, dilateElement);
+  dilate(thresh, thresh, dilateElement);
+}
+
+static string floatToString(float f)
+{
+  ostringstream buffer;
+  buffer << f;
+  return buffer.str();
+}
+
+static void inRange(const Mat& hsv, const HsvRange& r, Mat& mask)
+{
+  cv::inRange(hsv, Scalar(r.low_h, r.low_s, r.low_v), Scalar(r.high_h, r.high_s, r.high_v), mask);
+}
+
+BallDetector::BallDetector(const DetectorConfig& config)
+  : config_(config)
+{
+  intrinsic_ = Mat(3, 3, CV_32F, config_.intrinsic).clone();
+  dist_ = Mat(1, 5, CV_32F, config_.distortion).clone();
+}
+
+void BallDetector::detect(const Mat& frame, Mat* result)
+{
+  undistort(frame, calibrated_, intrinsic_, dist_);
+  if (result) calibrated_.copyTo(*result);
+
+  medianBlur(calibrated_, calibrated_, 3);
+  cvtColor(calibrated_, hsv_, COLOR_BGR2HSV);
+
+  inRange(hsv_, config_.red, mask_);
+  inRange(hsv_, config_.red2, mask2_);
+  addWeighted(mask_, 1.0, mask2_, 1.0, 0.0, mask_);
+  findBalls(mask_, RED, red_, result);
+
+  inRange(hsv_, config_.blue, mask_);
+  findBalls(mask_, BLUE, blue_, result);
+
+  inRange(hsv_, config_.green, mask_);
+  findBalls(mask_, GREEN, green_, result);
+}
+
+void BallDetector::findBalls(Mat& mask, Color color, vector<Point3f>& balls, Mat* result)
+{
+  balls.clear();
+
+  morphOps(mask);
+  GaussianBlur(mask, blur_, Size(9, 9), 2, 2);
+  Canny(blur_, edges_, 100, 300, 3);
+  findContours(edges_, contours_, hierarchy_, RETR_CCOMP, CHAIN_APPROX_SIMPLE, Point(0, 0));
+
+  poly_.resize(contours_.size());
+  center_.resize(contours_.size());
+  radius_.resize(contours_.size());
+  for (size_t i = 0; i < contours_.size(); i++) {
+    approxPolyDP(contours_[i], poly_[i], 3, true);
+    minEnclosingCircle(poly_[i], center_[i], radius_[i]);
+  }
+
+  for (size_t i = 0; i < contours_.size(); i++) {
+    if (radius_[i] <= config_.min_radius) continue;
+    // circles cut by the side of the screen are mostly errors
+    if (color != GREEN && (center_[i].x <= config_.x_min || center_[i].x >= config_.x_max)) continue;
+
+    Point3f ball = pixel2point(center_[i], radius_[i]);
+    if (config_.check_size && color != RED) {
+      // the distance the radius predicts must agree with the one from the row within 30cm
+      float pixel = 0.0002*pow(radius_[i],2)-0.0362*radius_[i]+1.766;
+      if (pixel - ball.z >= 0.3) continue;
+    }
+    balls.push_back(ball);
+
+    if (result) {
+      Scalar bgr = (color == RED) ? Scalar(0, 0, 255) : (color == BLUE) ? Scalar(255, 0, 0) : Scalar(0, 255, 0);
+      const char* name = (color == RED) ? "Red" : (color == BLUE) ? "Blue" : "Green";
+      string text = string(name) + " ball:" + floatToString(ball.x) + "," + floatToString(ball.y) + "," + floatToString(ball.z);
+      putText(*result, text, center_[i], 2, 1, Scalar(0, 255, 0), 2);
+      circle(*result, center_[i], (int)radius_[i], bgr, 2, 8, 0);
+    }
+
+    // the outer and inner edge of one ball give two circles; skip the second
+    if (i + 1 < contours_.size() && norm(center_[i] - center_[i+1]) < radius_[i]) i++;
+  }
+}
+
+// calculate real distance using calibration.
+Point3f BallDetector::pixel2point(Point center, int radius) const
+{
+  const float* intrinsic_data = config_.intrinsic;
+  float x, y, u, v, Xc, Yc, Zc;
+  x = center.x;
+  y = center.y;
+  u = (x-intrinsic_data[2])/intrinsic_data[0];
+  v = (y-intrinsic_data[5])/intrinsic_data[4];
+
+  Zc = (intrinsic_data[0]*config_.ball_radius)/(2*(float)radius);
+  Xc = u*Zc;
+  Yc = v*Zc;
+  Xc = roundf(Xc * 1000) / 1000;
+  Yc = roundf(Yc * 1000) / 1000;
+  return Point3f(Xc, Yc, config_.depth(y));
+}
+
+}
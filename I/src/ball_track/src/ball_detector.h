@@ -0,0 +1,89 @@
+#ifndef BALL_TRACK_BALL_DETECTOR_H
+#define BALL_TRACK_BALL_DETECTOR_H
+
+#include <vector>
+#include <opencv2/core/core.hpp>
+
+namespace ball_track {
+
+struct HsvRange {
+  int low_h, low_s, low_v;
+  int high_h, high_s, high_v;
+};
+
+// Everything that differs between the cameras ball_track looks through.
+struct DetectorConfig {
+  HsvRange red, red2, blue, green;  // red wraps around hue 180, so it takes two ranges
+  float intrinsic[9];               // 3x3 row-major
+  float distortion[5];              // k1 k2 p1 p2 k3
+  float ball_radius;                // [m]
+  int min_radius;                   // [px] smaller circles are noise
+  float x_min, x_max;               // [px] red and blue centres outside (x_min, x_max) are dropped
+  bool check_size;                  // drop blue and green balls whose radius does not fit their depth
+  float (*depth)(float y);          // [m] distance of a ball whose centre is on image row y
+};
+
+DetectorConfig frontCamera();  // ball_track_node, camera 0
+DetectorConfig topCamera();    // ball_track_top_node, camera 2
+
+// erode the noise away, then dilate so that the balls are nicely visible again
+void morphOps(cv::Mat& thresh);
+
+// Finds the red, blue and green balls in a BGR frame. All three colours are
+// segmented from one HSV conversion of the frame, and the frame itself is only
+// read, so it can be an image shared with other detectors.
+class BallDetector {
+public:
+  explicit BallDetector(const DetectorConfig& config);
+
+  // result, if given, gets the rectified frame with the balls drawn on it
+  void detect(const cv::Mat& frame, cv::Mat* result = NULL);
+
+  // ball positions (x, y, depth) [m] of the last detect()
+  const std::vector<cv::Point3f>& red() const { return red_; }
+  const std::vector<cv::Point3f>& blue() const { return blue_; }
+  const std::vector<cv::Point3f>& green() const { return green_; }
+
+  // core_msgs::ball_position or core_msgs::ball_position_top
+  template <class Msg>
+  void fill(Msg& msg) const {
+    fill(red_, msg.size_r, msg.img_x_r, msg.img_y_r, msg.img_z_r);
+    fill(blue_, msg.size_b, msg.img_x_b, msg.img_y_b, msg.img_z_b);
+    fill(green_, msg.size_g, msg.img_x_g, msg.img_y_g, msg.img_z_g);
+  }
+
+private:
+  enum Color { RED, BLUE, GREEN };
+
+  void findBalls(cv::Mat& mask, Color color, std::vector<cv::Point3f>& balls, cv::Mat* result);
+  cv::Point3f pixel2point(cv::Point center, int radius) const;
+
+  template <class Size, class Array>
+  static void fill(const std::vector<cv::Point3f>& balls, Size& size, Array& x, Array& y, Array& z) {
+    size = balls.size();
+    x.resize(balls.size());
+    y.resize(balls.size());
+    z.resize(balls.size());
+    for (size_t i = 0; i < balls.size(); i++) {
+      x[i] = balls[i].x;
+      y[i] = balls[i].y;
+      z[i] = balls[i].z;
+    }
+  }
+
+  DetectorConfig config_;
+  cv::Mat intrinsic_, dist_;
+
+  // per frame buffers, kept so that their memory is reused
+  cv::Mat calibrated_, hsv_, mask_, mask2_, blur_, edges_;
+  std::vector<std::vector<cv::Point> > contours_, poly_;
+  std::vector<cv::Vec4i> hierarchy_;
+  std::vector<cv::Point2f> center_;
+  std::vector<float> radius_;
+
+  std::vector<cv::Point3f> red_, blue_, green_;
+};
+
+}
+
+#endif
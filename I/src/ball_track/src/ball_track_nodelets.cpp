@@ -0,0 +1,121 @@
+#include <string>
+#include <boost/make_shared.hpp>
+#include <nodelet/nodelet.h>
+#include <pluginlib/class_list_macros.h>
+#include <image_transport/image_transport.h>
+#include <cv_bridge/cv_bridge.h>
+#include <sensor_msgs/image_encodings.h>
+#include "core_msgs/ball_position.h"
+#include "core_msgs/ball_position_top.h"
+#include "core_msgs/roller_num.h"
+
+#include "ball_detector.h"
+#include "roller_counter.h"
+
+namespace ball_track {
+
+/// Runs a detector on the frames of "image". In the manager of the webcam
+/// nodelet a frame arrives as the publisher's ImageConstPtr and toCvShare only
+/// wraps it, so every detector subscribed to one camera reads the same decoded
+/// frame, without serialization or copies. The rectified frame with the balls
+/// drawn on it is published on ~result, and only made while someone watches.
+template <class Msg>
+class DetectorNodelet : public nodelet::Nodelet
+{
+protected:
+  explicit DetectorNodelet(const std::string& topic) : topic_(topic) {}
+
+  virtual void detect(const cv::Mat& frame, Msg& msg, cv::Mat* result) = 0;
+
+private:
+  virtual void onInit()
+  {
+    ros::NodeHandle& nh = getNodeHandle();
+    image_transport::ImageTransport it(nh);
+    image_transport::ImageTransport it_private(getPrivateNodeHandle());
+
+    pub_ = nh.advertise<Msg>(topic_, 100);
+    result_pub_ = it_private.advertise("result", 1);
+    // only the newest frame is worth detecting on
+    sub_ = it.subscribe("image", 1, &DetectorNodelet::imageCallback, this);
+  }
+
+  void imageCallback(const sensor_msgs::ImageConstPtr& image)
+  {
+    cv_bridge::CvImageConstPtr frame;
+    try {
+      frame = cv_bridge::toCvShare(image, sensor_msgs::image_encodings::BGR8);
+    }
+    catch (cv_bridge::Exception& e) {
+      NODELET_ERROR_THROTTLE(1, "cv_bridge exception: %s", e.what());
+      return;
+    }
+
+    bool draw = result_pub_.getNumSubscribers() > 0;
+    boost::shared_ptr<Msg> msg = boost::make_shared<Msg>();
+    msg->header = image->header;
+    detect(frame->image, *msg, draw ? &result_ : NULL);
+    pub_.publish(msg);
+
+    if (draw) result_pub_.publish(cv_bridge::CvImage(image->header, sensor_msgs::image_encodings::BGR8, result_).toImageMsg());
+  }
+
+  std::string topic_;
+  ros::Publisher pub_;
+  image_transport::Publisher result_pub_;
+  image_transport::Subscriber sub_;
+  cv::Mat result_;
+};
+
+/// ball_track_node as a nodelet, publishes /position
+class BallTrackNodelet : public DetectorNodelet<core_msgs::ball_position>
+{
+public:
+  BallTrackNodelet() : DetectorNodelet<core_msgs::ball_position>("/position"), detector_(frontCamera()) {}
+
+private:
+  virtual void detect(const cv::Mat& frame, core_msgs::ball_position& msg, cv::Mat* result)
+  {
+    detector_.detect(frame, result);
+    detector_.fill(msg);
+  }
+
+  BallDetector detector_;
+};
+
+/// ball_track_top_node as a nodelet, publishes /position_top
+class BallTrackTopNodelet : public DetectorNodelet<core_msgs::ball_position_top>
+{
+public:
+  BallTrackTopNodelet() : DetectorNodelet<core_msgs::ball_position_top>("/position_top"), detector_(topCamera()) {}
+
+private:
+  virtual void detect(const cv::Mat& frame, core_msgs::ball_position_top& msg, cv::Mat* result)
+  {
+    detector_.detect(frame, result);
+    detector_.fill(msg);
+  }
+
+  BallDetector detector_;
+};
+
+/// ball_roller_node as a nodelet, publishes /roller_num
+class RollerNodelet : public DetectorNodelet<core_msgs::roller_num>
+{
+public:
+  RollerNodelet() : DetectorNodelet<core_msgs::roller_num>("/roller_num") {}
+
+private:
+  virtual void detect(const cv::Mat& frame, core_msgs::roller_num& msg, cv::Mat* result)
+  {
+    msg.size_b = counter_.count(frame, result);
+  }
+
+  RollerCounter counter_;
+};
+
+}
+
+PLUGINLIB_EXPORT_CLASS(ball_track::BallTrackNodelet, nodelet::Nodelet)
+PLUGINLIB_EXPORT_CLASS(ball_track::BallTrackTopNodelet, nodelet::Nodelet)
+PLUGINLIB_EXPORT_CLASS(ball_track::RollerNodelet, nodelet::Nodelet)
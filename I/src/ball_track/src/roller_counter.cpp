@@ -0,0 +1,57 @@
+#include "roller_counter.h"
+
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "ball_detector.h"
+
+using namespace std;
+using namespace cv;
+
+namespace ball_track {
+
+static float intrinsic_data[9] = {646.25, 0, 321.3, 0, 650, 245.45, 0, 0, 1};
+static float distortion_data[5] = {0.09667, -0.26965, -0.000857, 0, 0};
+
+static const int low_h_b=90, low_s_b=100, low_v_b=85;
+static const int high_h_b=120, high_s_b=255, high_v_b=255;
+
+static const float three_balls_radius = 191;  // [px]
+
+RollerCounter::RollerCounter()
+{
+  intrinsic_ = Mat(3, 3, CV_32F, intrinsic_data).clone();
+  dist_ = Mat(1, 5, CV_32F, distortion_data).clone();
+}
+
+int RollerCounter::count(const Mat& frame, Mat* result)
+{
+  undistort(frame, calibrated_, intrinsic_, dist_);
+  if (result) calibrated_.copyTo(*result);
+
+  medianBlur(calibrated_, calibrated_, 3);
+  cvtColor(calibrated_, hsv_, COLOR_BGR2HSV);
+  inRange(hsv_, Scalar(low_h_b,low_s_b,low_v_b), Scalar(high_h_b,high_s_b,high_v_b), mask_);
+  morphOps(mask_);
+  GaussianBlur(mask_, blur_, Size(9, 9), 2, 2);
+  Canny(blur_, edges_, 100, 300, 3);
+  findContours(edges_, contours_, hierarchy_, RETR_CCOMP, CHAIN_APPROX_SIMPLE, Point(0, 0));
+
+  poly_.resize(contours_.size());
+  int num = 0;
+  for (size_t i = 0; i < contours_.size(); i++) {
+    Point2f center;
+    float radius;
+    approxPolyDP(contours_[i], poly_[i], 3, true);
+    minEnclosingCircle(poly_[i], center, radius);
+    if (radius <= three_balls_radius) continue;
+
+    num = 1;
+    if (result) {
+      drawContours(*result, poly_, (int)i, Scalar(255, 0, 0), 1, 8, vector<Vec4i>(), 0, Point());
+      putText(*result, "3 balls", Point(230, 250), 2, 3, Scalar(0, 0, 255), 2);
+    }
+  }
+  return num;
+}
+
+}
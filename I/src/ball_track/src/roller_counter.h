@@ -0,0 +1,31 @@
+#ifndef BALL_TRACK_ROLLER_COUNTER_H
+#define BALL_TRACK_ROLLER_COUNTER_H
+
+#include <vector>
+#include <opencv2/core/core.hpp>
+
+namespace ball_track {
+
+// Looks at the blue balls gathered in front of the roller (camera 1) and tells
+// whether there are as many as three, i.e. one blob larger than 191px. Like
+// BallDetector the frame is only read.
+class RollerCounter {
+public:
+  RollerCounter();
+
+  // 1 when three blue balls are in, 0 otherwise. result, if given, gets the
+  // rectified frame with the blob drawn on it
+  int count(const cv::Mat& frame, cv::Mat* result = NULL);
+
+private:
+  cv::Mat intrinsic_, dist_;
+
+  // per frame buffers, kept so that their memory is reused
+  cv::Mat calibrated_, hsv_, mask_, blur_, edges_;
+  std::vector<std::vector<cv::Point> > contours_, poly_;
+  std::vector<cv::Vec4i> hierarchy_;
+};
+
+}
+
+#endif
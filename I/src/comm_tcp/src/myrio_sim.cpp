@@ -0,0 +1,415 @@
+/*************************************************************************
+ * myRIO stand-in for load-testing the control nodes on a laptop.
+ *
+ * Listens on TCP and UDP (same port) for any number of clients, decodes
+ * the 24-float command either as the bare array the myRIO VI reads or as a
+ * robot_link v1 frame (detected per client from the first bytes), drives a
+ * simple kinematic model with the newest command and publishes the pose.
+ *
+ * Per client it records inter-arrival times (and how often they miss the
+ * expected control period) and, for v1 frames, the end-to-end latency from
+ * the sender's monotonic timestamp. That stamp is the sender's own
+ * CLOCK_MONOTONIC, which only shares an origin with ours on the same machine,
+ * so latency is only recorded for clients on the loopback address; remote
+ * clients get inter-arrival times only. Histograms are printed periodically
+ * and on exit.
+ *
+ *   rosrun comm_tcp myrio_sim_node _port:=4000 _model:=differential
+ ***************************************************************************/
+#include <ros/ros.h>
+#include <geometry_msgs/Pose2D.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <math.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "robot_link/robot_link.h"
+
+using namespace std;
+
+#define RAW_FRAME_SIZE (robot_link::COMMAND_SIZE*sizeof(float))
+#define MAX_EVENTS 16
+
+void error(const char *msg) {
+    perror(msg);
+    exit(1);
+}
+
+/* Fixed-width histogram over [0, bins*width_us) plus an overflow count */
+class Histogram {
+public:
+  Histogram(int bins = 200, uint64_t width_us = 1000)
+    : width_us_(width_us), counts_(bins, 0), overflow_(0), total_(0), sum_us_(0), max_us_(0) {}
+
+  void add(uint64_t us) {
+    size_t bin = us / width_us_;
+    if (bin < counts_.size()) counts_[bin]++;
+    else overflow_++;
+    total_++;
+    sum_us_ += us;
+    if (us > max_us_) max_us_ = us;
+  }
+
+  uint64_t count() const { return total_; }
+
+  /* Upper edge of the bin holding the p-quantile [us] */
+  uint64_t percentile(double p) const {
+    if (!total_) return 0;
+    uint64_t want = (uint64_t)ceil(p * total_), seen = 0;
+    for (size_t i = 0; i < counts_.size(); i++) {
+      seen += counts_[i];
+      if (seen >= want) return (i + 1) * width_us_;
+    }
+    return max_us_;
+  }
+
+  string summary() const {
+    char buf[160];
+    if (!total_) return "no samples";
+    snprintf(buf, sizeof(buf), "n=%llu mean=%.2fms p50=%.0fms p90=%.0fms p99=%.0fms max=%.2fms",
+             (unsigned long long)total_, sum_us_ / 1000.0 / total_,
+             percentile(0.5) / 1000.0, percentile(0.9) / 1000.0, percentile(0.99) / 1000.0, max_us_ / 1000.0);
+    return buf;
+  }
+
+private:
+  uint64_t width_us_;
+  vector<uint64_t> counts_;
+  uint64_t overflow_;
+  uint64_t total_;
+  uint64_t sum_us_;
+  uint64_t max_us_;
+};
+
+enum Framing { FRAMING_UNKNOWN, FRAMING_RAW, FRAMING_V1 };
+
+/* One TCP connection, or one UDP peer */
+struct Client {
+  string name;
+  bool udp;
+  bool loopback;               // sender shares our monotonic clock, latency is meaningful
+  Framing framing;
+  vector<uint8_t> rx;          // bytes not yet consumed (TCP only)
+
+  uint64_t last_arrival_us;
+  uint32_t last_sequence;
+  uint64_t last_stamp_us;
+  uint64_t frames;
+  uint64_t missed_deadlines;   // inter-arrival longer than period*(1+tolerance)
+  uint64_t sequence_gaps;      // v1 frames lost or reordered
+  uint64_t bad_frames;
+  Histogram interarrival;
+  Histogram latency;
+
+  Client() : udp(false), loopback(false), framing(FRAMING_UNKNOWN), last_arrival_us(0), last_sequence(0), last_stamp_us(0),
+             frames(0), missed_deadlines(0), sequence_gaps(0), bad_frames(0) {}
+};
+
+bool isLoopback(const struct sockaddr_in& addr)
+{
+  return (ntohl(addr.sin_addr.s_addr) >> 24) == 127;
+}
+
+/* Latest command driving the model */
+float command[robot_link::COMMAND_SIZE];
+uint64_t command_us = 0;
+
+/* Model parameters */
+string model = "differential";
+double max_speed = 0.5;          // [m/s] at full stick
+double max_turn_rate = 2.0;      // [rad/s] at full stick
+double command_timeout = 0.5;    // [s] stop when nothing arrives for this long
+double expected_period = 0.04;   // [s] control loop period the clients try to keep
+double deadline_tolerance = 0.25;
+
+double pose_x = 0, pose_y = 0, pose_theta = 0;
+
+void onFrame(Client& c, const float* data, uint64_t now_us, bool has_header, const robot_link::FrameHeader& header)
+{
+  if (c.frames) {
+    uint64_t dt = now_us - c.last_arrival_us;
+    c.interarrival.add(dt);
+    if (dt > expected_period * (1 + deadline_tolerance) * 1e6) c.missed_deadlines++;
+  }
+  c.last_arrival_us = now_us;
+
+  if (has_header) {
+    if (c.frames && header.sequence != c.last_sequence + 1) c.sequence_gaps++;
+    c.last_sequence = header.sequence;
+    // the sender repeats the latest command every tick; only a new command's first copy is latency
+    if (c.loopback && header.stamp_us != c.last_stamp_us && now_us >= header.stamp_us) c.latency.add(now_us - header.stamp_us);
+    c.last_stamp_us = header.stamp_us;
+  }
+  c.frames++;
+
+  memcpy(command, data, sizeof(command));
+  command_us = now_us;
+}
+
+/* Consume every complete frame in c.rx; partial frames wait for the next read */
+void drainStream(Client& c, uint64_t now_us)
+{
+  size_t pos = 0;
+  float data[robot_link::COMMAND_SIZE];
+  robot_link::FrameHeader header;
+
+  if (c.framing == FRAMING_UNKNOWN && c.rx.size() >= 3) {
+    c.framing = (c.rx[0] == robot_link::FRAME_MAGIC0 && c.rx[1] == robot_link::FRAME_MAGIC1 &&
+                 c.rx[2] == robot_link::FRAME_VERSION) ? FRAMING_V1 : FRAMING_RAW;
+    ROS_INFO("(myrio_sim) %s sends %s frames", c.name.c_str(), c.framing == FRAMING_V1 ? "v1" : "raw");
+  }
+
+  while (pos < c.rx.size()) {
+    size_t left = c.rx.size() - pos;
+    if (c.framing == FRAMING_RAW) {
+      if (left < RAW_FRAME_SIZE) break;
+      memcpy(data, &c.rx[pos], RAW_FRAME_SIZE);
+      onFrame(c, data, now_us, false, header);
+      pos += RAW_FRAME_SIZE;
+    }
+    else if (c.framing == FRAMING_V1) {
+      memset(data, 0, sizeof(data));
+      int n = robot_link::decodeFrame(&c.rx[pos], left, header, data, robot_link::COMMAND_SIZE);
+      if (n == 0) break;
+      if (n < 0) {
+        // resync on the next magic
+        c.bad_frames++;
+        pos++;
+        continue;
+      }
+      onFrame(c, data, now_us, true, header);
+      pos += n;
+    }
+    else break;
+  }
+  c.rx.erase(c.rx.begin(), c.rx.begin() + pos);
+}
+
+void onDatagram(Client& c, const uint8_t* buf, size_t len, uint64_t now_us)
+{
+  float data[robot_link::COMMAND_SIZE];
+  robot_link::FrameHeader header;
+  memset(data, 0, sizeof(data));
+
+  if (robot_link::decodeFrame(buf, len, header, data, robot_link::COMMAND_SIZE) == (int)len) {
+    c.framing = FRAMING_V1;
+    onFrame(c, data, now_us, true, header);
+  }
+  else if (len == RAW_FRAME_SIZE) {
+    c.framing = FRAMING_RAW;
+    memcpy(data, buf, RAW_FRAME_SIZE);
+    onFrame(c, data, now_us, false, header);
+  }
+  else c.bad_frames++;
+}
+
+/* Advance the model by dt with the current command */
+void integrate(double dt, uint64_t now_us)
+{
+  double vx = 0, vy = 0, w = 0;   // body frame: x forward, y left, w counter-clockwise
+  if (command_us && (int64_t)(now_us - command_us) < command_timeout * 1e6) {
+    if (model == "mecanum") {
+      // left stick translates, right stick x (data[4]) and triggers (data[8]/data[9]) rotate
+      vx = max_speed * command[1];
+      vy = -max_speed * command[0];
+      w = -max_turn_rate * command[4] + max_turn_rate * (command[8] - command[9]);
+    }
+    else {
+      // what the data_integrate macros assume: stick y drives, stick x turns
+      vx = max_speed * command[1];
+      w = -max_turn_rate * command[0];
+    }
+  }
+
+  double c = cos(pose_theta), s = sin(pose_theta);
+  pose_x += (c * vx - s * vy) * dt;
+  pose_y += (s * vx + c * vy) * dt;
+  pose_theta = atan2(sin(pose_theta + w * dt), cos(pose_theta + w * dt));
+}
+
+void reportClient(const Client& c, bool with_latency_note)
+{
+  double miss = c.interarrival.count() ? 100.0 * c.missed_deadlines / c.interarrival.count() : 0;
+  ROS_INFO("(myrio_sim) %s : %llu frames, %.1f%% over %.0fms period, %llu seq gaps, %llu bad",
+           c.name.c_str(), (unsigned long long)c.frames, miss, expected_period * 1e3,
+           (unsigned long long)c.sequence_gaps, (unsigned long long)c.bad_frames);
+  ROS_INFO("(myrio_sim)   inter-arrival %s", c.interarrival.summary().c_str());
+  if (c.framing == FRAMING_V1 && c.loopback) ROS_INFO("(myrio_sim)   latency       %s", c.latency.summary().c_str());
+  else if (c.framing == FRAMING_V1) {
+    if (with_latency_note) ROS_INFO("(myrio_sim)   latency       needs the sender on this machine (its clock differs)");
+  }
+  else if (with_latency_note) ROS_INFO("(myrio_sim)   latency       needs v1 frames (_myrio_framing:=v1)");
+}
+
+void report(const map<int, Client>& tcp_clients, const map<string, Client>& udp_clients, bool with_latency_note)
+{
+  for (map<int, Client>::const_iterator it = tcp_clients.begin(); it != tcp_clients.end(); ++it)
+    reportClient(it->second, with_latency_note);
+  for (map<string, Client>::const_iterator it = udp_clients.begin(); it != udp_clients.end(); ++it)
+    reportClient(it->second, with_latency_note);
+  ROS_INFO("(myrio_sim) pose x=%.3f y=%.3f theta=%.1f", pose_x, pose_y, pose_theta * 180. / M_PI);
+}
+
+int main (int argc, char** argv)
+{
+  ros::init(argc, argv, "myrio_sim_node");
+  ros::NodeHandle nh;
+  ros::NodeHandle nh_private("~");
+
+  int portno;
+  double rate, report_interval;
+  nh_private.param("port", portno, 4000);
+  nh_private.param("rate", rate, 100.0);
+  nh_private.param("report_interval", report_interval, 5.0);
+  nh_private.param<string>("model", model, model);
+  nh_private.param("max_speed", max_speed, max_speed);
+  nh_private.param("max_turn_rate", max_turn_rate, max_turn_rate);
+  nh_private.param("command_timeout", command_timeout, command_timeout);
+  nh_private.param("expected_period", expected_period, expected_period);
+  nh_private.param("deadline_tolerance", deadline_tolerance, deadline_tolerance);
+
+  ros::Publisher pose_pub = nh.advertise<geometry_msgs::Pose2D>("/myrio_sim/pose", 10);
+
+  int enable = 1;
+  struct sockaddr_in serv_addr;
+  bzero((char *) &serv_addr, sizeof(serv_addr));
+  serv_addr.sin_family = AF_INET;
+  serv_addr.sin_addr.s_addr = INADDR_ANY;
+  serv_addr.sin_port = htons(portno);
+
+  int listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  if (listen_fd < 0) error("ERROR opening socket");
+  if (setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(int)) < 0)
+      error("setsockopt(SO_REUSEADDR) failed");
+  if (bind(listen_fd, (struct sockaddr *) &serv_addr, sizeof(serv_addr)) < 0)
+      error("ERROR on binding");
+  listen(listen_fd, 16);
+
+  int udp_fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+  if (udp_fd < 0) error("ERROR opening udp socket");
+  if (bind(udp_fd, (struct sockaddr *) &serv_addr, sizeof(serv_addr)) < 0)
+      error("ERROR on udp binding");
+
+  int epoll_fd = epoll_create1(0);
+  if (epoll_fd < 0) error("ERROR on epoll_create1");
+  struct epoll_event ev;
+  ev.events = EPOLLIN;
+  ev.data.fd = listen_fd;
+  epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &ev);
+  ev.data.fd = udp_fd;
+  epoll_ctl(epoll_fd, EPOLL_CTL_ADD, udp_fd, &ev);
+
+  ROS_INFO("(myrio_sim) listening on tcp/udp port %d, %s model", portno, model.c_str());
+
+  map<int, Client> tcp_clients;
+  map<string, Client> udp_clients;
+  uint8_t buf[4096];
+  struct epoll_event events[MAX_EVENTS];
+
+  uint64_t tick_us = (uint64_t)(1e6 / rate);
+  uint64_t next_tick = robot_link::monotonicUs() + tick_us;
+  uint64_t next_report = robot_link::monotonicUs() + (uint64_t)(report_interval * 1e6);
+
+  while (ros::ok()) {
+    uint64_t now_us = robot_link::monotonicUs();
+    int timeout_ms = next_tick > now_us ? (int)((next_tick - now_us + 999) / 1000) : 0;
+    int n = epoll_wait(epoll_fd, events, MAX_EVENTS, timeout_ms);
+    if (n < 0 && errno != EINTR) error("ERROR on epoll_wait");
+
+    for (int i = 0; i < n; i++) {
+      int fd = events[i].data.fd;
+      now_us = robot_link::monotonicUs();
+
+      if (fd == listen_fd) {
+        struct sockaddr_in cli_addr;
+        socklen_t clilen = sizeof(cli_addr);
+        int cfd;
+        while ((cfd = accept4(listen_fd, (struct sockaddr *) &cli_addr, &clilen, SOCK_NONBLOCK)) >= 0) {
+          char name[64];
+          snprintf(name, sizeof(name), "tcp %s:%d", inet_ntoa(cli_addr.sin_addr), ntohs(cli_addr.sin_port));
+          tcp_clients[cfd].name = name;
+          tcp_clients[cfd].loopback = isLoopback(cli_addr);
+          ev.events = EPOLLIN;
+          ev.data.fd = cfd;
+          epoll_ctl(epoll_fd, EPOLL_CTL_ADD, cfd, &ev);
+          ROS_INFO("(myrio_sim) %s connected", name);
+          clilen = sizeof(cli_addr);
+        }
+      }
+      else if (fd == udp_fd) {
+        struct sockaddr_in cli_addr;
+        socklen_t clilen = sizeof(cli_addr);
+        ssize_t len;
+        while ((len = recvfrom(udp_fd, buf, sizeof(buf), 0, (struct sockaddr *) &cli_addr, &clilen)) >= 0) {
+          char name[64];
+          snprintf(name, sizeof(name), "udp %s:%d", inet_ntoa(cli_addr.sin_addr), ntohs(cli_addr.sin_port));
+          Client& c = udp_clients[name];
+          if (c.name.empty()) {
+            c.name = name;
+            c.udp = true;
+            c.loopback = isLoopback(cli_addr);
+          }
+          onDatagram(c, buf, len, now_us);
+          clilen = sizeof(cli_addr);
+        }
+      }
+      else {
+        Client& c = tcp_clients[fd];
+        bool closed = false;
+        for (;;) {
+          ssize_t len = read(fd, buf, sizeof(buf));
+          if (len > 0) {
+            c.rx.insert(c.rx.end(), buf, buf + len);
+            continue;
+          }
+          if (len < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+          if (len < 0 && errno == EINTR) continue;
+          closed = true;
+          break;
+        }
+        drainStream(c, now_us);
+        if (closed) {
+          ROS_INFO("(myrio_sim) %s disconnected", c.name.c_str());
+          reportClient(c, true);
+          epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+          close(fd);
+          tcp_clients.erase(fd);
+        }
+      }
+    }
+
+    now_us = robot_link::monotonicUs();
+    while (now_us >= next_tick) {
+      integrate(tick_us / 1e6, next_tick);
+      next_tick += tick_us;
+
+      geometry_msgs::Pose2D pose;
+      pose.x = pose_x;
+      pose.y = pose_y;
+      pose.theta = pose_theta;
+      pose_pub.publish(pose);
+    }
+    if (now_us >= next_report) {
+      report(tcp_clients, udp_clients, false);
+      next_report = now_us + (uint64_t)(report_interval * 1e6);
+    }
+    ros::spinOnce();
+  }
+
+  report(tcp_clients, udp_clients, true);
+  close(epoll_fd);
+  close(udp_fd);
+  close(listen_fd);
+  return 0;
+}
@@ -0,0 +1,119 @@
+#ifndef DATA_INTEGRATE_BALL_WORLD_H
+#define DATA_INTEGRATE_BALL_WORLD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace ball_world {
+
+enum BallColor { BLUE, RED, GREEN, COLOR_COUNT };
+
+struct WorldParams {
+  float gate;           // max distance [m] between a prediction and the detection it takes
+  float alpha;          // alpha-beta filter gain on position
+  float beta;           // alpha-beta filter gain on velocity
+  int confirm_hits;     // detections before a track is reported
+  int max_misses;       // frames a confirmed track coasts on its prediction before it is dropped
+  int max_tracks;       // per color
+
+  WorldParams()
+    : gate(0.10f)
+    , alpha(0.6f)
+    , beta(0.2f)
+    , confirm_hits(2)
+    , max_misses(4)
+    , max_tracks(20) {}
+};
+
+/*
+ * BallWorld : persistent ball tracks built from per-frame detections.
+ *
+ * Each update() predicts the tracks of one color to the frame time, pairs them
+ * with the detections greedily (closest pair first, inside the gate), corrects
+ * the paired tracks with an alpha-beta filter, ages the unpaired ones and
+ * opens tentative tracks for the unpaired detections.
+ *
+ * A track is reported once it has been seen confirm_hits times and keeps being
+ * reported for max_misses frames after it was last seen, so a ball that drops
+ * out of one or two frames does not disappear from the queries.
+ *
+ * Reported tracks are addressed by rank : 0 is the leftmost (smallest x), in
+ * the same order exportTo() writes them. Leftmost/rightmost/nearest/furthest
+ * are O(1), centermost is O(log n) and the corridor queries O(log n + k) for
+ * k tracks inside the corridor's x range.
+ */
+class BallWorld {
+public:
+  explicit BallWorld(const WorldParams& params = WorldParams());
+
+  void setParams(const WorldParams& params) { params_ = params; }
+  const WorldParams& params() const { return params_; }
+
+  /* one frame of detections of `color`; x lateral, z forward [m]; stamp [s] */
+  void update(BallColor color, const float* x, const float* z, int n, double stamp);
+
+  void clear();
+
+  /* reported tracks of `color` */
+  int size(BallColor color) const { return (int) view_[color].by_x.size(); }
+  float x(BallColor color, int rank) const;
+  float z(BallColor color, int rank) const;
+  uint32_t id(BallColor color, int rank) const;
+  bool coasting(BallColor color, int rank) const;
+
+  /* ranks, or -1 if no track of that color is reported */
+  int leftmost(BallColor color) const;
+  int rightmost(BallColor color) const;
+  int centermost(BallColor color) const;
+  int nearest(BallColor color) const;
+  int furthest(BallColor color) const;
+
+  /* nearest track with |x| <= half_width and z <= max_z, or -1 */
+  int nearestInCorridor(BallColor color, float half_width, float max_z) const;
+  bool anyInCorridor(BallColor color, float half_width, float max_z) const;
+
+  /* write reported tracks in rank order; returns how many were written */
+  int exportTo(BallColor color, float* x, float* z, int capacity) const;
+
+private:
+  /* struct-of-arrays store of every track of one color, tentative ones included */
+  struct Tracks {
+    std::vector<float> x, z, vx, vz;
+    std::vector<uint32_t> id;
+    std::vector<int> hits, misses;
+    double stamp;
+
+    Tracks() : stamp(0) {}
+    size_t size() const { return x.size(); }
+    void push(float x0, float z0, uint32_t id0);
+    void erase(size_t i);   // swap with the last track
+  };
+
+  /* reported tracks sorted by x and by z; ranks are positions in by_x */
+  struct View {
+    std::vector<int> by_x;        // rank -> track
+    std::vector<float> xs;        // x of by_x, for binary search
+    std::vector<int> by_z;        // ranks sorted by z
+  };
+
+  void rebuildView(BallColor color);
+
+  WorldParams params_;
+  Tracks tracks_[COLOR_COUNT];
+  View view_[COLOR_COUNT];
+  uint32_t next_id_;
+
+  /* scratch reused by update() */
+  struct Pair {
+    float d2;
+    int track, det;
+    bool operator<(const Pair& o) const { return d2 < o.d2; }
+  };
+  std::vector<Pair> pairs_;
+  std::vector<char> track_used_, det_used_;
+};
+
+}
+
+#endif
@@ -0,0 +1,170 @@
+#ifndef DATA_INTEGRATE_LOCAL_PLANNER_H
+#define DATA_INTEGRATE_LOCAL_PLANNER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+namespace local_planner {
+
+struct PlannerParams {
+  float resolution;     // [m] per cell
+  int size;             // cells per side of the square grid
+  float origin_x;       // [m] world position of the grid's lower left corner
+  float origin_y;
+  float robot_radius;   // [m] every obstacle is inflated by this
+  float red_radius;     // [m] a red ball, inflated on top of robot_radius
+  float red_merge;      // [m] a red ball closer than this to a remembered one is the same ball
+  float scan_max_range; // [m] lidar hits further away do not enter the map
+  float lookahead;      // [m] along the path, the point the robot steers at
+  float max_v;          // [m/s]
+  float max_w;          // [rad/s]
+  float turn_in_place;  // [rad] heading error above which the robot only turns
+  int max_expansions;   // per plan(); a longer search resumes on the next call
+
+  PlannerParams()
+    : resolution(0.08f)
+    , size(128)
+    , origin_x(-5.12f)
+    , origin_y(-5.12f)
+    , robot_radius(0.22f)
+    , red_radius(0.04f)
+    , red_merge(0.15f)
+    , scan_max_range(3.0f)
+    , lookahead(0.4f)
+    , max_v(0.3f)
+    , max_w(1.0f)
+    , turn_in_place(0.5f)
+    , max_expansions(5000) {}
+};
+
+/* forward and yaw rate, robot frame, yaw counter-clockwise */
+struct Twist {
+  float v;  // [m/s]
+  float w;  // [rad/s]
+};
+
+/*
+ * LocalPlanner : D* Lite over a small 8-connected costmap.
+ *
+ * The costmap has two layers : the latest lidar scan, replaced by every
+ * setScan(), and the red balls seen so far, kept until clearRed(). Each is
+ * stamped as a precomputed inflated disc, so a cell is blocked when it lies
+ * closer than robot_radius to a hit, or robot_radius + red_radius to a red ball.
+ * Entering a blocked cell is not allowed, leaving one is, so the robot can
+ * always back out of an inflation that grew over it.
+ *
+ * The search runs from the goal towards the robot and is kept between calls.
+ * When the robot moves only the key offset changes; when cells flip between
+ * blocked and free only those cells' neighbours are repaired, so a replan
+ * usually expands a few hundred cells instead of the whole grid. setGoal()
+ * starts a new search. A plan() stops after max_expansions and the next one
+ * carries on, so no single call overruns the control tick.
+ *
+ * World frame is the /lidar_coor frame in meters and radians.
+ */
+class LocalPlanner {
+public:
+  explicit LocalPlanner(const PlannerParams& params = PlannerParams());
+
+  /* resets the map and the search */
+  void setParams(const PlannerParams& params);
+  const PlannerParams& params() const { return params_; }
+
+  /* new goal [m]; false if it is outside the grid */
+  bool setGoal(float x, float y);
+  bool hasGoal() const { return goal_ >= 0; }
+
+  /* replace the lidar layer with a scan taken at pose (x, y [m], theta [rad]) */
+  void setScan(const float* ranges, int n, float angle_min, float angle_increment,
+               float x, float y, float theta);
+
+  /* remember a red ball [m]; ignored if one is already remembered close to it */
+  void addRed(float x, float y);
+  void clearRed();
+  size_t redCount() const { return red_x_.size(); }
+
+  /* move the start to the robot and repair the search; false if the robot is
+   * outside the grid, no path reaches the goal, or the search ran out of
+   * max_expansions before it finished (searching() tells) */
+  bool plan(float x, float y);
+  bool searching() const { return searching_; }
+
+  /* point [m] lookahead ahead along the last plan; false without a path */
+  bool waypoint(float& wx, float& wy) const;
+
+  /* velocity towards waypoint() for a robot at (x, y, theta); zero without a path */
+  Twist command(float x, float y, float theta) const;
+
+  /* length [m] of the last plan's path, INFINITY without one */
+  float pathLength() const;
+
+  /* straight-line distance [m] from the robot to the goal at the last plan() */
+  float goalDistance() const;
+
+  bool blocked(float x, float y) const;
+
+  /* cells expanded and wall time [ms] of the last plan() */
+  int expanded() const { return expanded_; }
+  double planMs() const { return plan_ms_; }
+
+private:
+  /* path costs are integers, 100 per straight step, so ties between keys are exact */
+  typedef int32_t Cost;
+
+  struct Key {
+    Cost k1, k2;
+    bool operator<(const Key& o) const { return k1 < o.k1 || (k1 == o.k1 && k2 < o.k2); }
+  };
+
+  int cellAt(float x, float y) const;
+  float cellX(int c) const;
+  float cellY(int c) const;
+
+  void stamp(std::vector<uint8_t>& layer, float x, float y, const std::vector<int>& disc);
+  void collectChanges();
+
+  Cost heuristic(int a, int b) const;
+  Cost cost(int from, int to, int dir) const;
+  Key calculateKey(int c) const;
+  void updateVertex(int c);
+  void computeShortestPath();
+  int bestSuccessor(int c) const;
+
+  /* indexed binary heap of cells, ordered by key_ */
+  void heapPush(int c, const Key& k);
+  void heapRemove(int c);
+  void heapUpdate(int c, const Key& k);
+  void heapUp(int i);
+  void heapDown(int i);
+  Key topKey() const;
+
+  PlannerParams params_;
+  int n_;                         // size * size
+
+  std::vector<uint8_t> scan_;     // per cell, lidar layer
+  std::vector<uint8_t> red_;      // per cell, red ball layer
+  std::vector<uint8_t> blocked_;  // scan_ | red_, as the search last saw it
+  std::vector<uint8_t> scratch_;  // next scan layer
+  std::vector<int> changed_;      // cells whose blocked_ flipped since the last plan()
+  std::vector<int> scan_disc_, red_disc_;   // (dx, dy) pairs of the inflated discs
+  std::vector<float> red_x_, red_y_;
+
+  int dx_[8], dy_[8], step_[8];   // neighbour offsets, step_ = dy*size + dx
+  Cost len_[8];                   // 100 or 141
+
+  std::vector<Cost> g_, rhs_;
+  std::vector<Key> key_;
+  std::vector<int> heap_;
+  std::vector<int> heap_pos_;     // per cell, index in heap_ or -1
+
+  int goal_, start_, last_;
+  Cost km_;
+  int expanded_;
+  bool searching_;
+  double plan_ms_;
+};
+
+}
+
+#endif
@@ -0,0 +1,196 @@
+#include "data_integrate/ball_world.h"
+
+#include <algorithm>
+#include <math.h>
+
+namespace ball_world {
+
+void BallWorld::Tracks::push(float x0, float z0, uint32_t id0)
+{
+  x.push_back(x0);
+  z.push_back(z0);
+  vx.push_back(0);
+  vz.push_back(0);
+  id.push_back(id0);
+  hits.push_back(1);
+  misses.push_back(0);
+}
+
+void BallWorld::Tracks::erase(size_t i)
+{
+  size_t last = size() - 1;
+  x[i] = x[last]; x.pop_back();
+  z[i] = z[last]; z.pop_back();
+  vx[i] = vx[last]; vx.pop_back();
+  vz[i] = vz[last]; vz.pop_back();
+  id[i] = id[last]; id.pop_back();
+  hits[i] = hits[last]; hits.pop_back();
+  misses[i] = misses[last]; misses.pop_back();
+}
+
+BallWorld::BallWorld(const WorldParams& params)
+  : params_(params)
+  , next_id_(1)
+{
+}
+
+void BallWorld::clear()
+{
+  for(int c=0; c<COLOR_COUNT; c++) {
+    tracks_[c] = Tracks();
+    view_[c] = View();
+  }
+}
+
+void BallWorld::update(BallColor color, const float* x, const float* z, int n, double stamp)
+{
+  Tracks& t = tracks_[color];
+
+  /* predict */
+  float dt = (t.stamp > 0 && stamp > t.stamp) ? (float) (stamp - t.stamp) : 0;
+  t.stamp = stamp;
+  for(size_t i=0; i<t.size(); i++) {
+    t.x[i] += t.vx[i] * dt;
+    t.z[i] += t.vz[i] * dt;
+  }
+
+  /* greedy association : every gated pair, closest first */
+  float gate2 = params_.gate * params_.gate;
+  pairs_.clear();
+  for(size_t i=0; i<t.size(); i++) {
+    for(int j=0; j<n; j++) {
+      float dx = x[j] - t.x[i];
+      float dz = z[j] - t.z[i];
+      float d2 = dx*dx + dz*dz;
+      if(d2 <= gate2) {
+        Pair p = { d2, (int) i, j };
+        pairs_.push_back(p);
+      }
+    }
+  }
+  std::sort(pairs_.begin(), pairs_.end());
+
+  track_used_.assign(t.size(), 0);
+  det_used_.assign(n, 0);
+
+  /* correct */
+  for(size_t k=0; k<pairs_.size(); k++) {
+    const Pair& p = pairs_[k];
+    if(track_used_[p.track] || det_used_[p.det]) continue;
+    track_used_[p.track] = det_used_[p.det] = 1;
+
+    int i = p.track;
+    float rx = x[p.det] - t.x[i];
+    float rz = z[p.det] - t.z[i];
+    t.x[i] += params_.alpha * rx;
+    t.z[i] += params_.alpha * rz;
+    if(dt > 0) {
+      t.vx[i] += params_.beta * rx / dt;
+      t.vz[i] += params_.beta * rz / dt;
+    }
+    t.hits[i]++;
+    t.misses[i] = 0;
+  }
+
+  /* age; tentative tracks die on their first miss. Walk backwards, erase() swaps in the last track */
+  for(size_t i=t.size(); i-- > 0; ) {
+    if(track_used_[i]) continue;
+    t.misses[i]++;
+    if(t.hits[i] < params_.confirm_hits || t.misses[i] > params_.max_misses)
+      t.erase(i);
+  }
+
+  /* birth */
+  for(int j=0; j<n && (int) t.size() < params_.max_tracks; j++)
+    if(!det_used_[j]) t.push(x[j], z[j], next_id_++);
+
+  rebuildView(color);
+}
+
+namespace {
+
+struct LessX {
+  const std::vector<float>& x;
+  explicit LessX(const std::vector<float>& x_) : x(x_) {}
+  bool operator()(int a, int b) const { return x[a] < x[b]; }
+};
+
+struct LessRankZ {
+  const std::vector<float>& z;
+  const std::vector<int>& by_x;
+  LessRankZ(const std::vector<float>& z_, const std::vector<int>& by_x_) : z(z_), by_x(by_x_) {}
+  bool operator()(int a, int b) const { return z[by_x[a]] < z[by_x[b]]; }
+};
+
+}
+
+void BallWorld::rebuildView(BallColor color)
+{
+  const Tracks& t = tracks_[color];
+  View& v = view_[color];
+
+  v.by_x.clear();
+  for(size_t i=0; i<t.size(); i++)
+    if(t.hits[i] >= params_.confirm_hits) v.by_x.push_back((int) i);
+  std::sort(v.by_x.begin(), v.by_x.end(), LessX(t.x));
+
+  v.xs.resize(v.by_x.size());
+  v.by_z.resize(v.by_x.size());
+  for(size_t r=0; r<v.by_x.size(); r++) {
+    v.xs[r] = t.x[v.by_x[r]];
+    v.by_z[r] = (int) r;
+  }
+  std::sort(v.by_z.begin(), v.by_z.end(), LessRankZ(t.z, v.by_x));
+}
+
+float BallWorld::x(BallColor color, int rank) const { return tracks_[color].x[view_[color].by_x[rank]]; }
+float BallWorld::z(BallColor color, int rank) const { return tracks_[color].z[view_[color].by_x[rank]]; }
+uint32_t BallWorld::id(BallColor color, int rank) const { return tracks_[color].id[view_[color].by_x[rank]]; }
+bool BallWorld::coasting(BallColor color, int rank) const { return tracks_[color].misses[view_[color].by_x[rank]] > 0; }
+
+int BallWorld::leftmost(BallColor color) const { return size(color) ? 0 : -1; }
+int BallWorld::rightmost(BallColor color) const { return size(color) - 1; }
+int BallWorld::nearest(BallColor color) const { return size(color) ? view_[color].by_z.front() : -1; }
+int BallWorld::furthest(BallColor color) const { return size(color) ? view_[color].by_z.back() : -1; }
+
+int BallWorld::centermost(BallColor color) const
+{
+  const std::vector<float>& xs = view_[color].xs;
+  if(xs.empty()) return -1;
+
+  int r = (int) (std::lower_bound(xs.begin(), xs.end(), 0.0f) - xs.begin());
+  if(r == (int) xs.size()) return r - 1;
+  if(r > 0 && -xs[r-1] < xs[r]) return r - 1;
+  return r;
+}
+
+int BallWorld::nearestInCorridor(BallColor color, float half_width, float max_z) const
+{
+  const std::vector<float>& xs = view_[color].xs;
+  int lo = (int) (std::lower_bound(xs.begin(), xs.end(), -half_width) - xs.begin());
+  int hi = (int) (std::upper_bound(xs.begin(), xs.end(), half_width) - xs.begin());
+
+  int best = -1;
+  for(int r=lo; r<hi; r++) {
+    float zr = z(color, r);
+    if(zr <= max_z && (best < 0 || zr < z(color, best))) best = r;
+  }
+  return best;
+}
+
+bool BallWorld::anyInCorridor(BallColor color, float half_width, float max_z) const
+{
+  return nearestInCorridor(color, half_width, max_z) >= 0;
+}
+
+int BallWorld::exportTo(BallColor color, float* x_out, float* z_out, int capacity) const
+{
+  int n = std::min(size(color), capacity);
+  for(int r=0; r<n; r++) {
+    x_out[r] = x(color, r);
+    z_out[r] = z(color, r);
+  }
+  return n;
+}
+
+}
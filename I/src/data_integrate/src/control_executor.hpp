@@ -0,0 +1,158 @@
+#ifndef CONTROL_EXECUTOR_H
+#define CONTROL_EXECUTOR_H
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include <ros/ros.h>
+#include <ros/callback_queue.h>
+#include "core_msgs/loop_stats.h"
+
+/*
+ * Snapshot<T> : single writer / single reader triple buffer.
+ * The perception thread publish()es a whole state, the control tick takes the
+ * newest one with latest(). Neither side ever waits on the other.
+ */
+template <typename T>
+class Snapshot {
+public:
+  Snapshot() : write_(0), read_(1), middle_(2) {}
+
+  /* writer side */
+  void publish(const T& state) {
+    buf_[write_] = state;
+    write_ = middle_.exchange(write_ | FRESH, std::memory_order_acq_rel) & INDEX;
+  }
+
+  /* reader side : newest state, or NULL if nothing new since the last call */
+  const T* latest() {
+    if(!(middle_.load(std::memory_order_relaxed) & FRESH))
+      return NULL;
+    read_ = middle_.exchange(read_, std::memory_order_acq_rel) & INDEX;
+    return &buf_[read_];
+  }
+
+private:
+  enum { INDEX = 0x3, FRESH = 0x4 };
+
+  T buf_[3];
+  unsigned write_;
+  unsigned read_;
+  std::atomic<unsigned> middle_;
+};
+
+/*
+ * ControlExecutor : perception callbacks run on their own queue and thread,
+ * the control loop ticks on steady_clock deadlines.
+ *
+ *   ControlExecutor executor(n, DURATION);
+ *   executor.perception().subscribe(...);
+ *   executor.start();
+ *   while(ros::ok()) { executor.beginTick(); ...; executor.endTick(); }
+ *
+ * A tick that ends after the next deadline counts as an overrun and the
+ * schedule restarts from now instead of firing the missed ticks back to back.
+ * Wake-up latency and execution time are published on ~loop_stats once a second.
+ */
+class ControlExecutor {
+public:
+  typedef std::chrono::steady_clock clock;
+
+  ControlExecutor(const ros::NodeHandle& nh, double period)
+    : perception_nh_(nh)
+    , spinner_(1, &queue_)
+    , period_(std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(period)))
+    , total_overruns_(0)
+  {
+    perception_nh_.setCallbackQueue(&queue_);
+    ros::NodeHandle nh_private("~");
+    stats_pub_ = nh_private.advertise<core_msgs::loop_stats>("loop_stats", 10);
+    resetStats();
+  }
+
+  ~ControlExecutor() { stop(); }
+
+  /* subscribe perception topics through this handle */
+  ros::NodeHandle& perception() { return perception_nh_; }
+
+  void start() {
+    spinner_.start();
+    deadline_ = clock::now();
+    report_at_ = deadline_ + std::chrono::seconds(1);
+  }
+
+  void stop() { spinner_.stop(); }
+
+  /* sleep until the tick deadline */
+  void beginTick() {
+    std::this_thread::sleep_until(deadline_);
+    tick_start_ = clock::now();
+    double latency = seconds(tick_start_ - deadline_);
+    latency_sum_ += latency;
+    if(latency > latency_max_) latency_max_ = latency;
+  }
+
+  void endTick() {
+    clock::time_point now = clock::now();
+    double exec = seconds(now - tick_start_);
+    exec_sum_ += exec;
+    if(exec > exec_max_) exec_max_ = exec;
+    ticks_++;
+
+    deadline_ += period_;
+    if(now > deadline_) {
+      overruns_++;
+      total_overruns_++;
+      deadline_ = now;
+    }
+
+    if(now >= report_at_) {
+      publishStats();
+      report_at_ += std::chrono::seconds(1);
+    }
+  }
+
+  uint32_t overruns() const { return total_overruns_; }
+
+private:
+  static double seconds(clock::duration d) { return std::chrono::duration<double>(d).count(); }
+
+  void resetStats() {
+    ticks_ = overruns_ = 0;
+    latency_sum_ = latency_max_ = exec_sum_ = exec_max_ = 0;
+  }
+
+  void publishStats() {
+    core_msgs::loop_stats msg;
+    msg.header.stamp = ros::Time::now();
+    msg.period = seconds(period_);
+    msg.ticks = ticks_;
+    msg.overruns = overruns_;
+    msg.total_overruns = total_overruns_;
+    msg.latency_mean = ticks_ ? latency_sum_ / ticks_ : 0;
+    msg.latency_max = latency_max_;
+    msg.exec_mean = ticks_ ? exec_sum_ / ticks_ : 0;
+    msg.exec_max = exec_max_;
+    stats_pub_.publish(msg);
+    resetStats();
+  }
+
+  ros::CallbackQueue queue_;
+  ros::NodeHandle perception_nh_;
+  ros::AsyncSpinner spinner_;
+  ros::Publisher stats_pub_;
+
+  clock::duration period_;
+  clock::time_point deadline_;
+  clock::time_point tick_start_;
+  clock::time_point report_at_;
+
+  uint32_t ticks_;
+  uint32_t overruns_;
+  uint32_t total_overruns_;
+  double latency_sum_, latency_max_;
+  double exec_sum_, exec_max_;
+};
+
+#endif
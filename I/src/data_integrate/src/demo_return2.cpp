@@ -15,6 +15,7 @@
 #include <boost/thread.hpp>
 #include <ros/ros.h>
 #include <ros/package.h>
+#include "robot_link/ros_config.h"
 
 #include "ros/ros.h"
 #include "sensor_msgs/LaserScan.h"
@@ -90,8 +91,7 @@ float green_z_top[20];
 
 #endif
 
-int c_socket, s_socket;
-struct sockaddr_in c_addr;
+robot_link::RobotLink myrio;
 int len;
 int n;
 float data[24];
@@ -206,14 +206,12 @@ int main(int argc, char **argv)
     if(use_myrio) {
 
     printf("(%s) Connecting to %s:%d\n", TESTENV, IPADDR, PORT);
-    c_socket = socket(PF_INET, SOCK_STREAM, 0);
-    c_addr.sin_addr.s_addr = inet_addr(IPADDR);
-    c_addr.sin_family = AF_INET;
-    c_addr.sin_port = htons(PORT);
-
-    if(connect(c_socket, (struct sockaddr*) &c_addr, sizeof(c_addr)) == -1){
+    robot_link::LinkConfig link_config;
+    link_config.host = IPADDR;
+    link_config.port = PORT;
+    link_config.rate_hz = 1.0/DURATION;
+    if(!myrio.open(robot_link::loadLinkConfig(link_config))){
       printf("(%s) Failed to connect\n", TESTENV);
-      close(c_socket);
       return -1;
     }
     printf("(%s) Connected to %s:%d\n", TESTENV, IPADDR, PORT);
@@ -530,9 +528,8 @@ int main(int argc, char **argv)
 
       #ifdef MYRIO
       if(use_myrio) {
-      size_t written = write(c_socket, data, sizeof(data));
-      if(DEBUG)
-        printf("%d bytes written\n", (int) written);
+      if(!myrio.setCommand(data))
+        ROS_ERROR_THROTTLE(1, "(%s) Lost the link to the myRIO", TESTENV);
       }
       #endif
 
@@ -541,7 +538,7 @@ int main(int argc, char **argv)
       timer_ticks++;
     }
 
-    close(c_socket);
+    myrio.close();
     ros::shutdown();
 
     return -1;
@@ -16,6 +16,7 @@
 
 #include <ros/ros.h>
 #include <ros/package.h>
+#include "robot_link/ros_config.h"
 
 #include "core_msgs/ball_position.h"
 #include "ros/ros.h"
@@ -93,8 +94,7 @@ float ball_distance[20];
 /* Track the closest ball. */
 int target_ball;  // index of target ball
 
-int c_socket, s_socket;
-struct sockaddr_in c_addr;
+robot_link::RobotLink myrio;
 int len;
 int n;
 float data[24];
@@ -140,14 +140,11 @@ int main(int argc, char **argv)
 		dataInit();
 
     #ifdef MYRIO
-    c_socket = socket(PF_INET, SOCK_STREAM, 0);
-    c_addr.sin_addr.s_addr = inet_addr(IPADDR);
-    c_addr.sin_family = AF_INET;
-    c_addr.sin_port = htons(PORT);
-
-    if(connect(c_socket, (struct sockaddr*) &c_addr, sizeof(c_addr)) == -1){
+    robot_link::LinkConfig link_config;
+    link_config.host = IPADDR;
+    link_config.port = PORT;
+    if(!myrio.open(robot_link::loadLinkConfig(link_config))){
       printf("(%s) Failed to connect\n", TESTENV);
-      close(c_socket);
       return -1;
     }
     #else
@@ -164,9 +161,8 @@ int main(int argc, char **argv)
       }
 
     #ifdef MYRIO
-    size_t written = write(c_socket, data, sizeof(data));
-    if(DEBUG)
-      printf("%d bytes written\n", (int) written);
+    if(!myrio.setCommand(data))
+      ROS_ERROR_THROTTLE(1, "(%s) Lost the link to the myRIO", TESTENV);
     #endif
 
       
@@ -176,7 +172,7 @@ int main(int argc, char **argv)
     }
     printf("(%s) end\n",TESTENV);
 
-    close(c_socket);
+    myrio.close();
     ros::shutdown();
     return 0;
 }
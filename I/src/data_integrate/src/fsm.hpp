@@ -0,0 +1,212 @@
+#ifndef FSM_H
+#define FSM_H
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+/*
+ * fsm : table-driven state machine for the behaviour layer.
+ *
+ * States are the values 0..NSTATES-1 of an enum. Each one has a Node that
+ * writes that tick's command. Transitions are Rows: from-state, guard, to-state
+ * and an optional action. Both tables are plain const arrays, so a step is an
+ * index into the node table and a short scan of the current state's rows.
+ * Nothing in here waits. A manoeuvre that used to block in a sleep loop becomes
+ * a state whose guard watches in_state, the number of ticks spent there.
+ *
+ *   static const fsm::Node<status, ctx_t, cmd_t> nodes[] = { ... };   // enum order
+ *   static const fsm::Row<status, ctx_t> rows[] = {
+ *     fsm::any_row(timed_out, RETURN, set_return_mode),
+ *     fsm::row(SEARCH, target_centred, APPROACH),
+ *     ...
+ *   };
+ *   fsm::Machine<status, ctx_t, cmd_t, NSTATES, NROWS> machine(nodes, rows, INIT);
+ *   every tick : machine.step(ctx, cmd);
+ *
+ * Per step: the any_row()s are checked first, then the rows of the current
+ * state, in table order. The first guard that holds fires. It runs its action,
+ * then the new state's enter hook. At most one transition happens per step.
+ * Finally the (possibly new) state's run writes the command.
+ */
+namespace fsm {
+
+template <typename State, typename Context>
+struct Row {
+  typedef bool (*Guard)(const Context& ctx, uint32_t in_state);
+  typedef void (*Action)(Context& ctx);
+
+  State from;
+  State to;
+  Guard guard;
+  Action action;
+  bool any;     // fires from every state
+};
+
+template <typename State, typename Context>
+Row<State, Context> row(State from, bool (*guard)(const Context&, uint32_t), State to,
+                        void (*action)(Context&))
+{
+  Row<State, Context> r = { from, to, guard, action, false };
+  return r;
+}
+
+template <typename State, typename Context>
+Row<State, Context> row(State from, bool (*guard)(const Context&, uint32_t), State to)
+{
+  return row(from, guard, to, (void (*)(Context&)) NULL);
+}
+
+template <typename State, typename Context>
+Row<State, Context> any_row(bool (*guard)(const Context&, uint32_t), State to,
+                            void (*action)(Context&))
+{
+  Row<State, Context> r = { to, to, guard, action, true };
+  return r;
+}
+
+template <typename State, typename Context>
+Row<State, Context> any_row(bool (*guard)(const Context&, uint32_t), State to)
+{
+  return any_row(guard, to, (void (*)(Context&)) NULL);
+}
+
+template <typename State, typename Context, typename Command>
+struct Node {
+  typedef void (*Enter)(Context& ctx);
+  typedef void (*Run)(Context& ctx, uint32_t in_state, Command& cmd);
+
+  State id;       // must equal the node's index in the table
+  const char* name;
+  Enter enter;    // may be NULL
+  Run run;        // may be NULL : the state sends the neutral command
+};
+
+/* Trace : fixed-size ring of the most recent transitions */
+template <typename State>
+class Trace {
+public:
+  struct Entry {
+    uint32_t tick;      // machine step the transition fired on
+    uint32_t in_state;  // ticks spent in `from`
+    State from, to;
+    int row;            // index of the row that fired
+  };
+
+  explicit Trace(size_t capacity) : buf_(capacity), next_(0), size_(0) { assert(capacity > 0); }
+
+  void record(const Entry& e) {
+    buf_[next_] = e;
+    next_ = (next_ + 1) % buf_.size();
+    if(size_ < buf_.size()) size_++;
+  }
+
+  size_t size() const { return size_; }
+
+  /* i = 0 is the oldest entry still held */
+  const Entry& operator[](size_t i) const {
+    return buf_[(next_ + buf_.size() - size_ + i) % buf_.size()];
+  }
+
+  void clear() { next_ = size_ = 0; }
+
+  /* one line per transition; names[] is indexed by state */
+  void dump(FILE* out, const char* const* names) const {
+    for(size_t i=0; i<size_; i++) {
+      const Entry& e = (*this)[i];
+      fprintf(out, "%8u  %-18s -> %-18s after %5u ticks (row %d)\n",
+              e.tick, names[e.from], names[e.to], e.in_state, e.row);
+    }
+  }
+
+private:
+  std::vector<Entry> buf_;
+  size_t next_;
+  size_t size_;
+};
+
+template <typename State, typename Context, typename Command, size_t NSTATES, size_t NROWS>
+class Machine {
+public:
+  typedef Node<State, Context, Command> node_type;
+  typedef Row<State, Context> row_type;
+
+  Machine(const node_type (&nodes)[NSTATES], const row_type (&rows)[NROWS], State initial)
+    : nodes_(nodes), rows_(rows), state_(initial), in_state_(0), ticks_(0), trace_(NULL)
+  {
+    for(size_t i=0; i<NSTATES; i++) {
+      names_[i] = nodes_[i].name;
+      assert((size_t) nodes_[i].id == i && "fsm node table is not in enum order");
+    }
+
+    /* bucket the rows by from-state once, keeping table order inside a bucket */
+    n_any_ = 0;
+    for(size_t r=0; r<NROWS; r++) {
+      assert((size_t) rows_[r].to < NSTATES && rows_[r].guard);
+      if(rows_[r].any) order_[n_any_++] = r;
+    }
+    size_t k = n_any_;
+    for(size_t s=0; s<NSTATES; s++) {
+      first_[s] = k;
+      for(size_t r=0; r<NROWS; r++)
+        if(!rows_[r].any && (size_t) rows_[r].from == s) order_[k++] = r;
+    }
+    first_[NSTATES] = k;
+    assert(k == NROWS);
+  }
+
+  /* record every transition into `trace` (NULL to stop) */
+  void attach(Trace<State>* trace) { trace_ = trace; }
+
+  /* one control tick; returns true if the state changed */
+  bool step(Context& ctx, Command& cmd) {
+    int fired = -1;
+    for(size_t i=0; i<n_any_ && fired < 0; i++)
+      if(rows_[order_[i]].guard(ctx, in_state_)) fired = order_[i];
+    for(size_t i=first_[state_]; i<first_[state_ + 1] && fired < 0; i++)
+      if(rows_[order_[i]].guard(ctx, in_state_)) fired = order_[i];
+
+    if(fired >= 0) {
+      const row_type& r = rows_[fired];
+      if(trace_) {
+        typename Trace<State>::Entry e = { ticks_, in_state_, state_, r.to, fired };
+        trace_->record(e);
+      }
+      if(r.action) r.action(ctx);
+      state_ = r.to;
+      in_state_ = 0;
+      if(nodes_[state_].enter) nodes_[state_].enter(ctx);
+    }
+
+    if(nodes_[state_].run) nodes_[state_].run(ctx, in_state_, cmd);
+    in_state_++;
+    ticks_++;
+    return fired >= 0;
+  }
+
+  State state() const { return state_; }
+  const char* name() const { return names_[state_]; }
+  const char* const* names() const { return names_; }
+  uint32_t in_state() const { return in_state_; }
+  uint32_t ticks() const { return ticks_; }
+
+private:
+  const node_type (&nodes_)[NSTATES];
+  const row_type (&rows_)[NROWS];
+
+  size_t order_[NROWS];
+  size_t first_[NSTATES + 1];
+  size_t n_any_;
+  const char* names_[NSTATES];
+
+  State state_;
+  uint32_t in_state_;
+  uint32_t ticks_;
+  Trace<State>* trace_;
+};
+
+} // namespace fsm
+
+#endif
@@ -0,0 +1,451 @@
+#include "data_integrate/local_planner.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <math.h>
+
+namespace local_planner {
+
+namespace {
+
+const float INF = std::numeric_limits<float>::infinity();
+
+/* cost of a straight step; a diagonal one costs DIAG */
+const int32_t STEP = 100;
+const int32_t DIAG = 141;
+
+/* unreachable; sums saturate here so g == rhs compares unreachable cells equal */
+const int32_t UNREACHABLE = 1 << 28;
+
+inline int32_t add(int32_t a, int32_t b)
+{
+  return (a >= UNREACHABLE || b >= UNREACHABLE) ? UNREACHABLE : a + b;
+}
+
+/* (dx, dy) of every cell whose centre is within `radius` cells of the origin */
+void make_disc(float radius, std::vector<int>& disc)
+{
+  disc.clear();
+  int r = (int) ceil(radius);
+  for(int dy=-r; dy<=r; dy++)
+    for(int dx=-r; dx<=r; dx++)
+      if(dx*dx + dy*dy <= radius*radius) {
+        disc.push_back(dx);
+        disc.push_back(dy);
+      }
+}
+
+float wrap(float a)
+{
+  while(a > M_PI) a -= 2*M_PI;
+  while(a < -M_PI) a += 2*M_PI;
+  return a;
+}
+
+}
+
+LocalPlanner::LocalPlanner(const PlannerParams& params)
+{
+  setParams(params);
+}
+
+void LocalPlanner::setParams(const PlannerParams& params)
+{
+  params_ = params;
+  n_ = params_.size * params_.size;
+
+  scan_.assign(n_, 0);
+  red_.assign(n_, 0);
+  blocked_.assign(n_, 0);
+  scratch_.assign(n_, 0);
+  changed_.clear();
+  red_x_.clear();
+  red_y_.clear();
+
+  make_disc(params_.robot_radius / params_.resolution, scan_disc_);
+  make_disc((params_.robot_radius + params_.red_radius) / params_.resolution, red_disc_);
+
+  static const int DX[8] = { 1, 1, 0, -1, -1, -1, 0, 1 };
+  static const int DY[8] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+  for(int d=0; d<8; d++) {
+    dx_[d] = DX[d];
+    dy_[d] = DY[d];
+    step_[d] = DY[d] * params_.size + DX[d];
+    len_[d] = (DX[d] && DY[d]) ? DIAG : STEP;
+  }
+
+  g_.assign(n_, UNREACHABLE);
+  rhs_.assign(n_, UNREACHABLE);
+  key_.assign(n_, Key());
+  heap_.clear();
+  heap_pos_.assign(n_, -1);
+
+  goal_ = start_ = last_ = -1;
+  km_ = 0;
+  expanded_ = 0;
+  searching_ = false;
+  plan_ms_ = 0;
+}
+
+int LocalPlanner::cellAt(float x, float y) const
+{
+  int cx = (int) floor((x - params_.origin_x) / params_.resolution);
+  int cy = (int) floor((y - params_.origin_y) / params_.resolution);
+  if(cx < 0 || cy < 0 || cx >= params_.size || cy >= params_.size) return -1;
+  return cy * params_.size + cx;
+}
+
+float LocalPlanner::cellX(int c) const
+{
+  return params_.origin_x + ((c % params_.size) + 0.5f) * params_.resolution;
+}
+
+float LocalPlanner::cellY(int c) const
+{
+  return params_.origin_y + ((c / params_.size) + 0.5f) * params_.resolution;
+}
+
+bool LocalPlanner::blocked(float x, float y) const
+{
+  int c = cellAt(x, y);
+  return c >= 0 && blocked_[c];
+}
+
+bool LocalPlanner::setGoal(float x, float y)
+{
+  std::fill(g_.begin(), g_.end(), UNREACHABLE);
+  std::fill(rhs_.begin(), rhs_.end(), UNREACHABLE);
+  for(size_t i=0; i<heap_.size(); i++) heap_pos_[heap_[i]] = -1;
+  heap_.clear();
+  km_ = 0;
+  start_ = last_ = -1;
+
+  goal_ = cellAt(x, y);
+  if(goal_ < 0) return false;
+
+  /* the key is refreshed against the start on the first expansion */
+  rhs_[goal_] = 0;
+  Key k = { 0, 0 };
+  heapPush(goal_, k);
+  return true;
+}
+
+void LocalPlanner::stamp(std::vector<uint8_t>& layer, float x, float y, const std::vector<int>& disc)
+{
+  int cx = (int) floor((x - params_.origin_x) / params_.resolution);
+  int cy = (int) floor((y - params_.origin_y) / params_.resolution);
+  const int size = params_.size;
+  for(size_t i=0; i<disc.size(); i+=2) {
+    int px = cx + disc[i], py = cy + disc[i+1];
+    if(px < 0 || py < 0 || px >= size || py >= size) continue;
+    layer[py * size + px] = 1;
+  }
+}
+
+void LocalPlanner::collectChanges()
+{
+  for(int c=0; c<n_; c++) {
+    uint8_t b = scan_[c] | red_[c];
+    if(b != blocked_[c]) {
+      blocked_[c] = b;
+      changed_.push_back(c);
+    }
+  }
+}
+
+void LocalPlanner::setScan(const float* ranges, int n, float angle_min, float angle_increment,
+                           float x, float y, float theta)
+{
+  std::fill(scratch_.begin(), scratch_.end(), 0);
+  for(int i=0; i<n; i++) {
+    float r = ranges[i];
+    if(!(r > 0) || r > params_.scan_max_range) continue;   // also skips nan
+    float a = theta + angle_min + angle_increment * i;
+    stamp(scratch_, x + r * cos(a), y + r * sin(a), scan_disc_);
+  }
+  scan_.swap(scratch_);
+  collectChanges();
+}
+
+void LocalPlanner::addRed(float x, float y)
+{
+  float merge2 = params_.red_merge * params_.red_merge;
+  for(size_t i=0; i<red_x_.size(); i++) {
+    float dx = red_x_[i] - x, dy = red_y_[i] - y;
+    if(dx*dx + dy*dy < merge2) return;
+  }
+  red_x_.push_back(x);
+  red_y_.push_back(y);
+  stamp(red_, x, y, red_disc_);
+  collectChanges();
+}
+
+void LocalPlanner::clearRed()
+{
+  red_x_.clear();
+  red_y_.clear();
+  std::fill(red_.begin(), red_.end(), 0);
+  collectChanges();
+}
+
+/* octile distance; admissible and consistent for 8-connected moves */
+LocalPlanner::Cost LocalPlanner::heuristic(int a, int b) const
+{
+  int dx = abs(a % params_.size - b % params_.size);
+  int dy = abs(a / params_.size - b / params_.size);
+  return STEP * std::max(dx, dy) + (DIAG - STEP) * std::min(dx, dy);
+}
+
+/* moving from `from` into `to`, its neighbour in direction d */
+LocalPlanner::Cost LocalPlanner::cost(int, int to, int dir) const
+{
+  return blocked_[to] ? UNREACHABLE : len_[dir];
+}
+
+LocalPlanner::Key LocalPlanner::calculateKey(int c) const
+{
+  Cost m = std::min(g_[c], rhs_[c]);
+  Key k = { add(m, heuristic(start_, c) + km_), m };
+  return k;
+}
+
+/* neighbour of c in direction d, or -1 off the grid */
+#define NEIGHBOUR(c, d) ( \
+  ((c) % params_.size + dx_[d] < 0 || (c) % params_.size + dx_[d] >= params_.size || \
+   (c) / params_.size + dy_[d] < 0 || (c) / params_.size + dy_[d] >= params_.size) ? -1 : (c) + step_[d])
+
+int LocalPlanner::bestSuccessor(int c) const
+{
+  int best = -1;
+  Cost best_t = UNREACHABLE;
+  for(int d=0; d<8; d++) {
+    int s = NEIGHBOUR(c, d);
+    if(s < 0) continue;
+    Cost t = add(cost(c, s, d), g_[s]);
+    if(t < best_t) {
+      best_t = t;
+      best = s;
+    }
+  }
+  return best;
+}
+
+void LocalPlanner::updateVertex(int c)
+{
+  if(c != goal_) {
+    Cost r = UNREACHABLE;
+    for(int d=0; d<8; d++) {
+      int s = NEIGHBOUR(c, d);
+      if(s >= 0) r = std::min(r, add(cost(c, s, d), g_[s]));
+    }
+    rhs_[c] = r;
+  }
+
+  bool queued = heap_pos_[c] >= 0;
+  if(g_[c] != rhs_[c]) {
+    if(queued) heapUpdate(c, calculateKey(c));
+    else heapPush(c, calculateKey(c));
+  }
+  else if(queued) {
+    heapRemove(c);
+  }
+}
+
+void LocalPlanner::computeShortestPath()
+{
+  searching_ = false;
+  while(!heap_.empty() && (topKey() < calculateKey(start_) || rhs_[start_] != g_[start_])) {
+    if(expanded_ >= params_.max_expansions) {
+      searching_ = true;
+      return;
+    }
+    int u = heap_[0];
+    Key k_old = key_[u];
+    Key k_new = calculateKey(u);
+    expanded_++;
+
+    if(k_old < k_new) {
+      heapUpdate(u, k_new);
+    }
+    else if(g_[u] > rhs_[u]) {
+      g_[u] = rhs_[u];
+      heapRemove(u);
+      for(int d=0; d<8; d++) {
+        int s = NEIGHBOUR(u, d);
+        if(s < 0 || s == goal_) continue;
+        Cost t = add(cost(s, u, d), g_[u]);
+        if(t < rhs_[s]) {
+          rhs_[s] = t;
+          if(heap_pos_[s] >= 0) heapUpdate(s, calculateKey(s));
+          else heapPush(s, calculateKey(s));
+        }
+      }
+    }
+    else {
+      Cost g_old = g_[u];
+      g_[u] = UNREACHABLE;
+      for(int d=0; d<8; d++) {
+        int s = NEIGHBOUR(u, d);
+        if(s < 0 || s == goal_) continue;
+        if(rhs_[s] == add(cost(s, u, d), g_old)) updateVertex(s);
+      }
+      updateVertex(u);
+    }
+  }
+}
+
+bool LocalPlanner::plan(float x, float y)
+{
+  std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+  expanded_ = 0;
+
+  int start = cellAt(x, y);
+  bool found = false;
+  if(goal_ >= 0 && start >= 0) {
+    /* keys already queued were computed from the old start; raise the rest instead of re-keying */
+    if(last_ >= 0) km_ += heuristic(last_, start);
+    last_ = start_ = start;
+
+    for(size_t i=0; i<changed_.size(); i++) {
+      int c = changed_[i];
+      for(int d=0; d<8; d++) {
+        int s = NEIGHBOUR(c, d);
+        if(s >= 0) updateVertex(s);
+      }
+    }
+    changed_.clear();
+
+    computeShortestPath();
+    found = !searching_ && rhs_[start_] < UNREACHABLE;
+  }
+  else {
+    start_ = -1;
+    searching_ = false;
+  }
+
+  plan_ms_ = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+  return found;
+}
+
+bool LocalPlanner::waypoint(float& wx, float& wy) const
+{
+  if(start_ < 0 || goal_ < 0 || searching_ || rhs_[start_] >= UNREACHABLE) return false;
+
+  int c = start_;
+  float travelled = 0, ahead = params_.lookahead / params_.resolution;
+  while(c != goal_ && travelled < ahead) {
+    int s = bestSuccessor(c);
+    if(s < 0) break;
+    int dx = s % params_.size - c % params_.size;
+    int dy = s / params_.size - c / params_.size;
+    travelled += (dx && dy) ? (float) M_SQRT2 : 1.0f;
+    c = s;
+  }
+  wx = cellX(c);
+  wy = cellY(c);
+  return true;
+}
+
+float LocalPlanner::pathLength() const
+{
+  if(start_ < 0 || goal_ < 0 || rhs_[start_] >= UNREACHABLE) return INF;
+  return rhs_[start_] * params_.resolution / STEP;
+}
+
+float LocalPlanner::goalDistance() const
+{
+  if(start_ < 0 || goal_ < 0) return INF;
+  return hypotf(cellX(goal_) - cellX(start_), cellY(goal_) - cellY(start_));
+}
+
+Twist LocalPlanner::command(float x, float y, float theta) const
+{
+  Twist cmd = { 0, 0 };
+  float wx, wy;
+  if(!waypoint(wx, wy)) return cmd;
+
+  float dist = hypotf(wx - x, wy - y);
+  if(dist < 1e-3f) return cmd;
+
+  float err = wrap(atan2f(wy - y, wx - x) - theta);
+  cmd.w = std::max(-params_.max_w, std::min(params_.max_w, 2.0f * err));
+  if(fabs(err) < params_.turn_in_place)
+    cmd.v = params_.max_v * cos(err) * std::min(1.0f, dist / params_.lookahead);
+  return cmd;
+}
+
+#undef NEIGHBOUR
+
+/* --- indexed heap --- */
+
+LocalPlanner::Key LocalPlanner::topKey() const
+{
+  if(heap_.empty()) {
+    Key k = { UNREACHABLE, UNREACHABLE };
+    return k;
+  }
+  return key_[heap_[0]];
+}
+
+void LocalPlanner::heapPush(int c, const Key& k)
+{
+  key_[c] = k;
+  heap_pos_[c] = (int) heap_.size();
+  heap_.push_back(c);
+  heapUp(heap_pos_[c]);
+}
+
+void LocalPlanner::heapRemove(int c)
+{
+  int i = heap_pos_[c];
+  int last = heap_.back();
+  heap_.pop_back();
+  heap_pos_[c] = -1;
+  if(last == c) return;
+
+  heap_[i] = last;
+  heap_pos_[last] = i;
+  heapUp(i);
+  heapDown(heap_pos_[last]);
+}
+
+void LocalPlanner::heapUpdate(int c, const Key& k)
+{
+  key_[c] = k;
+  heapUp(heap_pos_[c]);
+  heapDown(heap_pos_[c]);
+}
+
+void LocalPlanner::heapUp(int i)
+{
+  int c = heap_[i];
+  while(i > 0) {
+    int parent = (i - 1) / 2;
+    if(!(key_[c] < key_[heap_[parent]])) break;
+    heap_[i] = heap_[parent];
+    heap_pos_[heap_[i]] = i;
+    i = parent;
+  }
+  heap_[i] = c;
+  heap_pos_[c] = i;
+}
+
+void LocalPlanner::heapDown(int i)
+{
+  int c = heap_[i];
+  int n = (int) heap_.size();
+  for(;;) {
+    int child = 2 * i + 1;
+    if(child >= n) break;
+    if(child + 1 < n && key_[heap_[child + 1]] < key_[heap_[child]]) child++;
+    if(!(key_[heap_[child]] < key_[c])) break;
+    heap_[i] = heap_[child];
+    heap_pos_[heap_[i]] = i;
+    i = child;
+  }
+  heap_[i] = c;
+  heap_pos_[c] = i;
+}
+
+}
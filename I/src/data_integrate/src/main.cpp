@@ -15,6 +15,7 @@
 #include <boost/thread.hpp>
 #include <ros/ros.h>
 #include <ros/package.h>
+#include "robot_link/ros_config.h"
 
 #include "core_msgs/ball_position.h"
 #include "core_msgs/roller_num.h"
@@ -25,6 +26,10 @@
 
 #include "opencv2/opencv.hpp"
 #include "util_rtn.hpp"
+#include "control_executor.hpp"
+#include "fsm.hpp"
+#include "data_integrate/ball_world.h"
+#include "data_integrate/local_planner.h"
 
 #define POLICY LEFTMOST
 #define WEBCAM
@@ -46,57 +51,105 @@
 #define RELIABLE
 #define UNRELIABLE
 
-/* State of our machine = SEARCH phase by default */
-enum status machine_status = INIT;
-enum status recent_status = INIT;
-
 /* Number of balls holding */
 int ball_cnt = 0;
 
+/*
+ * Everything the perception callbacks produce. The callbacks fill `sensed` on
+ * the perception thread and publish it whole; every control tick copies the
+ * newest snapshot into `seen`, which the usual names below refer to, so the
+ * state machine never sees a half-written message.
+ */
+struct perception_state {
+#ifdef WEBCAM
+  /* CAM01 */
+  uint32_t frame;   // counts /position messages
+  double stamp;
+  int blue_cnt, red_cnt, green_cnt;
+  float blue_x[20], blue_y[20], blue_z[20];
+  float red_x[20], red_y[20], red_z[20];
+  float green_x[20], green_y[20], green_z[20];
+
+  /* CAM02 */
+  uint32_t frame_top;
+  double stamp_top;
+  int blue_cnt_top, red_cnt_top, green_cnt_top;
+  float blue_x_top[20], blue_y_top[20], blue_z_top[20];
+  float red_x_top[20], red_y_top[20], red_z_top[20];
+  float green_x_top[20], green_y_top[20], green_z_top[20];
+
+  /* CAM03 */
+  size_t dupACKcnt;
+#endif
+
+#ifdef LIDAR
+  /* Absolute position relative to start pos */
+  float xpos_abs, ypos_abs, theta_abs;
+
+  /* newest /scan, for the return planner's costmap */
+  uint32_t scan_frame;
+  int scan_cnt;
+  float scan_angle_min, scan_angle_inc;
+  float scan_range[720];
+#endif
+};
+
+perception_state sensed = perception_state();   // perception thread only
+perception_state seen = perception_state();     // control thread only
+Snapshot<perception_state> perception;
+
+#ifdef WEBCAM
+/* Ball tracks, control thread only. track_balls() feeds them each new camera
+ * frame and replaces the raw detections in `seen` with the reported tracks. */
+ball_world::BallWorld world;
+ball_world::BallWorld world_top;
+uint32_t world_frame = 0, world_frame_top = 0;
+void track_balls();
+#endif
+
 #ifdef WEBCAM
 /* Blue balls */
-int blue_cnt;
-float blue_x[20];
-float blue_y[20];
-float blue_z[20];
+int& blue_cnt = seen.blue_cnt;
+float (&blue_x)[20] = seen.blue_x;
+float (&blue_y)[20] = seen.blue_y;
+float (&blue_z)[20] = seen.blue_z;
 
 float recent_target_b_x, recent_target_b_z;
 
 /* Red balls */
-int red_cnt;
-float red_x[20];
-float red_y[20];
-float red_z[20];
+int& red_cnt = seen.red_cnt;
+float (&red_x)[20] = seen.red_x;
+float (&red_y)[20] = seen.red_y;
+float (&red_z)[20] = seen.red_z;
 
 /* Green balls */
-int green_cnt;
-float green_x[20];
-float green_y[20];
-float green_z[20];
+int& green_cnt = seen.green_cnt;
+float (&green_x)[20] = seen.green_x;
+float (&green_y)[20] = seen.green_y;
+float (&green_z)[20] = seen.green_z;
 
 /* CAM02 */
-int blue_cnt_top;
-int red_cnt_top;
-int green_cnt_top;
-
-float blue_x_top[20];
-float blue_y_top[20];
-float blue_z_top[20];
-float red_x_top[20];
-float red_y_top[20];
-float red_z_top[20];
-float green_x_top[20];
-float green_y_top[20];
-float green_z_top[20];
+int& blue_cnt_top = seen.blue_cnt_top;
+int& red_cnt_top = seen.red_cnt_top;
+int& green_cnt_top = seen.green_cnt_top;
+
+float (&blue_x_top)[20] = seen.blue_x_top;
+float (&blue_y_top)[20] = seen.blue_y_top;
+float (&blue_z_top)[20] = seen.blue_z_top;
+float (&red_x_top)[20] = seen.red_x_top;
+float (&red_y_top)[20] = seen.red_y_top;
+float (&red_z_top)[20] = seen.red_z_top;
+float (&green_x_top)[20] = seen.green_x_top;
+float (&green_y_top)[20] = seen.green_y_top;
+float (&green_z_top)[20] = seen.green_z_top;
 
 /* CAM03 */
-size_t dupACKcnt = 0;
+size_t& dupACKcnt = seen.dupACKcnt;
 int return_mode = 0;
 #endif
 
 #ifdef MYRIO
-int c_socket, s_socket;
-struct sockaddr_in c_addr;
+robot_link::RobotLink myrio;
 int len;
 int n;
 float data[24];
@@ -104,9 +157,14 @@ float data[24];
 
 #ifdef LIDAR
 /* Absolute position relative to start pos */
-float xpos_abs;
-float ypos_abs;
-float theta_abs;
+float& xpos_abs = seen.xpos_abs;
+float& ypos_abs = seen.ypos_abs;
+float& theta_abs = seen.theta_abs;
+
+/* LIDAR_RETURN drives home along a D* Lite path around lidar hits and red balls */
+#define RETURN_GOAL_TOLERANCE 0.15f
+local_planner::LocalPlanner return_planner;
+uint32_t return_scan_frame = 0;
 #endif
 
 float x_offset, y_offset, z_offset, x_offset_top, z_offset_top;
@@ -118,6 +176,536 @@ int timeout = 60;
 float goal_theta;
 float goal_x, goal_z;
 
+/*
+ * Ball-collection behaviour as an fsm::Machine (see fsm.hpp).
+ * Every tick the machine is stepped with the newest perception snapshot and
+ * writes one command into data[]. Nothing here waits: timed phases watch
+ * in_state, the number of ticks spent in the current state.
+ * The bodies keep using the usual names (blue_x, red_z, ...), which alias `seen`.
+ */
+typedef float command_t[24];
+
+/* red ball in the way, closer than blue target `target` (-1 : no target) */
+bool red_blocks(int target) {
+  if(!red_in_range()) return false;
+  return target < 0 || red_z[closest_ball(RED)] <= blue_z[target];
+}
+
+/* goal pair for APPROACH_GREEN : the two green balls at the ends of the row */
+void green_pair(float& xg1, float& zg1, float& xg2, float& zg2) {
+  int i1 = (green_cnt == 2)? 0 : leftmost_green();
+  int i2 = (green_cnt == 2)? 1 : rightmost_green();
+  xg1 = green_x[i1]; zg1 = green_z[i1];
+  xg2 = green_x[i2]; zg2 = green_z[i2];
+}
+
+/* closest and furthest green ball, as the feedback stages see them */
+void green_feedback_pair(float& xg1, float& zg1, float& xg2, float& zg2) {
+  #ifdef UNRELIABLE
+  int idx_close = closest_ball(GREEN);
+  int idx_far = furthest_green();
+  #else
+  int idx_close = 0;
+  int idx_far = 1;
+  #endif
+  xg1 = green_x[idx_close]; zg1 = green_z[idx_close];
+  xg2 = green_x[idx_far]; zg2 = green_z[idx_far];
+}
+
+float green_angle() {
+  float xg1, zg1, xg2, zg2;
+  green_feedback_pair(xg1, zg1, xg2, zg2);
+  return RAD2DEG(atan((zg2 - zg1) / (xg2 - xg1)));
+}
+
+#ifdef LIDAR
+/* costmap of the return planner : the newest scan, and red tracks at their place in the lidar frame */
+void update_return_map(float x, float y, float theta) {
+  if(seen.scan_frame != return_scan_frame) {
+    return_scan_frame = seen.scan_frame;
+    return_planner.setScan(seen.scan_range, seen.scan_cnt, seen.scan_angle_min, seen.scan_angle_inc, x, y, theta);
+  }
+  #ifdef WEBCAM
+  /* camera : x right, z forward */
+  for(int i=0; i<red_cnt; i++)
+    return_planner.addRed(x + red_z[i] * cos(theta) + red_x[i] * sin(theta),
+                          y + red_z[i] * sin(theta) - red_x[i] * cos(theta));
+  #endif
+}
+
+/* the myRIO takes the gamepad macros, not velocities : turn when the planner turns, else drive */
+void drive(const local_planner::Twist& cmd, command_t& data) {
+  if(cmd.v <= 0 && cmd.w > 0) TURN_LEFT
+  else if(cmd.v <= 0 && cmd.w < 0) TURN_RIGHT
+  else if(cmd.w > 0.35f) TURN_LEFT_SLOW
+  else if(cmd.w < -0.35f) TURN_RIGHT_SLOW
+  else if(cmd.v > 0) GO_FRONT
+}
+#endif
+
+uint32_t goal_rotate_ticks() { return (uint32_t) (ROTATE_CONST_SLOW * fabs(goal_theta)); }
+uint32_t goal_translate_ticks() { return (uint32_t) (TRANSLATE_CONST_SLOW * fabs(goal_x)); }
+
+/* --- guards --- */
+
+#ifdef WEBCAM
+bool dup_ack(const perception_state&, uint32_t) { return dupACKcnt >= 3 && !return_mode; }  // 3 Duplicate ACK
+#endif
+
+bool timed_out(const perception_state&, uint32_t) { return timer_ticks > 40 * timeout && !return_mode; }
+
+bool init_done(const perception_state&, uint32_t in_state) { return in_state >= 80; }
+
+bool blue_centred(const perception_state&, uint32_t) {
+  int target_b = leftmost_blue();
+  return target_b >= 0 && fabs(blue_x[target_b]) <= 0.15;
+}
+
+bool red_ahead(const perception_state&, uint32_t) { return red_blocks(leftmost_blue()); }
+
+bool blue_lost(const perception_state&, uint32_t) {
+  int target_b = leftmost_blue();
+  return target_b < 0 || fabs(blue_x[target_b]) >= 0.20;
+}
+
+bool blue_close(const perception_state&, uint32_t) { return blue_z[leftmost_blue()] < 0.2; }
+
+bool red_passed(const perception_state&, uint32_t) {
+  return red_phase2 && timer_ticks - current_ticks > DISTANCE_TICKS && !return_mode;
+}
+
+bool red_passed_returning(const perception_state&, uint32_t) {
+  return red_phase2 && timer_ticks - current_ticks > DISTANCE_TICKS && return_mode;
+}
+
+bool blue_aligned(const perception_state&, uint32_t) {
+  int target = leftmost_blue();
+  return target < 0 || fabs(blue_x[target]) <= 0.013;
+}
+
+bool collect_done(const perception_state&, uint32_t in_state) { return in_state > DISTANCE_TICKS_CL; }
+
+#ifdef LIDAR
+bool red_in_path(const perception_state&, uint32_t) { return red_in_range(); }
+
+bool at_home_heading(const perception_state&, uint32_t) {
+  return theta_abs <= 190.0f && theta_abs >= 170.0f && xpos_abs <= 2.0f;
+}
+#else
+bool always(const perception_state&, uint32_t) { return true; }
+#endif
+
+bool green_in_reach(const perception_state&, uint32_t) {
+  int target_g_top = leftmost_green_top();
+  return target_g_top >= 0 && green_z_top[target_g_top] <= 0.8;
+}
+
+bool green_goal_found(const perception_state&, uint32_t) {
+  if(green_cnt > 2) return true;   // evaluation over UNRELIABLE openCV
+  if(green_cnt < 2) return false;
+
+  /* Make sure one ball is recognized as 2 */
+  if(DIST(green_x[0],green_z[0],green_x[1],green_z[1]) <= 0.05) return false;
+
+  float mid_x = 0.5 * (green_x[0] + green_x[1]);
+  return mid_x < 0.1f && mid_x > -0.1f && green_x[0] <= 0.25 && green_x[1] <= 0.25;
+}
+
+bool openloop_done(const perception_state&, uint32_t in_state) {
+  return in_state >= goal_rotate_ticks() + goal_translate_ticks();
+}
+
+bool green_pair_lost(const perception_state&, uint32_t) { return green_cnt < 2; }
+
+bool green_square(const perception_state&, uint32_t) { return fabs(green_angle()) <= 1.6f; }
+
+bool green_centred(const perception_state&, uint32_t) {
+  float xg1, zg1, xg2, zg2;
+  green_feedback_pair(xg1, zg1, xg2, zg2);
+  return fabs(0.5f * (xg1 + xg2)) <= 0.01f;
+}
+
+bool green_square_unreliable(const perception_state&, uint32_t) {
+  float theta = RAD2DEG(atan((green_z[1]-green_z[0])/(green_x[1]-green_x[0])));
+  return theta >= -1.5f && theta <= 1.5f;
+}
+
+/* --- actions --- */
+
+void enter_return_mode(perception_state&) { return_mode = 1; }
+
+#ifdef LIDAR
+void enter_lidar_return(perception_state&) { return_planner.setGoal(0, 0); }
+#endif
+
+void enter_timeout_return(perception_state&) {
+  printf("(%s) switching to return mode after %.2f s of timeout\n", TESTENV, (float) timeout);
+  return_mode = 1;
+}
+
+void report_lost_target(perception_state&) {
+  if(leftmost_blue() < 0)
+    printf("recent target blue was at (%.3f, %.3f)\n", recent_target_b_x, recent_target_b_z);
+}
+
+void count_ball(perception_state&) {
+  if(fabs(recent_target_b_x)<0.133)
+    printf("(%s) collected ball. ball_count = %d\n",TESTENV , ++ball_cnt);
+}
+
+#ifndef LIDAR
+void report_no_lidar(perception_state&) {
+  printf("(%s) LIDAR_RETURN : built without LIDAR (catkin_make -DLIDAR=ON). Exitting.\n", TESTENV);
+}
+#endif
+
+void set_green_goal(perception_state&) {
+  if(green_cnt > 2)
+    printf("(%s) APPROACH_GREEN : evaluation in unreliable mode : there are %d green balls\n",TESTENV, green_cnt);
+
+  float xg1, zg1, xg2, zg2;
+  green_pair(xg1, zg1, xg2, zg2);
+
+  float degree_ = atan((zg2-zg1)/(xg2-xg1));
+  float mid_x = 0.5 * (xg1 + xg2);
+  float mid_z = 0.5 * (zg1 + zg2);
+
+  float mid_x_trn_ = mid_x * cos(degree_) + mid_z * sin(degree_);
+  float mid_z_trn_ = mid_z * cos(degree_) - mid_x * sin(degree_);
+
+  goal_theta = RAD2DEG(degree_);
+  goal_x = mid_x_trn_;
+  goal_z = mid_z_trn_;
+  printf("(%s) angular offset = %.3f deg, x_ofs = %.3f, z_ofs = %.3f\n", TESTENV, RAD2DEG(degree_), mid_x_trn_, mid_z_trn_);
+}
+
+void report_aligned(perception_state&) {
+  printf("(%s) openloop - aligned %.3f degrees, %.3f meters\n",TESTENV, goal_theta, goal_x);
+}
+
+void report_pair_lost(perception_state&) {
+  printf("(%s) APPROACH_GREEN : there are %d balls. phase out to APPROACH_GREEN\n", TESTENV, green_cnt);
+}
+
+void report_square(perception_state&) {
+  printf("(%s) finished alignment. angular deviation = %.4f deg\n",TESTENV, green_angle());
+}
+
+/* --- states --- */
+
+void run_init(perception_state&, uint32_t, command_t& data) {
+  MSGE("go front 2m first")
+  GO_FRONT
+}
+
+void run_search(perception_state&, uint32_t, command_t& data) {
+  int target_b = leftmost_blue();
+  int target_b_top = leftmost_blue_top();
+
+  if(target_b < 0) {
+    if(target_b_top >= 0) {
+      float xpos_top_b = blue_x_top[target_b_top];
+      if(xpos_top_b >= 0.3) TURN_RIGHT
+      else if(xpos_top_b <= -0.3) TURN_LEFT
+      else GO_FRONT
+    } else {
+      TURN_RIGHT
+    }
+  } else {
+    if(blue_x[target_b] > 0.15) {
+      TURN_RIGHT // ROS_INFO("search - R");
+    } else if(blue_x[target_b] < -0.15) {
+      TURN_LEFT //  ROS_INFO("search - L");
+    }
+  }
+}
+
+void run_approach(perception_state&, uint32_t, command_t& data) { GO_FRONT }
+
+void enter_red_avoidance(perception_state&) { red_phase2 = false; }
+
+void run_red_avoidance(perception_state&, uint32_t, command_t& data) {
+  if(!red_in_range() && !red_phase2){
+    red_phase2 = true;
+    printf("(%s) RED_AVOIDANCE_2\n", TESTENV);
+    current_ticks = timer_ticks;
+  }
+
+  if(!red_phase2) TURN_LEFT
+  else GO_FRONT
+}
+
+void run_collect(perception_state&, uint32_t, command_t& data) {
+  ROLLER_ON
+
+  int target = leftmost_blue();
+  if(target < 0) return;
+
+  float xpos = blue_x[target];
+  if(xpos > 0.013) {
+    TURN_RIGHT_SLOW ROLLER_ON //printf("col-R\n");
+  } else if(xpos < -0.013) {
+    TURN_LEFT_SLOW ROLLER_ON //printf("col-L\n");
+  }
+
+  recent_target_b_x = blue_x[target];
+  recent_target_b_z = blue_z[target];
+}
+
+void run_collect2(perception_state&, uint32_t, command_t& data) { GO_FRONT ROLLER_ON }
+
+void run_lidar_return(perception_state&, uint32_t, command_t& data) {
+  #ifdef LIDAR
+  float x = xpos_abs / 100.0f, y = ypos_abs / 100.0f, theta = RAD(theta_abs);
+  update_return_map(x, y, theta);
+
+  bool path = return_planner.plan(x, y);
+  MSGE("LIDAR_RETURN : replan " << return_planner.planMs() << " ms, " << return_planner.expanded() << " cells")
+  if(path && return_planner.goalDistance() > RETURN_GOAL_TOLERANCE) {
+    drive(return_planner.command(x, y, theta), data);
+    return;
+  }
+  if(return_planner.searching()) return;   // resumes next tick
+
+  /* at home, or no path : face the goal and close in as before */
+  if(theta_abs > 190.0f) {
+    MSGE("LIDAR_RETURN : turn left")
+    TURN_LEFT
+  } else if(theta_abs < 170.0f) {
+    MSGE("LIDAR_RETURN : turn right")
+    TURN_RIGHT
+  } else if(xpos_abs > 2.0f) {
+    MSGE("LIDAR_RETURN : go_front")
+    GO_FRONT
+  }
+  #endif
+}
+
+void run_search_green(perception_state&, uint32_t, command_t& data) {
+  int target_g_top = leftmost_green_top();
+  if(target_g_top < 0) { TURN_RIGHT return; }
+
+  float xpos = green_x_top[target_g_top];
+  if(xpos > 0.2){
+    TURN_RIGHT
+    if(!(timer_ticks%10)) printf("(%s) SEARCH_GREEN : turn right\n", TESTENV);
+  } else if(xpos < -0.2) {
+    TURN_LEFT
+    if(!(timer_ticks%10)) printf("(%s) SEARCH_GREEN : turn_left\n", TESTENV);
+  } else {
+    GO_FRONT
+    if(!(timer_ticks%10)) printf("(%s) SEARCH_GREEN : go_front\n", TESTENV);
+  }
+}
+
+void run_approach_green(perception_state&, uint32_t, command_t& data) {
+  switch(green_cnt) {
+    case 0:
+      TURN_RIGHT
+      if(!(timer_ticks % 10)) printf("(%s) APPROACH_GREEN : green_cnt = 0, turn right\n", TESTENV);
+      break;
+    case 1:
+      TURN_RIGHT_SLOW
+      if(!(timer_ticks%10)) printf("(%s) APPROACH_GREEN : green_cnt = 1, turn_right\n", TESTENV);
+      break;
+    case 2:
+    {
+      if(!(timer_ticks%10)) printf("(%s) APPROACH_GREEN : green_cnt = 2\n", TESTENV);
+
+      /* Make sure one ball is recognized as 2 */
+      if(DIST(green_x[0],green_z[0],green_x[1],green_z[1]) <= 0.05) { TURN_RIGHT break; }
+
+      float mid_x = 0.5 * (green_x[0] + green_x[1]);
+      if(mid_x >= 0.1f) {
+        if(!(timer_ticks%10)) printf("(%s) midpoint_x = %.3f : turn_right\n", TESTENV, mid_x);
+        TURN_RIGHT_SLOW
+      } else if(mid_x <= -0.1f) {
+        TURN_LEFT_SLOW
+        if(!(timer_ticks%10)) printf("(%s) midpoint_x = %.3f : turn_left\n", TESTENV, mid_x);
+      }
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+/*
+ * APPROACH_GREEN_2
+ * open-loop position control based on position evaluation of APPROACH_GREEN
+ * 1) ROTATE theta-ofs, 2) TRANSLATE X-ofs, 3) phase shift to APPROACH_GREEN_3
+ */
+void run_approach_green_2(perception_state&, uint32_t in_state, command_t& data) {
+  if(!(timer_ticks %10)) printf("(%s) estimated rotate ticks = %d, translate ticks = %d\n",TESTENV,(int) goal_rotate_ticks(), (int) goal_translate_ticks());
+
+  if(in_state < goal_rotate_ticks()) {
+    MSGE("openloop - rotation")
+    if(goal_theta > 0) TURN_LEFT_SLOW
+    else if(goal_theta < 0) TURN_RIGHT_SLOW
+  } else {
+    MSGE("openloop - translation")
+    if(goal_x < 0) TRANSLATE_LEFT
+    else TRANSLATE_RIGHT
+  }
+}
+
+/*
+ * APPROACH_GREEN_3
+ * feedback position(angular) control using CAM_btm
+ */
+void run_approach_green_3(perception_state&, uint32_t, command_t& data) {
+  float angular_ofs = green_angle();
+
+  if(!(timer_ticks%10)) printf("(%s) angle = %.4f\n", TESTENV, angular_ofs);
+
+  if(angular_ofs < -1.6f) {
+    MSGE("feedback - rotation CW")
+    TURN_RIGHT_SLOW
+  } else if(angular_ofs > 1.6f) {
+    MSGE("feedback - rotation CCW")
+    TURN_LEFT_SLOW
+  }
+}
+
+void run_approach_green_4(perception_state&, uint32_t, command_t& data) {
+  float xg1, zg1, xg2, zg2;
+  green_feedback_pair(xg1, zg1, xg2, zg2);
+  float x_ofs = 0.5f * (xg1 + xg2);
+
+  if(!(timer_ticks%10)) printf("(%s) X_offset = %.4f[m]\n", TESTENV, x_ofs);
+
+  if(x_ofs > 0.01f) {
+    MSGE("feedback - translation R")
+    TRANSLATE_RIGHT
+  } else if(x_ofs < -0.01f) {
+    MSGE("feedback - translation L")
+    TRANSLATE_LEFT
+  }
+}
+
+void run_approach_green_5(perception_state&, uint32_t, command_t& data) {
+  MSGE("APPROACH_GREEN - 5 : Control over UNRELIABLE actuator")
+
+  float xg1 = green_x[0];
+  float xg2 = green_x[1];
+  float zg1 = green_z[0];
+  float zg2 = green_z[1];
+
+  if(!(timer_ticks%10)) printf("(%.3f, %.3f), (%.3f, %.3f)\n", xg1, zg1, xg2, zg2);
+
+  assert(DIST(xg1,zg1,xg2,zg2)>=0.05);
+  float theta = RAD2DEG(atan((zg2-zg1)/(xg2-xg1)));
+  if(!(timer_ticks%10)) printf("theta = %.3f\n", theta);
+  if(theta < -1.5f) TURN_RIGHT_SLOW
+  else if(theta > 1.5f) TURN_LEFT_SLOW
+}
+
+void enter_release(perception_state&) { current_ticks = 0; }
+
+void run_release(perception_state&, uint32_t in_state, command_t& data) {
+  #ifndef LIDAR
+  uint32_t goal_front_ticks = (uint32_t) (280.0f * goal_z);
+
+  if(in_state < goal_front_ticks) {
+    MSGE("RELEASE - go front")
+    GO_FRONT
+  } else if(in_state < 100 + goal_front_ticks) {
+    MSGE("RELEASE - roller_reverse")
+    ROLLER_REVERSE
+  } else {
+    PANIC("RELEASE_TERMINATE : should have released 3 balls.")
+  }
+  #else
+  if(xpos_abs > 0.02f) {
+    MSGE("RELEASE - go front(feedback)")
+    GO_FRONT
+    current_ticks = 0;
+  } else {
+    MSGE("RELEASE - roller_reverse")
+    ROLLER_REVERSE
+    current_ticks++;
+  }
+
+  if(current_ticks > 500)
+    PANIC("RELEASE : terminating. should have released 3 balls.")
+  #endif
+}
+
+typedef fsm::Node<status, perception_state, command_t> behaviour_node;
+typedef fsm::Row<status, perception_state> behaviour_row;
+
+/* in enum status order */
+const behaviour_node behaviour_nodes[] = {
+  { INIT,             "INIT",             NULL,                run_init },
+  { SEARCH,           "SEARCH",           NULL,                run_search },
+  { APPROACH,         "APPROACH",         NULL,                run_approach },
+  { RED_AVOIDANCE,    "RED_AVOIDANCE",    enter_red_avoidance, run_red_avoidance },
+  { COLLECT,          "COLLECT",          NULL,                run_collect },
+  { COLLECT2,         "COLLECT2",         NULL,                run_collect2 },
+  #ifdef LIDAR
+  { LIDAR_RETURN,     "LIDAR_RETURN",     enter_lidar_return,  run_lidar_return },
+  #else
+  { LIDAR_RETURN,     "LIDAR_RETURN",     NULL,                run_lidar_return },
+  #endif
+  { SEARCH_GREEN,     "SEARCH_GREEN",     NULL,                run_search_green },
+  { APPROACH_GREEN,   "APPROACH_GREEN",   NULL,                run_approach_green },
+  { APPROACH_GREEN_2, "APPROACH_GREEN_2", NULL,                run_approach_green_2 },
+  { APPROACH_GREEN_3, "APPROACH_GREEN_3", NULL,                run_approach_green_3 },
+  { APPROACH_GREEN_4, "APPROACH_GREEN_4", NULL,                run_approach_green_4 },
+  { APPROACH_GREEN_5, "APPROACH_GREEN_5", NULL,                run_approach_green_5 },
+  { RELEASE,          "RELEASE",          enter_release,       run_release },
+};
+
+/* first matching row wins; rows of one state are tried top to bottom */
+const behaviour_row behaviour_rows[] = {
+  #ifdef WEBCAM
+  fsm::any_row(dup_ack, LIDAR_RETURN, enter_return_mode),
+  #endif
+  fsm::any_row(timed_out, LIDAR_RETURN, enter_timeout_return),
+
+  fsm::row(INIT, init_done, SEARCH),
+
+  fsm::row(SEARCH, blue_centred, APPROACH),
+
+  fsm::row(APPROACH, red_ahead, RED_AVOIDANCE),
+  fsm::row(APPROACH, blue_lost, SEARCH),
+  fsm::row(APPROACH, blue_close, COLLECT),
+
+  fsm::row(RED_AVOIDANCE, red_passed, SEARCH),
+  fsm::row(RED_AVOIDANCE, red_passed_returning, LIDAR_RETURN),
+
+  fsm::row(COLLECT, red_ahead, RED_AVOIDANCE),
+  fsm::row(COLLECT, blue_aligned, COLLECT2, report_lost_target),
+
+  fsm::row(COLLECT2, collect_done, SEARCH, count_ball),
+
+  #ifdef LIDAR
+  fsm::row(LIDAR_RETURN, red_in_path, RED_AVOIDANCE),
+  fsm::row(LIDAR_RETURN, at_home_heading, SEARCH_GREEN),
+  #else
+  fsm::row(LIDAR_RETURN, always, SEARCH_GREEN, report_no_lidar),
+  #endif
+
+  fsm::row(SEARCH_GREEN, green_in_reach, APPROACH_GREEN),
+
+  fsm::row(APPROACH_GREEN, green_goal_found, APPROACH_GREEN_2, set_green_goal),
+
+  fsm::row(APPROACH_GREEN_2, openloop_done, APPROACH_GREEN_3, report_aligned),
+
+  fsm::row(APPROACH_GREEN_3, green_pair_lost, APPROACH_GREEN, report_pair_lost),
+  fsm::row(APPROACH_GREEN_3, green_square, APPROACH_GREEN_4, report_square),
+
+  fsm::row(APPROACH_GREEN_4, green_centred, RELEASE),
+
+  fsm::row(APPROACH_GREEN_5, green_square_unreliable, RELEASE),
+};
+
+static_assert(sizeof(behaviour_nodes) / sizeof(behaviour_nodes[0]) == STATUS_COUNT,
+              "behaviour_nodes needs one entry per enum status");
+
+typedef fsm::Machine<status, perception_state, command_t, STATUS_COUNT,
+                     sizeof(behaviour_rows) / sizeof(behaviour_rows[0])> behaviour_machine;
+
 void sigsegv_handler(int sig) {
   printf("(%s) program received SIGSEGV, Segmentation Fault. Ignoring\n", TESTENV);
   return;
@@ -197,14 +785,18 @@ int main(int argc, char **argv)
     printf("(%s) start\n", TESTENV);
     printf("(%s) camera offset : x=%.3f, y=%.3f, z=%.3f [m]\n", TESTENV, x_offset, y_offset, z_offset);
 
+    /* Perception callbacks run on their own thread, the state machine on DURATION deadlines */
+    ControlExecutor executor(n, DURATION);
+
     #ifdef LIDAR    
-    ros::Subscriber sub = n.subscribe<lidar::coor>("/lidar_coor", 1000, lidar_Callback);
+    ros::Subscriber sub = executor.perception().subscribe<lidar::coor>("/lidar_coor", 1, lidar_Callback);
+    ros::Subscriber sub_scan = executor.perception().subscribe<sensor_msgs::LaserScan>("/scan", 1, scan_Callback);
     #endif
 
     #ifdef WEBCAM
-    ros::Subscriber sub1 = n.subscribe<core_msgs::ball_position>("/position", 1000, camera_Callback);
-    ros::Subscriber sub2 = n.subscribe<core_msgs::ball_position_top>("/position_top", 1000, camera_Callback_top);
-    ros::Subscriber sub3 = n.subscribe<core_msgs::roller_num>("/roller_num",1000, camera_Callback_counter);
+    ros::Subscriber sub1 = executor.perception().subscribe<core_msgs::ball_position>("/position", 1, camera_Callback);
+    ros::Subscriber sub2 = executor.perception().subscribe<core_msgs::ball_position_top>("/position_top", 1, camera_Callback_top);
+    ros::Subscriber sub3 = executor.perception().subscribe<core_msgs::roller_num>("/roller_num",1000, camera_Callback_counter);
     #endif
 
 		dataInit();
@@ -212,14 +804,12 @@ int main(int argc, char **argv)
     #ifdef MYRIO
     if(use_myrio) {
     printf("(%s) Connecting to %s:%d\n", TESTENV, IPADDR, PORT);
-    c_socket = socket(PF_INET, SOCK_STREAM, 0);
-    c_addr.sin_addr.s_addr = inet_addr(IPADDR);
-    c_addr.sin_family = AF_INET;
-    c_addr.sin_port = htons(PORT);
-
-    if(connect(c_socket, (struct sockaddr*) &c_addr, sizeof(c_addr)) == -1){
+    robot_link::LinkConfig link_config;
+    link_config.host = IPADDR;
+    link_config.port = PORT;
+    link_config.rate_hz = 1.0/DURATION;
+    if(!myrio.open(robot_link::loadLinkConfig(link_config))){
       printf("(%s) Failed to connect\n", TESTENV);
-      close(c_socket);
       return -1;
     }
     printf("(%s) Connected to %s:%d\n", TESTENV, IPADDR, PORT);
@@ -229,500 +819,48 @@ int main(int argc, char **argv)
     printf("(%s) Entering main routine...\n", TESTENV);
     printf("(%s) state = INIT\n", TESTENV);
 
-    current_ticks = timer_ticks;
-
-    while(ros::ok){
-      dataInit();
-
-      if(recent_status != machine_status)
-        std::cout << "(" << TESTENV << ") state = " << cond[(recent_status = machine_status)] << std::endl;
-
-      if(timer_ticks > 40 * timeout && !return_mode) {
-        printf("(%s) switching to return mode after %.2f s of timeout\n", TESTENV, (float) timeout);
-        machine_status = LIDAR_RETURN;
-        return_mode = 1;
-      }
-
+    /* State of our machine = INIT phase by default */
+    behaviour_machine behaviour(behaviour_nodes, behaviour_rows, INIT);
+    fsm::Trace<status> behaviour_trace(256);
+    behaviour.attach(&behaviour_trace);
 
-      /* switching between states */
-      switch(machine_status) {
-        case INIT:
-        {
-          MSGE("go front 2m first")
-          GO_FRONT
+    executor.start();
 
-          /* Initiate SEARCH */          
-          if(timer_ticks - current_ticks >= 80)
-            machine_status = SEARCH;
-          
-          break;
-        }
-        case SEARCH:
-        {
-          int target_b = leftmost_blue();
-          int target_b_top = leftmost_blue_top();
-
-          if(target_b < 0) {
-            if(target_b_top >= 0) {
-              float xpos_top_b = blue_x_top[target_b_top];
-              if(xpos_top_b >= 0.3) TURN_RIGHT
-              else if(xpos_top_b <= -0.3) TURN_LEFT
-              else GO_FRONT
-            } else {
-              TURN_RIGHT 
-            }
-          } else {
-            if(blue_x[target_b] > 0.15) {
-              TURN_RIGHT // ROS_INFO("search - R");
-            } else if(blue_x[target_b] < -0.15) {
-              TURN_LEFT //  ROS_INFO("search - L");
-            } else {
-               machine_status = APPROACH; 
-            }
-          }
-
-          break;
-        }
-        case APPROACH:
-        {
-          GO_FRONT
-          int target_b = leftmost_blue();
-          if(fabs(blue_x[target_b]) >= 0.20) { machine_status = SEARCH; }
-          else {
-            if(blue_z[target_b] < 0.2) {
-              machine_status = COLLECT;
-            }
-          }
-      
-          if(red_in_range()) {
-            assert(closest_ball(RED) != -1);
-            if(red_z[closest_ball(RED)] <= blue_z[target_b]) {
-              red_phase2 = false;
-              machine_status = RED_AVOIDANCE;
-            }
-          } 
-
-          break;
-        }
-        case RED_AVOIDANCE:
-        {          
-          if(!red_in_range() && !red_phase2){
-            red_phase2 = true;
-            printf("(%s) RED_AVOIDANCE_2\n", TESTENV);
-            current_ticks = timer_ticks;
-          }
-  
-          if(!red_phase2) TURN_LEFT
-          else {
-            GO_FRONT
-
-            if(timer_ticks - current_ticks > DISTANCE_TICKS) {
-              red_phase2 = false;
-              machine_status = (return_mode)? LIDAR_RETURN : SEARCH;
-          }
-        }
-          break;
-        }
-        case COLLECT:
-        {
-          ROLLER_ON
-
-          int target = leftmost_blue();
-
-          if(target == -1){
-            machine_status = COLLECT2;
-            printf("recent target blue was at (%.3f, %.3f)\n", recent_target_b_x, recent_target_b_z);
-          }
-          else {
-            float xpos = blue_x[target];
-            float zpos = blue_z[target];
-
-            if(xpos > 0.013) {
-              TURN_RIGHT_SLOW ROLLER_ON //printf("col-R\n");
-            } else if(xpos < -0.013) {
-              TURN_LEFT_SLOW ROLLER_ON //printf("col-L\n");
-            } else {
-              current_ticks = timer_ticks;
-              machine_status = COLLECT2;
-            }
-          }
-
-          if(red_in_range()) {
-            if(red_z[closest_ball(RED)] <= blue_z[target]) machine_status = RED_AVOIDANCE;
-          }
-          if(target >= 0){
-            recent_target_b_x = blue_x[target];
-            recent_target_b_z = blue_z[target];
-          }
-          break;
-        }
-        case COLLECT2:
-        {
-          GO_FRONT ROLLER_ON
-          if(timer_ticks - current_ticks > DISTANCE_TICKS_CL) {
-            machine_status = SEARCH;
-
-            if(fabs(recent_target_b_x)<0.133)
-              printf("(%s) collected ball. ball_count = %d\n",TESTENV , ++ball_cnt);
-          }
-          break;
-        }
-        case LIDAR_RETURN:
-        {
-          #ifndef LIDAR
-          printf("(%s) LIDAR_RETURN : No LIDAR detected. Exitting.\n", TESTENV);
-          machine_status = SEARCH_GREEN;
-    
-          #else      
-          if(theta_abs > 190.0f) {
-            MSGE("LIDAR_RETURN : turn left")
-            TURN_LEFT
-          } else if(theta_abs < 170.0f) {
-            MSGE("LIDAR_RETURN : turn right")
-            TURN_RIGHT
-          } else if(xpos_abs > 2.0f) {
-            MSGE("LIDAR_RETURN : go_front")
-            GO_FRONT
-          } else {
-            machine_status = SEARCH_GREEN;
-          }
-
-          if(red_in_range()){
-            MSGE("LIDAR_RETURN : red ball detected")
-            machine_status = RED_AVOIDANCE;
-          }
-          #endif
-          break;
-        }
-        case SEARCH_GREEN:
-        {
-          int target_g = leftmost_green();
-          int target_g_top = leftmost_green_top();
-          if(target_g_top >= 0) {
-            float xpos = green_x_top[target_g_top];
-            float zpos = green_z_top[target_g_top];
-
-            if(xpos > 0.2){
-              TURN_RIGHT
-              if(!(timer_ticks%10)) printf("(%s) SEARCH_GREEN : turn right\n", TESTENV);
-            } else if(xpos < -0.2) {
-              TURN_LEFT 
-              if(!(timer_ticks%10)) printf("(%s) SEARCH_GREEN : turn_left\n", TESTENV);
-            } else {
-              GO_FRONT 
-              if(!(timer_ticks%10)) printf("(%s) SEARCH_GREEN : go_front\n", TESTENV);
-            }
-
-            if(zpos <= 0.8) {
-              machine_status = APPROACH_GREEN;
-            }
-
-          } else TURN_RIGHT
-            
-          break;
-        }
-        case APPROACH_GREEN:
-        {
-          switch(green_cnt) {
-            case 0:
-            {
-              TURN_RIGHT
-              if(!(timer_ticks % 10)) printf("(%s) APPROACH_GREEN : green_cnt = 0, turn right\n", TESTENV);
-              break;
-            }
-            case 1:
-            {
-              float xg1 = green_x[0];
-              float zg1 = green_z[0];
-
-              if(xg1 > 0 || 1) {
-                TURN_RIGHT_SLOW
-                if(!(timer_ticks%10)) printf("(%s) APPROACH_GREEN : green_cnt = 1, turn_right\n", TESTENV);
-              } else if(xg1 < 0 && 0) {
-                TURN_LEFT_SLOW
-                if(!(timer_ticks%10)) printf("(%s) APPROACH_GREEN : green_cnt = 1, turn_left\n", TESTENV);
-              }
-
-              break;
-            }
-            case 2:
-            {
-              if(!(timer_ticks%10)) printf("(%s) APPROACH_GREEN : green_cnt = 2\n", TESTENV);
-
-              float xg1 = green_x[0];
-              float xg2 = green_x[1];
-              float zg1 = green_z[0];
-              float zg2 = green_z[1];
-
-              /* Make sure one ball is recognized as 2 */
-              if(DIST(xg1,zg1,xg2,zg2) <= 0.05) { TURN_RIGHT break; }
-
-              float degree = atan((zg2-zg1)/(xg2-xg1));
-
-              float mid_x = 0.5 * (xg1 + xg2);
-              float mid_z = 0.5 * (zg1 + zg2);
-
-              float mid_x_trn = mid_x * cos(degree) + mid_z * sin(degree);
-              float mid_z_trn = mid_z * cos(degree) - mid_x * sin(degree);
-
-              if(mid_x >= 0.1f) {
-                if(!(timer_ticks%10)) printf("(%s) midpoint_x = %.3f : turn_right\n", TESTENV, mid_x);
-                TURN_RIGHT_SLOW
-              } else if(mid_x <= -0.1f) {
-                TURN_LEFT_SLOW
-                if(!(timer_ticks%10)) printf("(%s) midpoint_x = %.3f : turn_left\n", TESTENV, mid_x);
-              } else {
-                if(abs((green_x[0])<= 0.25 && abs((green_x[1])<=0.25) )) {
-                  float xg1_ = green_x[0];
-                  float xg2_ = green_x[1];
-                  float zg1_ = green_z[0];
-                  float zg2_ = green_z[1];
-
-                  float degree_ = atan((zg2-zg1)/(xg2-xg1));
-                  float mid_x_ = 0.5 * (xg1 + xg2);
-                  float mid_z_ = 0.5 * (zg1 + zg2);
-
-                  float mid_x_trn_ = mid_x * cos(degree_) + mid_z * sin(degree_);
-                  float mid_z_trn_ = mid_z * cos(degree_) - mid_x * sin(degree_);
-
-                  goal_theta = RAD2DEG(degree_);
-                  goal_x = mid_x_trn_;
-                  goal_z = mid_z_trn_;
-                  printf("(%s) angular offset = %.3f deg, x_ofs = %.3f, z_ofs = %.3f\n", TESTENV, RAD2DEG(degree_), mid_x_trn_, mid_z_trn_);
-                
-                  machine_status = APPROACH_GREEN_2;
-                  current_ticks = timer_ticks;
-
-                }
-              }
-
-              int target = closest_ball(GREEN);
-              float t_z = green_z[target];
-              
-             break;
-            }
-            default:
-            {
-              /* Evaluation over UNRELIABLE openCV */              
-              printf("(%s) APPROACH_GREEN : evaluation in unreliable mode : there are %d green balls\n",TESTENV, green_cnt);
-              float xg1 = green_x[leftmost_green()];
-              float xg2 = green_x[rightmost_green()];
-              float zg1 = green_z[leftmost_green()];
-              float zg2 = green_z[rightmost_green()];
-
-              float mid_x = 0.5 * (xg1 + xg2);
-              float mid_z = 0.5 * (zg1 + zg2);
-
-              float degree_ = atan((zg2-zg1)/(xg2-xg1));
-              
-              float mid_x_trn_ = mid_x * cos(degree_) + mid_z * sin(degree_);
-              float mid_z_trn_ = mid_z * cos(degree_) - mid_x * sin(degree_);
-
-              goal_theta = RAD2DEG(degree_);
-              goal_x = mid_x_trn_;
-              goal_z = mid_z_trn_;
-
-              printf("(%s) angular offset = %.3f deg, x_ofs = %.3f, z_ofs = %.3f\n", TESTENV, RAD2DEG(degree_), mid_x_trn_, mid_z_trn_);
-                
-              machine_status = APPROACH_GREEN_2;
-              current_ticks = timer_ticks;
-
-              break;
-            }
-
-          }
- 
-          break;
-        }
-
-        /*
-         * APPROACH_GREEN_2 
-         * open-loop position control based on position evaluation of APPROACH_GREEN_1
-         * 1) ROTATE theta-ofs, 2) TRANSLATE X-ofs, 3) phase shift to APPROACH_GREEN_3
-         */
-        case APPROACH_GREEN_2:
-        {
-          uint32_t goal_rotate_ticks = (uint32_t) (ROTATE_CONST_SLOW * fabs(goal_theta));
-          uint32_t goal_translate_ticks = (uint32_t) (TRANSLATE_CONST_SLOW * fabs(goal_x));
-
-          if(!(timer_ticks %10)) printf("(%s) estimated rotate ticks = %d, translate ticks = %d\n",TESTENV,(int) goal_rotate_ticks, (int) goal_translate_ticks);
-
-          if(timer_ticks - current_ticks < goal_rotate_ticks) {
-            MSGE("openloop - rotation")
-            if(goal_theta > 0) TURN_LEFT_SLOW
-            else if(goal_theta < 0) TURN_RIGHT_SLOW
-          } else if((timer_ticks - current_ticks >= goal_rotate_ticks) && (timer_ticks - current_ticks < goal_rotate_ticks + goal_translate_ticks)) {
-            MSGE("openloop - translation")
-            if(goal_x < 0) TRANSLATE_LEFT
-            else TRANSLATE_RIGHT
-          } else {        
-            printf("(%s) openloop - aligned %.3f degrees, %.3f meters\n",TESTENV, goal_theta, goal_x);
-            machine_status = APPROACH_GREEN_3;
-            current_ticks = timer_ticks;
-          }
-          break;
-        }
-
-        /*
-         * APPROACH_GREEN_3
-         * feedback position(angular) control using CAM_btm
-         */
-        case APPROACH_GREEN_3:
-        {
-          #ifdef UNRELIABLE
-          int idx_close = closest_ball(GREEN);
-          int idx_far = furthest_green();
-
-          float xg1 = green_x[idx_close];
-          float zg1 = green_z[idx_close];
-          float xg2 = green_x[idx_far];
-          float zg2 = green_z[idx_far];
-          #else
-          float xg1 = green_x[0];
-          float zg1 = green_z[0];
-          float xg2 = green_x[1];
-          float zg2 = green_z[1];
-          #endif
-
-          if(green_cnt < 2) {
-            printf("(%s) APPROACH_GREEN : there are %d balls. phase out to APPROACH_GREEN\n", TESTENV, green_cnt);
-            machine_status = APPROACH_GREEN;
-            break;
-          }
-
-          float angular_ofs = RAD2DEG(atan((zg2 - zg1) / (xg2 - xg1)));
-
-          if(!(timer_ticks%10)) printf("(%s) angle = %.4f\n", TESTENV, angular_ofs);
-          
-          if(angular_ofs < -1.6f) {
-            MSGE("feedback - rotation CW")
-            TURN_RIGHT_SLOW
-          } else if(angular_ofs > 1.6f) {
-            MSGE("feedback - rotation CCW")
-            TURN_LEFT_SLOW
-          } else {
-            printf("(%s) finished alignment. angular deviation = %.4f deg\n",TESTENV, angular_ofs);
-            machine_status = APPROACH_GREEN_4;
-          }
+    while(ros::ok()){
+      executor.beginTick();
 
-          break;
-        }
-
-        case APPROACH_GREEN_4:
-        {
-          #ifdef UNRELIABLE
-          int idx_close = closest_ball(GREEN);
-          int idx_far = furthest_green();
-
-          float xg1 = green_x[idx_close];
-          float zg1 = green_z[idx_close];
-          float xg2 = green_x[idx_far];
-          float zg2 = green_z[idx_far];
-          #else
-          float xg1 = green_x[0];
-          float xg2 = green_x[1];
-          float zg1 = green_z[0];
-          float zg2 = green_z[1];
-          #endif
-
-          float x_ofs = 0.5f * (xg1 + xg2);
-
-          if(!(timer_ticks%10)) printf("(%s) X_offset = %.4f[m]\n", TESTENV, x_ofs);
-
-          if(x_ofs > 0.01f) {
-            MSGE("feedback - translation R")
-            TRANSLATE_RIGHT
-          } else if(x_ofs < -0.01f) {
-            MSGE("feedback - translation L")
-            TRANSLATE_LEFT
-          } else {
-            #ifndef UNRELIABLE
-            machine_status = RELEASE;
-            current_ticks = timer_ticks;
-            #else
-            machine_status = APPROACH_GREEN_5;
-            machine_status = RELEASE;
-            #endif
-          }
-          break;
-        }
-
-        #ifdef UNRELIABLE
-        case APPROACH_GREEN_5:
-        {
-          MSGE("APPROACH_GREEN - 5 : Control over UNRELIABLE actuator")
-
-          float xg1 = green_x[0];
-          float xg2 = green_x[1];
-          float zg1 = green_z[0];
-          float zg2 = green_z[1];
-
-          if(!(timer_ticks%10)) printf("(%.3f, %.3f), (%.3f, %.3f)\n", xg1, zg1, xg2, zg2);
-
-          assert(DIST(xg1,zg1,xg2,zg2)>=0.05);
-          float theta = RAD2DEG(atan((zg2-zg1)/(xg2-xg1)));
-          if(!(timer_ticks%10)) printf("theta = %.3f\n", theta);
-          if(theta < -1.5f) TURN_RIGHT_SLOW
-          else if(theta > 1.5f) TURN_LEFT_SLOW
-          else { current_ticks = timer_ticks; machine_status = RELEASE; }
-          
-          break;
-        }  
+      /* newest perception, if any arrived since the last tick */
+      const perception_state* latest = perception.latest();
+      if(latest) {
+        seen = *latest;
+        #ifdef WEBCAM
+        track_balls();
         #endif
-
-        case RELEASE:
-        {
-          #ifndef LIDAR
-          uint32_t goal_front_ticks = (uint32_t) (280.0f * goal_z);
-
-          if(timer_ticks-current_ticks < goal_front_ticks) {
-            MSGE("RELEASE - go front")
-            GO_FRONT
-          } else if(timer_ticks - current_ticks < 100 + goal_front_ticks) {
-            MSGE("RELEASE - roller_reverse")
-            ROLLER_REVERSE
-          } else {
-            PANIC("RELEASE_TERMINATE : should have released 3 balls.")
-          }
-          #else
-          if(xpos_abs > 0.02f) {
-            MSGE("RELEASE - go front(feedback)")
-            GO_FRONT
-            current_ticks = 0;
-          } else {
-            MSGE("RELEASE - roller_reverse")
-            ROLLER_REVERSE
-            current_ticks++;
-          }
-
-          if(current_ticks > 500)
-            PANIC("RELEASE : terminating. should have released 3 balls.")
-          #endif
-          
-          break; 
-        }
-
-        default:
-          assert(0);
-
       }
 
+      dataInit();
+
+      if(behaviour.step(seen, data))
+        std::cout << "(" << TESTENV << ") state = " << behaviour.name() << std::endl;
 
       /* Send control data */
       
       #ifdef MYRIO
       if(use_myrio) {
-      size_t written = write(c_socket, data, sizeof(data));
-      if(DEBUG) printf("%d bytes written\n", (int) written);
+      if(!myrio.setCommand(data))
+        ROS_ERROR_THROTTLE(1, "(%s) Lost the link to the myRIO", TESTENV);
       }
       #endif
 
-	    ros::Duration(DURATION).sleep();
-	    ros::spinOnce();
+      executor.endTick();
       timer_ticks++;
     }
 
-    close(c_socket);
+    executor.stop();
+    myrio.close();
+
+    printf("(%s) last %d state transitions :\n", TESTENV, (int) behaviour_trace.size());
+    behaviour_trace.dump(stdout, behaviour.names());
     ros::shutdown();
 
     return -1;
@@ -733,8 +871,10 @@ int main(int argc, char **argv)
 void camera_Callback(const core_msgs::ball_position::ConstPtr& position)
 {
   /* Step 1. Fetch data from message */
+  sensed.frame++;
+  sensed.stamp = ros::Time::now().toSec();
   int b_cnt = position->size_b;
-  blue_cnt = position->size_b;
+  sensed.blue_cnt = position->size_b;
 
   for(int i=0; i<b_cnt; i++) {
     // transform the matrix
@@ -744,46 +884,49 @@ void camera_Callback(const core_msgs::ball_position::ConstPtr& position)
     z_pos = sqrt(pow(position->img_z_b[i],2.0) - pow(position->img_x_b[i],2.0));
 
     /* TODO : transform (Camera coordinate)->(LLF) */
-    blue_x[i] = x_pos - x_offset;
-    blue_z[i] = z_pos - z_offset;
+    sensed.blue_x[i] = x_pos - x_offset;
+    sensed.blue_z[i] = z_pos - z_offset;
   }
 
   int r_cnt = position->size_r;
-  red_cnt = position->size_r;
+  sensed.red_cnt = position->size_r;
 
   for(int i=0; i<r_cnt; i++) {
     float x_pos = position->img_x_r[i];
     float y_pos = position->img_y_r[i];
-    float z_pos = sqrt(pow(position->img_z_r[i],2.0) - pow(red_x[i], 2.0) - pow(red_y[i], 2.0));
+    float z_pos = sqrt(pow(position->img_z_r[i],2.0) - pow(sensed.red_x[i], 2.0) - pow(sensed.red_y[i], 2.0));
     z_pos = sqrt(pow(position->img_z_r[i],2.0) - pow(position->img_x_r[i],2.0));
 
     /* TODO : transform (Camera coordinate)->(LLF) */
-    red_x[i] = x_pos - x_offset;
-    red_y[i] = (y_pos * cos(downside_angle) + z_pos * sin(downside_angle)) - y_offset;
-    red_z[i] = (z_pos * cos(downside_angle) - y_pos * cos(downside_angle)) - z_offset;
-    red_z[i] = z_pos - z_offset;
+    sensed.red_x[i] = x_pos - x_offset;
+    sensed.red_y[i] = (y_pos * cos(downside_angle) + z_pos * sin(downside_angle)) - y_offset;
+    sensed.red_z[i] = (z_pos * cos(downside_angle) - y_pos * cos(downside_angle)) - z_offset;
+    sensed.red_z[i] = z_pos - z_offset;
   }
 
   int g_cnt = position->size_g;
-  green_cnt = position->size_g;
+  sensed.green_cnt = position->size_g;
 
   for(int i=0; i<g_cnt; i++) {
     float x_pos = position->img_x_g[i];
     float y_pos = position->img_y_g[i];
     float z_pos = sqrt(pow(position->img_z_g[i],2.0) - pow(position->img_x_g[i],2.0));
 
-    green_x[i] = x_pos - x_offset;
-    green_z[i] = z_pos - z_offset;
+    sensed.green_x[i] = x_pos - x_offset;
+    sensed.green_z[i] = z_pos - z_offset;
   }
 
+  perception.publish(sensed);
 }
 
 /* callback 2 */
 void camera_Callback_top(const core_msgs::ball_position_top::ConstPtr& position)
 {
   /* Step 1. Fetch data from message */
+  sensed.frame_top++;
+  sensed.stamp_top = ros::Time::now().toSec();
   int b_cnt_top = position->size_b;
-  blue_cnt_top = position->size_b;
+  sensed.blue_cnt_top = position->size_b;
 
   for(int i=0; i<b_cnt_top; i++) {
     // transform the matrix
@@ -792,12 +935,12 @@ void camera_Callback_top(const core_msgs::ball_position_top::ConstPtr& position)
     float z_pos = sqrt(pow(position->img_z_b[i],2.0) - pow(position->img_x_b[i],2.0));
 
     /* TODO : transform (Camera coordinate)->(LLF) */
-    blue_x_top[i] = x_pos - x_offset_top;
-    blue_z_top[i] = z_pos - z_offset_top;
+    sensed.blue_x_top[i] = x_pos - x_offset_top;
+    sensed.blue_z_top[i] = z_pos - z_offset_top;
   }
 
   int r_cnt_top = position->size_r;
-  red_cnt_top = position->size_r;
+  sensed.red_cnt_top = position->size_r;
 
   for(int i=0; i<r_cnt_top; i++) {
     float x_pos = position->img_x_r[i];
@@ -805,14 +948,14 @@ void camera_Callback_top(const core_msgs::ball_position_top::ConstPtr& position)
     float z_pos = sqrt(pow(position->img_z_r[i],2.0) - pow(position->img_x_r[i],2.0));
 
     /* TODO : transform (Camera coordinate)->(LLF) */
-    red_x_top[i] = x_pos - x_offset;
-    red_z_top[i] = z_pos - z_offset;
+    sensed.red_x_top[i] = x_pos - x_offset;
+    sensed.red_z_top[i] = z_pos - z_offset;
   }
 
   /* Green */
 
   int g_cnt_top = position->size_g;
-  green_cnt_top = position->size_g;
+  sensed.green_cnt_top = position->size_g;
 
   for(int i=0; i<g_cnt_top; i++) {
     float x_pos = position->img_x_g[i];
@@ -820,145 +963,96 @@ void camera_Callback_top(const core_msgs::ball_position_top::ConstPtr& position)
     float z_pos = sqrt(pow(position->img_z_g[i],2.0) - pow(position->img_x_g[i],2.0));
 
     /* TODO : transform (Camera coordinate)->(LLF) */
-    green_x_top[i] = x_pos - x_offset;
-    green_z_top[i] = z_pos - z_offset;
+    sensed.green_x_top[i] = x_pos - x_offset;
+    sensed.green_z_top[i] = z_pos - z_offset;
   }
+
+  perception.publish(sensed);
 }
 
 void camera_Callback_counter(const core_msgs::roller_num::ConstPtr& cnt)
 {
   int shift = cnt->size_b;
 
-  if(shift && !return_mode) {
-    printf("(%s) dupACKcnt = %d\n", TESTENV, (int) ++dupACKcnt);
-    if(dupACKcnt >= 3) {  // 3 Duplicate ACK
-      if(machine_status == SEARCH || !return_mode) {
-        machine_status = LIDAR_RETURN;
-        return_mode = 1;
-      }
-    }
+  /* the switch to LIDAR_RETURN on 3 duplicate ACKs happens in the control tick */
+  if(shift) {
+    printf("(%s) dupACKcnt = %d\n", TESTENV, (int) ++sensed.dupACKcnt);
   }
   else
-    dupACKcnt = 0;
+    sensed.dupACKcnt = 0;
 
+  perception.publish(sensed);
 }
 
 
-bool ball_in_range(enum color ball_color) {
+/* feed new camera frames to the trackers, then expose the tracks as the usual arrays */
+void track_balls() {
+  if(seen.frame != world_frame) {
+    world_frame = seen.frame;
+    world.update(ball_world::BLUE, blue_x, blue_z, blue_cnt, seen.stamp);
+    world.update(ball_world::RED, red_x, red_z, red_cnt, seen.stamp);
+    world.update(ball_world::GREEN, green_x, green_z, green_cnt, seen.stamp);
+  }
+  if(seen.frame_top != world_frame_top) {
+    world_frame_top = seen.frame_top;
+    world_top.update(ball_world::BLUE, blue_x_top, blue_z_top, blue_cnt_top, seen.stamp_top);
+    world_top.update(ball_world::RED, red_x_top, red_z_top, red_cnt_top, seen.stamp_top);
+    world_top.update(ball_world::GREEN, green_x_top, green_z_top, green_cnt_top, seen.stamp_top);
+  }
 
-  if(ball_color == BLUE) {
-    for(int i=0; i<blue_cnt; i++) {
-      //printf("blue[%d] = (%.2f, %.2f)\n", i, blue_x[i], blue_z[i]);
-      if(fabs(blue_x[i])<=0.034 && blue_z[i] <= 0.3)
-        return true;
-    }
-    return false;
+  blue_cnt = world.exportTo(ball_world::BLUE, blue_x, blue_z, 20);
+  red_cnt = world.exportTo(ball_world::RED, red_x, red_z, 20);
+  green_cnt = world.exportTo(ball_world::GREEN, green_x, green_z, 20);
+  blue_cnt_top = world_top.exportTo(ball_world::BLUE, blue_x_top, blue_z_top, 20);
+  red_cnt_top = world_top.exportTo(ball_world::RED, red_x_top, red_z_top, 20);
+  green_cnt_top = world_top.exportTo(ball_world::GREEN, green_x_top, green_z_top, 20);
+}
 
-  } else if(ball_color == RED) {
-    return red_in_range();
+/*
+ * Ball queries below answer from the tracks in `world` / `world_top`.
+ * The returned index is the track's rank, which is also its index in the
+ * blue_x/red_x/green_x arrays that track_balls() fills, leftmost first.
+ */
+ball_world::BallColor world_color(enum color ball_color) {
+  switch(ball_color) {
+    case RED: return ball_world::RED;
+    case GREEN: return ball_world::GREEN;
+    default: return ball_world::BLUE;
+  }
+}
 
-  } else {
+bool ball_in_range(enum color ball_color) {
+  if(ball_color == BLUE)
+    return world.anyInCorridor(ball_world::BLUE, 0.034f, 0.3f);
+  else if(ball_color == RED)
+    return red_in_range();
+  else
     return false;
-  }
 }
 
 bool red_in_range() {
-  for(int i=0; i<red_cnt; i++) {
-    if(fabs(red_x[i])<0.25 && red_z[i] <= 0.3)
-      return true;
-  }
-  return false;
+  return world.anyInCorridor(ball_world::RED, 0.25f, 0.3f);
 }
 
 /* 
  * leftmost green()
- * return leftmost blue visible in sight
+ * return leftmost green visible in sight
  * return -1 if invisible
  */
-int leftmost_green() {
-  if(!green_cnt) 
-    return -1;
-
-  float xpos = green_x[0];
-  int min_idx = 0;
-
-  for(int i=0; i<green_cnt; i++) {
-    if(green_x[i] <= xpos) {
-      xpos = green_x[i];
-      min_idx = i;
-    }
-  }
-  return min_idx;
-}
-
-int rightmost_green() {
-  if(!green_cnt)
-    return -1;
-  
-  float xpos = green_x[0];
-  int max_idx = 0;
-
-  for(int i=0; i<green_cnt; i++) {
-    if(green_x[i] >= xpos)
-      xpos = green_x[(max_idx = i)];
-  }
-
-  return max_idx;
-}
+int leftmost_green() { return world.leftmost(ball_world::GREEN); }
 
-int leftmost_green_top() {
-  if(!green_cnt_top)
-    return -1;
-
-  float xpos = green_x_top[0];
-  int min_idx = 0;
-
-  for(int i=0; i<green_cnt_top; i++) {
-    if(green_x_top[i] <= xpos) {
-      xpos = green_x_top[i];
-      min_idx = i;
-    }
-  }
-  return min_idx;
-}
+int rightmost_green() { return world.rightmost(ball_world::GREEN); }
 
+int leftmost_green_top() { return world_top.leftmost(ball_world::GREEN); }
 
 /* 
  * leftmost blue()
  * return leftmost blue visible in sight
  * return -1 if invisible
  */
-int leftmost_blue() {
-  if(!blue_cnt) 
-    return -1;
-
-  float xpos = blue_x[0];
-  int min_idx = 0;
-
-  for(int i=0; i<blue_cnt; i++) {
-    if(blue_x[i] <= xpos) {
-      xpos = blue_x[i];
-      min_idx = i;
-    }
-  }
-  return min_idx;
-}
-
-int leftmost_blue_top() {
-  if(!blue_cnt_top)
-    return -1;
+int leftmost_blue() { return world.leftmost(ball_world::BLUE); }
 
-  float xpos = blue_x_top[0];
-  int min_idx = 0;
-
-  for(int i=0; i<blue_cnt_top; i++) {
-    if(blue_x_top[i] <= xpos) {
-      xpos = blue_x_top[i];
-      min_idx = i;
-    }
-  }
-  return min_idx;
-}
+int leftmost_blue_top() { return world_top.leftmost(ball_world::BLUE); }
 
 /*
  * target_blue(int policy)
@@ -977,119 +1071,54 @@ int target_blue(int policy) {
   }
 }
 
-
 /*
  * centermost blue()
  * return index of centermost blue ball amongst visible ones
  * -1 if no blue ball is in sight
  */
-int centermost_blue() {
-  if(!blue_cnt)
-    return -1;
-
-  float xpos_abs = fabs(blue_x[0]);
-  int min_idx = 0;
-
-  for(int i=0; i<blue_cnt; i++) {
-    if(fabs(blue_x[i]) < xpos_abs) {
-      xpos_abs = fabs(blue_x[i]);
-      min_idx = i;
-    }
-  }
-  return min_idx;
-}
+int centermost_blue() { return world.centermost(ball_world::BLUE); }
 
 int closest_ball(enum color ball_color) {
-  switch(ball_color) {
-    case BLUE:
-    {
-      int result_idx = -1;
-
-      if(!blue_cnt)
-        return -1;
-
-      float front_dist = blue_z[0];
-
-      for(int i=0; i<blue_cnt; i++){
-        if(blue_z[i] <= front_dist){
-          front_dist = blue_z[i];
-          result_idx = i;
-        }
-      }
-
-      return result_idx;
-    }
-    case RED:
-    {
-      int result_idx = -1;
-
-      if(!red_cnt)
-        return -1;
-
-      float front_dist = red_z[0];
-      for(int i=0; i<red_cnt; i++){
-        if(red_z[i] <= front_dist){
-          front_dist = red_z[i];
-          result_idx = i;
-        }
-      }
-
-        return result_idx;
-      break;
-    }
-    case GREEN:
-    {
-      int result_idx = -1;
-
-      if(!green_cnt)
-        return -1;
-      float front_dist = green_z[0];
-      for(int i=0; i<green_cnt; i++) {
-        if(green_z[i] <= front_dist) {
-          front_dist = green_z[i];
-          result_idx = i;
-        }
-      }
-      return result_idx;
-    }
-    default:
-      { return -1; }
-  }
+  if(ball_color == NONE)
+    return -1;
+  return world.nearest(world_color(ball_color));
 }
 
 /*
  * furthest_green()
- * Traverse through green_z
  * returns INDEX of maximum dist Z
  *
- * This is redundant, but is implemented as senitel
+ * 0 when no green ball is tracked, as a senitel
  */
-
 int furthest_green() {
-  int result_idx = 0;
-
-  float front_dist = green_z[0];
-  for(int i=0; i<green_cnt; i++) {
-    if(green_z[i] >= front_dist) {
-      front_dist = green_z[i];
-      result_idx = i;
-    }
-  }
-  return result_idx;
+  int idx = world.furthest(ball_world::GREEN);
+  return (idx < 0)? 0 : idx;
 }
 #endif
 
 #ifdef LIDAR
 void lidar_Callback(const lidar::coor::ConstPtr& pos)
 {
-  /* Update absolute position using pos */
-  xpos_abs = pos->coor_x;
-  ypos_abs = pos->coor_y;
-  theta_abs = pos->coor_theta;
+  /* Update absolute position using pos : cm, cm, degrees in [0, 360) (lidar/msg/coor.msg) */
+  sensed.xpos_abs = pos->coor_x;
+  sensed.ypos_abs = pos->coor_y;
+  sensed.theta_abs = pos->coor_theta;
 
   if(DEBUG) printf("(%s) lidar callback! %.3f %.3f %.3f \n", TESTENV, pos->coor_x, pos->coor_y, pos->coor_theta);
 
+  perception.publish(sensed);
+}
 
+void scan_Callback(const sensor_msgs::LaserScan::ConstPtr& scan)
+{
+  int n = std::min((int) scan->ranges.size(), 720);
+  sensed.scan_frame++;
+  sensed.scan_cnt = n;
+  sensed.scan_angle_min = scan->angle_min;
+  sensed.scan_angle_inc = scan->angle_increment;
+  std::copy(scan->ranges.begin(), scan->ranges.begin() + n, sensed.scan_range);
+
+  perception.publish(sensed);
 }
 #endif
 
@@ -15,6 +15,7 @@
 #include <boost/thread.hpp>
 #include <ros/ros.h>
 #include <ros/package.h>
+#include "robot_link/ros_config.h"
 
 #include "core_msgs/ball_position.h"
 #include "core_msgs/roller_num.h"
@@ -97,8 +98,7 @@ int return_mode = 0;
 bool dirtybit_SG = false;
 
 #ifdef MYRIO
-int c_socket, s_socket;
-struct sockaddr_in c_addr;
+robot_link::RobotLink myrio;
 int len;
 int n;
 float data[24];
@@ -216,17 +216,12 @@ int main(int argc, char **argv)
     #ifdef MYRIO
     if(use_myrio) {
     printf("(%s) Connecting to %s:%d\n", TESTENV, IPADDR, PORT);
-    c_socket = socket(PF_INET, SOCK_STREAM, 0);
-    c_addr.sin_addr.s_addr = inet_addr(IPADDR);
-    c_addr.sin_family = AF_INET;
-    c_addr.sin_port = htons(PORT);
-
-//앞서 초기화한 세팅으로 myrio와 connect하는데,
-//If failed to connect, then print fail msg, close socket and return -1.
-//If connected, print connet msg.
-    if(connect(c_socket, (struct sockaddr*) &c_addr, sizeof(c_addr)) == -1){
+    robot_link::LinkConfig link_config;
+    link_config.host = IPADDR;
+    link_config.port = PORT;
+    link_config.rate_hz = 1.0/DURATION;
+    if(!myrio.open(robot_link::loadLinkConfig(link_config))){
       printf("(%s) Failed to connect\n", TESTENV);
-      close(c_socket);
       return -1;
     }
     printf("(%s) Connected to %s:%d\n", TESTENV, IPADDR, PORT);
@@ -610,9 +605,8 @@ Then it rotates the roller in reverse direction to release the balls into the ba
 	    
       #ifdef MYRIO
       if(use_myrio) {
-      size_t written = write(c_socket, data, sizeof(data)); //Send 24 bit array named 'data' to TCP/IP by write function.
-	  
-      if(DEBUG) printf("%d bytes written\n", (int) written); //print msgwhether TCP/IP is working well.
+      if(!myrio.setCommand(data))
+        ROS_ERROR_THROTTLE(1, "(%s) Lost the link to the myRIO", TESTENV);
       }
       #endif
 
@@ -621,7 +615,7 @@ Then it rotates the roller in reverse direction to release the balls into the ba
       timer_ticks++; //increase time_ticks 1.
     }
 
-    close(c_socket); //close socket
+    myrio.close(); //close socket
     ros::shutdown();
 
     return -1;
@@ -1054,7 +1048,7 @@ int furthest_green() {
 #ifdef LIDAR
 void lidar_Callback(const lidar::coor::ConstPtr& pos)
 {
-  /* Update absolute position using pos */
+  /* Update absolute position using pos : cm, cm, degrees in [0, 360) (lidar/msg/coor.msg) */
   xpos_abs = pos->coor_x;
   ypos_abs = pos->coor_y;
   theta_abs = pos->coor_theta;
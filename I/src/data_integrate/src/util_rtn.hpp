@@ -2,6 +2,7 @@
 #include "core_msgs/ball_position_top.h"
 #include "core_msgs/roller_num.h"
 #include "lidar/coor.h"
+#include "sensor_msgs/LaserScan.h"
 
 #ifndef UTIL_H
 #define UTIL_H
@@ -59,7 +60,10 @@ enum status {
   /* Return to goal pos */
   LIDAR_RETURN,
   SEARCH_GREEN,
-  RELEASE
+  APPROACH_GREEN, APPROACH_GREEN_2, APPROACH_GREEN_3, APPROACH_GREEN_4, APPROACH_GREEN_5,
+  RELEASE,
+
+  STATUS_COUNT
 };
 
 enum color {
@@ -74,6 +78,7 @@ enum actions {
 void dataInit();
 void find_ball();
 void lidar_Callback(const lidar::coor::ConstPtr& scan);
+void scan_Callback(const sensor_msgs::LaserScan::ConstPtr& scan);
 void camera_Callback(const core_msgs::ball_position::ConstPtr& position);
 void camera_Callback_top(const core_msgs::ball_position_top::ConstPtr& position);
 void camera_Callback_counter(const core_msgs::roller_num::ConstPtr& cnt);
@@ -89,6 +94,7 @@ int centermost_green(); //아래있는 카메라로 봤을때 가장 가운데
 int leftmost_green(); //아래있는 카메라로 봤을때 가장 왼쪽에 있는 Green ball에 대한 array의 index를 반환한다. 없으면 return -1//
 int rightmost_green(); //아래있는 카메라로 봤을때 가장 오른쪽에 있는 Green ball에 대한 array의 index를 반환한다. 없으면 return -1//
 int leftmost_green_top(); //위에있는 카메라로 봤을때 가장 가운데에 있는 Green ball에 대한 array의 index를 반환한다. 없으면 return -1//
+int furthest_green(); //아래있는 카메라로 봤을때 가장 멀리 있는 Green ball에 대한 array의 index를 반환한다.//
 int closest_green(); //아래있는 카메라로 봤을때 가장 가까이 있는 Green ball에 대한 array의 index를 반환한다. 없으면 return -1//
 
 int target_blue(int policy); // 제일 왼쪽, 가운데, 가까운 파란색 공의 index
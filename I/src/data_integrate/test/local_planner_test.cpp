@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+#include <math.h>
+
+#include "data_integrate/local_planner.h"
+
+using local_planner::LocalPlanner;
+using local_planner::PlannerParams;
+
+namespace {
+
+/* 3.2 m square, 10 cm cells; a red ball blocks a disc of 1.5 cells */
+PlannerParams smallGrid()
+{
+  PlannerParams p;
+  p.resolution = 0.1f;
+  p.size = 32;
+  p.origin_x = 0;
+  p.origin_y = 0;
+  p.robot_radius = 0.1f;
+  p.red_radius = 0.05f;
+  p.red_merge = 0.05f;
+  p.lookahead = 0.1f;
+  return p;
+}
+
+const float START_X = 0.55f, START_Y = 1.65f;
+const float GOAL_X = 2.65f, GOAL_Y = 1.65f;
+const float STRAIGHT = 2.1f;
+
+/* red balls stacked into a wall across the whole grid at x = 1.65 */
+void addWall(LocalPlanner& planner)
+{
+  for(int i = 0; i < 32; i++) planner.addRed(1.65f, 0.05f + 0.1f * i);
+}
+
+}
+
+TEST(LocalPlanner, PlansAroundABlockedCell)
+{
+  LocalPlanner planner(smallGrid());
+  planner.addRed(1.65f, 1.65f);
+  ASSERT_TRUE(planner.blocked(1.65f, 1.65f));
+  ASSERT_TRUE(planner.setGoal(GOAL_X, GOAL_Y));
+
+  float x = START_X, y = START_Y;
+  ASSERT_TRUE(planner.plan(x, y));
+  EXPECT_GT(planner.pathLength(), STRAIGHT);
+
+  /* step along the path one waypoint at a time, replanning from each */
+  int steps = 0;
+  while(planner.goalDistance() > 0.01f && steps < 100) {
+    float wx, wy;
+    ASSERT_TRUE(planner.waypoint(wx, wy));
+    EXPECT_FALSE(planner.blocked(wx, wy)) << "waypoint (" << wx << ", " << wy << ")";
+    x = wx;
+    y = wy;
+    ASSERT_TRUE(planner.plan(x, y));
+    steps++;
+  }
+  EXPECT_NEAR(x, GOAL_X, 1e-3);
+  EXPECT_NEAR(y, GOAL_Y, 1e-3);
+}
+
+TEST(LocalPlanner, ReplansWhenCellsFlip)
+{
+  LocalPlanner planner(smallGrid());
+  ASSERT_TRUE(planner.setGoal(GOAL_X, GOAL_Y));
+  ASSERT_TRUE(planner.plan(START_X, START_Y));
+  EXPECT_NEAR(planner.pathLength(), STRAIGHT, 1e-3);
+
+  /* free -> blocked : the kept search must match one started on this map */
+  planner.addRed(1.65f, 1.65f);
+  ASSERT_TRUE(planner.plan(START_X, START_Y));
+
+  LocalPlanner fresh(smallGrid());
+  fresh.addRed(1.65f, 1.65f);
+  fresh.setGoal(GOAL_X, GOAL_Y);
+  ASSERT_TRUE(fresh.plan(START_X, START_Y));
+  EXPECT_GT(planner.pathLength(), STRAIGHT);
+  EXPECT_FLOAT_EQ(planner.pathLength(), fresh.pathLength());
+
+  /* blocked -> free : back to the straight line */
+  planner.clearRed();
+  ASSERT_TRUE(planner.plan(START_X, START_Y));
+  EXPECT_NEAR(planner.pathLength(), STRAIGHT, 1e-3);
+
+  /* cut off completely : no path, and it comes back once the wall goes */
+  addWall(planner);
+  EXPECT_FALSE(planner.plan(START_X, START_Y));
+  EXPECT_FALSE(planner.searching());
+  EXPECT_TRUE(isinf(planner.pathLength()));
+  planner.clearRed();
+  ASSERT_TRUE(planner.plan(START_X, START_Y));
+  EXPECT_NEAR(planner.pathLength(), STRAIGHT, 1e-3);
+}
+
+TEST(LocalPlanner, HonoursMaxExpansions)
+{
+  PlannerParams params = smallGrid();
+  LocalPlanner uncapped(params);
+  uncapped.setGoal(GOAL_X, GOAL_Y);
+  ASSERT_TRUE(uncapped.plan(START_X, START_Y));
+  ASSERT_GT(uncapped.expanded(), 20);
+
+  params.max_expansions = 20;
+  LocalPlanner planner(params);
+  planner.setGoal(GOAL_X, GOAL_Y);
+
+  /* the search is split over calls, each within the cap, and ends where the uncapped one did */
+  int calls = 0;
+  bool found = false;
+  while(!found && calls < 1000) {
+    found = planner.plan(START_X, START_Y);
+    calls++;
+    EXPECT_LE(planner.expanded(), params.max_expansions);
+    if(!found) {
+      EXPECT_TRUE(planner.searching());
+      float wx, wy;
+      EXPECT_FALSE(planner.waypoint(wx, wy));
+    }
+  }
+  ASSERT_TRUE(found);
+  EXPECT_GT(calls, 1);
+  EXPECT_FALSE(planner.searching());
+  EXPECT_FLOAT_EQ(planner.pathLength(), uncapped.pathLength());
+}
+
+int main(int argc, char** argv)
+{
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,60 @@
+#ifndef LIDAR_LOCAL_MAP_H
+#define LIDAR_LOCAL_MAP_H
+
+#include <stdint.h>
+#include <boost/unordered_map.hpp>
+#include <Eigen/Core>
+
+#include "lidar/scan_matcher.h"
+
+namespace lidar {
+
+struct LocalMapParams {
+    double voxel_size;          // map_voxel_size [m], one point kept per voxel
+    double radius;              // map_radius [m], voxels farther from the robot are dropped
+    double keyframe_distance;   // map_keyframe_distance [m]
+    double keyframe_angle;      // map_keyframe_angle [rad]
+
+    LocalMapParams()
+        : voxel_size(0.05)
+        , radius(6.0)
+        , keyframe_distance(0.2)
+        , keyframe_angle(0.26) {}
+};
+
+/* Bounded rolling 2D point map for scan-to-map matching.
+ * Scans are inserted as keyframes into a voxel hash (one point per cell), the
+ * map is cropped to a radius around the robot, and the flat cloud handed to the
+ * matcher is rebuilt only when a keyframe changes the map. */
+class LocalMap {
+public:
+    explicit LocalMap(const LocalMapParams& params = LocalMapParams());
+
+    void setParams(const LocalMapParams& params) { params_ = params; }
+
+    /* True when pose has moved far enough from the last keyframe */
+    bool needsKeyframe(const Eigen::Matrix4f& pose) const;
+
+    /* Insert scan (sensor frame) at pose (sensor -> map) and crop around pose */
+    void insertKeyframe(const ScanCloud& scan, const Eigen::Matrix4f& pose);
+
+    ScanCloud::ConstPtr cloud() const { return cloud_; }
+    bool empty() const { return voxels_.empty(); }
+    void clear();
+
+private:
+    typedef boost::unordered_map<uint64_t, ScanPoint> VoxelMap;
+
+    /* cell indices as two 32 bit halves */
+    uint64_t voxelKey(float x, float y) const;
+
+    LocalMapParams params_;
+    VoxelMap voxels_;
+    ScanCloud::Ptr cloud_;
+    Eigen::Matrix4f last_keyframe_;
+    bool has_keyframe_;
+};
+
+}
+
+#endif
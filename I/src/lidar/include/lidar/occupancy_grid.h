@@ -0,0 +1,91 @@
+#ifndef LIDAR_OCCUPANCY_GRID_H
+#define LIDAR_OCCUPANCY_GRID_H
+
+#include <stdint.h>
+#include <cmath>
+#include <vector>
+#include <boost/unordered_map.hpp>
+#include <sensor_msgs/LaserScan.h>
+
+namespace lidar {
+
+struct OccupancyGridParams {
+    double resolution;      // grid_resolution [m] per cell
+    double max_range;       // grid_max_range [m], longer returns only clear space up to here
+    int hit;                // log-odds added to the cell a beam ends in (x100)
+    int miss;               // log-odds added to the cells a beam passes (x100, negative)
+    int min_log_odds;       // clamp, so a cell can change its mind within a few scans
+    int max_log_odds;
+
+    OccupancyGridParams()
+        : resolution(0.05)
+        , max_range(8.0)
+        , hit(85)           // p = 0.7
+        , miss(-40)         // p = 0.4
+        , min_log_odds(-200)
+        , max_log_odds(350) {}
+};
+
+/* Log-odds occupancy grid over an unbounded plane.
+ * Cells live in TILE x TILE tiles that are allocated the first time a beam
+ * touches them, so memory follows the explored area. Each scan is cast with
+ * integer Bresenham rays from the sensor cell to the hit cell. Tiles changed
+ * since the last takeDirty() are reported so publishers and displays can
+ * send or redraw only those. */
+class OccupancyGrid {
+public:
+    enum { TILE_BITS = 6, TILE = 1 << TILE_BITS };
+
+    typedef int16_t Cell;
+    static const Cell UNKNOWN = -32768;  // never observed
+
+    struct Tile {
+        int tx, ty;             // tile coordinates; cell (cx, cy) = (tx*TILE + i, ty*TILE + j)
+        bool dirty;
+        std::vector<Cell> cells;    // row-major, TILE rows of TILE cells, row = y
+    };
+
+    explicit OccupancyGrid(const OccupancyGridParams& params = OccupancyGridParams());
+
+    void setParams(const OccupancyGridParams& params) { params_ = params; }
+    const OccupancyGridParams& params() const { return params_; }
+
+    /* integrate a scan taken at pose (x, y [m], theta [rad]) in the grid frame */
+    void insertScan(const sensor_msgs::LaserScan& scan, double x, double y, double theta);
+
+    /* tiles changed since the last call; clears their dirty flags */
+    void takeDirty(std::vector<const Tile*>& tiles);
+
+    /* tile at tile coordinates, or NULL if never touched */
+    const Tile* tile(int tx, int ty) const;
+
+    /* bounding box of allocated tiles, inclusive; false while empty */
+    bool bounds(int& tx0, int& ty0, int& tx1, int& ty1) const;
+
+    size_t tileCount() const { return tiles_.size(); }
+    void clear();
+
+    int cellIndex(double v) const { return (int)floor(v / params_.resolution); }
+
+    /* nav_msgs/OccupancyGrid value of a cell : -1 unknown, else 0..100 */
+    static int8_t occupancy(Cell c);
+
+private:
+    typedef boost::unordered_map<long long, Tile> TileMap;
+
+    static long long tileKey(int tx, int ty) { return ((long long)tx << 32) ^ (ty & 0xFFFFFFFFLL); }
+
+    Cell& cell(int cx, int cy);
+    void update(int cx, int cy, int delta);
+    void castRay(int x0, int y0, int x1, int y1, bool hit);
+
+    OccupancyGridParams params_;
+    TileMap tiles_;
+    std::vector<long long> dirty_;
+    Tile* last_tile_;           // cache for runs of cells in the same tile
+    int tx0_, ty0_, tx1_, ty1_;
+};
+
+}
+
+#endif
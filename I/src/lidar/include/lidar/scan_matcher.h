@@ -0,0 +1,72 @@
+#ifndef LIDAR_SCAN_MATCHER_H
+#define LIDAR_SCAN_MATCHER_H
+
+#include <sensor_msgs/LaserScan.h>
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <pcl/search/kdtree.h>
+#include <pcl/registration/icp.h>
+
+#include <cmath>
+
+namespace lidar {
+
+typedef pcl::PointXYZ ScanPoint;
+typedef pcl::PointCloud<ScanPoint> ScanCloud;
+
+/* ICP limits, loaded from the node's private parameters */
+struct ScanMatcherParams {
+    int max_iterations;                 // icp_max_iterations
+    double max_correspondence_distance; // icp_max_correspondence_distance [m]
+    double transformation_epsilon;      // icp_transformation_epsilon
+    double euclidean_fitness_epsilon;   // icp_euclidean_fitness_epsilon
+    double max_fitness_score;           // icp_max_fitness_score [m^2], worse matches are rejected
+
+    ScanMatcherParams()
+        : max_iterations(30)
+        , max_correspondence_distance(0.3)
+        , transformation_epsilon(1e-6)
+        , euclidean_fitness_epsilon(1e-5)
+        , max_fitness_score(0.05) {}
+};
+
+/* Convert a LaserScan into an x-y cloud, skipping inf/nan ranges.
+ * The cloud is reused, so steady state does not allocate. */
+void scanToCloud(const sensor_msgs::LaserScan& scan, ScanCloud& cloud);
+
+/* Heading of a 2D transform in (-pi, pi]; acos of the cosine term alone loses the sign */
+inline double transformYaw(const Eigen::Matrix4f& T) { return atan2(T(1,0), T(0,0)); }
+
+/* 2D ICP scan matcher.
+ * The target cloud and its k-d tree are built once in setTarget() and reused by
+ * every match() until the next setTarget(); the ICP object itself lives as long
+ * as the matcher. Registration is restricted to x, y and yaw. */
+class ScanMatcher {
+public:
+    explicit ScanMatcher(const ScanMatcherParams& params = ScanMatcherParams());
+
+    void setParams(const ScanMatcherParams& params);
+    const ScanMatcherParams& params() const { return params_; }
+
+    void setTarget(const ScanCloud::ConstPtr& target);
+    bool hasTarget() const { return target_ && !target_->empty(); }
+
+    /* Align source onto the target starting from guess (source -> target).
+     * Returns false when ICP did not converge or the fitness is too poor;
+     * result is only written on success. */
+    bool match(const ScanCloud::ConstPtr& source, const Eigen::Matrix4f& guess, Eigen::Matrix4f& result);
+
+    double fitnessScore() const { return fitness_score_; }
+
+private:
+    ScanMatcherParams params_;
+    pcl::IterativeClosestPoint<ScanPoint, ScanPoint> icp_;
+    pcl::search::KdTree<ScanPoint>::Ptr target_tree_;
+    ScanCloud::ConstPtr target_;
+    ScanCloud aligned_;
+    double fitness_score_;
+};
+
+}
+
+#endif
@@ -8,12 +8,10 @@
 
 #include <fstream>
 #include <iostream>
-#include <pcl/io/pcd_io.h>
-#include <pcl/point_types.h>
-#include <pcl/registration/icp.h>
-#include <pcl/filters/extract_indices.h>
 
 #include "lidar/coor.h"
+#include "lidar/scan_matcher.h"
+#include "lidar/local_map.h"
 
 
 
@@ -23,126 +21,97 @@ using namespace std;
 
 
 // Global variable
-pcl::PointCloud<pcl::PointXYZ>::Ptr prev_cloud (new::pcl::PointCloud<pcl::PointXYZ>);
-Eigen::Matrix4f transMtx_now;
-Eigen::Matrix4f transMtx_prev;
-Eigen::Matrix4f transMtx_delta;
+lidar::ScanMatcher matcher;
+lidar::LocalMap local_map;
 
-double pos[3];
-
-ros::Publisher pub_lidar;
-
-void lidar_cb(sensor_msgs::LaserScan msg){
-
-    // angle in radian
-    float angle_min = msg.angle_min;
-    float angle_max = msg.angle_max;
-    float angle_increment = msg.angle_increment;
-    std::vector<float> range = msg.ranges;
+// "map": align each scan onto the rolling local map (bounded drift)
+// "scan": align each scan onto the previous one (drift accumulates)
+bool match_to_map = true;
 
-    // size of range vector
-    int len = range.size();
-    float angle_temp;
+// ping-pong clouds: the previous scan stays the matcher target while the new one is filled
+lidar::ScanCloud::Ptr prev_cloud (new lidar::ScanCloud);
+lidar::ScanCloud::Ptr new_cloud (new lidar::ScanCloud);
 
-    /// 1. LaserScan msg to PCL::PointXYZ
+Eigen::Matrix4f transMtx_now;   // current pose (sensor -> odometry origin)
+Eigen::Matrix4f motion_guess;   // last scan-to-scan motion, seeds the next alignment
+bool initialized = false;
 
-    // initializae pointcloud
-    pcl::PointCloud<pcl::PointXYZ>::Ptr new_cloud (new::pcl::PointCloud<pcl::PointXYZ>);
-    pcl::ExtractIndices<pcl::PointXYZ> extract;
-    pcl::PointIndices::Ptr inf_points(new pcl::PointIndices());
-
-    new_cloud->is_dense = false;
-    new_cloud->width = len;
-    new_cloud->height = 1;
-    new_cloud->points.resize(len);
-
-    // fill the pointcloud
-    for(int i = 0; i < len; i++){
+double pos[3];
 
-        // TO DO START
+ros::Publisher pub_lidar;
 
-        angle_temp = angle_min + i*angle_increment;
+void lidar_cb(const sensor_msgs::LaserScan::ConstPtr& msg){
 
-        // TO DO END
+    /// 1. LaserScan msg to PCL::PointXYZ (infinite ranges are skipped)
 
-        if (std::isinf(range[i])==false){
+    lidar::scanToCloud(*msg, *new_cloud);
 
-            // TO DO START
+    bool matched = true;
 
-            new_cloud->points[i].x = range[i]*cos(angle_temp);
-            new_cloud->points[i].y = range[i]*sin(angle_temp);
-            new_cloud->points[i].z = 0;
+    // 2. Get the current pose
+    // transMtx_now : 4X4 transformation matrix (3X3: rotation matrix, 3X1: translation vector)
 
-            // TO DO END
+    if(!initialized){
 
-        }
-        else{
-            // indices of infinite distance points
-            inf_points->indices.push_back(i);
+        // initialize transformation matrix. initial posiiton: x = 0, y = 0, theta = 0;
+        transMtx_now = Eigen::Matrix4f::Identity();
+        motion_guess = Eigen::Matrix4f::Identity();
 
+        if(match_to_map){
+            local_map.clear();
+            local_map.insertKeyframe(*new_cloud, transMtx_now);
+            matcher.setTarget(local_map.cloud());
         }
-    }
-
-    // Remove infinite distance points from new_cloud
-    extract.setInputCloud(new_cloud);
-    extract.setIndices(inf_points);
-    extract.setNegative(true);
-    extract.filter(*new_cloud);
-
-    // 2. Get transformation between previous pointcloud and current pointcloud
-
-    // transMtx_prev : transformation matrix at time (t-1)
-    // transMtx_now : transformation matrix at time (t)
-    // 4X4 transformation matrix (3X3: rotation matrix, 3X1: translation vector)
-
-    if(prev_cloud->width == 0){
-
-        // initialize transformation matrix. initial posiiton: x = 0, y = 0, theta = 0;
-        transMtx_prev << cos(0), -sin(0), 0, 0,
-                        sin(0), cos(0), 0, 0,
-                        0, 0, 1, 0,
-                        0, 0, 0, 1;
+        initialized = true;
     }
 
     else{
 
-        // ICP algorithm
-        // http://pointclouds.org/documentation/tutorials/iterative_closest_point.php
-        // http://pointclouds.org/documentation/tutorials/interactive_icp.php#interactive-icp
-        pcl::IterativeClosestPoint<pcl::PointXYZ, pcl::PointXYZ> icp;
-        icp.setInputSource(prev_cloud);
-        icp.setInputTarget(new_cloud);
-        pcl::PointCloud<pcl::PointXYZ> Final;
-        icp.align(Final);
-        //std::cout << "has converged:" << icp.hasConverged() << " score: " <<
-        //icp.getFitnessScore() << std::endl;
-        //std::cout << icp.getFinalTransformation() << std::endl;
-
-        transMtx_delta = icp.getFinalTransformation();
-
-    // 3. Get current transformation matrix using previous transformation and ICP result
-    //  (Odometry calculation)
-
-        // TO DO START
-
-        transMtx_now = transMtx_prev*transMtx_delta;
-
-        // TO DO END
+        if(match_to_map){
+            // The map is the target; its k-d tree is rebuilt only when a keyframe changes it.
+            // The new scan is aligned straight into the map frame, so errors do not chain.
+            Eigen::Matrix4f pose;
+            matched = matcher.match(new_cloud, transMtx_now*motion_guess, pose);
+            if(matched){
+                motion_guess = transMtx_now.inverse()*pose;
+                transMtx_now = pose;
+
+                if(local_map.needsKeyframe(transMtx_now)){
+                    local_map.insertKeyframe(*new_cloud, transMtx_now);
+                    matcher.setTarget(local_map.cloud());
+                }
+            }
+        }
+        else{
+            // The previous scan is the target and the new scan is aligned onto it
+            // starting from the last motion (odometry by chaining).
+            Eigen::Matrix4f motion;
+            matched = matcher.match(new_cloud, motion_guess, motion);
+            if(matched){
+                motion_guess = motion;
+                transMtx_now = transMtx_now*motion;
+            }
+        }
 
-    // 4. Get current position from transformation matrix
+        if(matched){
 
-        // TO DO START
+    // 3. Get current position from transformation matrix
+    //  (x, y in cm, theta in degrees within [0, 360), see msg/coor.msg)
+    //  data_integrate turns back home to 170..190 degrees, which the old acos heading,
+    //  folded into [0, 180], could only reach from one side.
 
-        pos[0] = transMtx_now(0,3);
-        pos[1] = transMtx_now(1,3);
-        pos[2] = RADtoDEG(acos(transMtx_now(0,0)));
+            double theta = RADtoDEG(lidar::transformYaw(transMtx_now));
+            if(theta < 0) theta += 360.;
 
-        // TO DO END
-        pos[0] = round(pos[0]*100);
-        pos[1] = round(pos[1]*100);
-        pos[2] = round(pos[2]);
+            pos[0] = round(transMtx_now(0,3)*100);
+            pos[1] = round(transMtx_now(1,3)*100);
+            pos[2] = round(theta);
+            if(pos[2] >= 360.) pos[2] -= 360.;
+        }
+        else{
+            ROS_WARN_THROTTLE(1, "ICP rejected scan (fitness %f), holding pose", matcher.fitnessScore());
+        }
 
-        transMtx_prev = transMtx_now; // Save current transformation matrix in transMtx_prev
         lidar::coor coor_data;
         coor_data.coor_x = pos[0];
         coor_data.coor_y = pos[1];
@@ -152,41 +121,49 @@ void lidar_cb(sensor_msgs::LaserScan msg){
     }
 
 
-    // 5. Save new_cloud in prev_cloud
+    // 4. In scan mode save new_cloud in prev_cloud and make it the next target.
+    //    A rejected scan is dropped, so the next one is still matched against the last good scan.
 
-    prev_cloud = new_cloud;
+    if(!match_to_map && matched){
+        std::swap(prev_cloud, new_cloud);
+        matcher.setTarget(prev_cloud);
+    }
 
+    ROS_INFO_THROTTLE(0.2, "pos : x = %f | y = %f | theta = %f", pos[0], pos[1], pos[2]);
 }
 
 int main(int argc, char **argv){
 
     ros::init(argc, argv, "lidar_coor_node");
     ros::NodeHandle nh;/* message */
+    ros::NodeHandle nh_private("~");
 
-    ros::Subscriber sub_lidar = nh.subscribe("/scan", 1, lidar_cb);
-    pub_lidar = nh.advertise<lidar::coor>("/lidar_coor", 100);
-    ros::Rate loop_rate(5);
-
-    // initialize prev_cloud
-    prev_cloud->width = 0;
+    lidar::ScanMatcherParams params;
+    nh_private.param("icp_max_iterations", params.max_iterations, params.max_iterations);
+    nh_private.param("icp_max_correspondence_distance", params.max_correspondence_distance, params.max_correspondence_distance);
+    nh_private.param("icp_transformation_epsilon", params.transformation_epsilon, params.transformation_epsilon);
+    nh_private.param("icp_euclidean_fitness_epsilon", params.euclidean_fitness_epsilon, params.euclidean_fitness_epsilon);
+    nh_private.param("icp_max_fitness_score", params.max_fitness_score, params.max_fitness_score);
+    matcher.setParams(params);
 
-    // File write
+    std::string match_mode;
+    nh_private.param<std::string>("match_mode", match_mode, "map");
+    match_to_map = (match_mode != "scan");
 
-    // TO DO START
-    // string filePath = "/home/thanhndv212/capstone_1_ROS/coordinate.txt"; //<- Change to your own directory
-    // TO DO END
+    lidar::LocalMapParams map_params;
+    nh_private.param("map_voxel_size", map_params.voxel_size, map_params.voxel_size);
+    nh_private.param("map_radius", map_params.radius, map_params.radius);
+    nh_private.param("map_keyframe_distance", map_params.keyframe_distance, map_params.keyframe_distance);
+    nh_private.param("map_keyframe_angle", map_params.keyframe_angle, map_params.keyframe_angle);
+    local_map.setParams(map_params);
 
-    // ofstream txtFile(filePath);
+    ROS_INFO("lidar_coor match mode : %s", match_to_map ? "map" : "scan");
 
-    while(ros::ok()){
-        ros::spinOnce();
-
-        ROS_INFO("pos : x = %f | y = %f | theta = %f", pos[0], pos[1], pos[2]);
-        // txtFile << "position: " << pos[0] << "\t" << pos[1] << "\t" << pos[2] << endl;
+    ros::Subscriber sub_lidar = nh.subscribe("/scan", 1, lidar_cb);
+    pub_lidar = nh.advertise<lidar::coor>("/lidar_coor", 100);
 
-        loop_rate.sleep();
-    }
+    // Callbacks run as scans arrive; the former 5 Hz spin loop dropped every other 10 Hz scan
+    ros::spin();
 
-    // txtFile.close();
     return 0;
 }
@@ -0,0 +1,79 @@
+#include "lidar/local_map.h"
+
+#include <cmath>
+
+namespace lidar {
+
+LocalMap::LocalMap(const LocalMapParams& params)
+    : params_(params)
+    , cloud_(new ScanCloud)
+    , last_keyframe_(Eigen::Matrix4f::Identity())
+    , has_keyframe_(false)
+{
+}
+
+void LocalMap::clear()
+{
+    voxels_.clear();
+    cloud_.reset(new ScanCloud);
+    has_keyframe_ = false;
+}
+
+uint64_t LocalMap::voxelKey(float x, float y) const
+{
+    int32_t ix = (int32_t)floor(x / params_.voxel_size);
+    int32_t iy = (int32_t)floor(y / params_.voxel_size);
+    // shift unsigned, negative indices left of / below the origin would be UB as signed
+    return ((uint64_t)(uint32_t)ix << 32) | (uint32_t)iy;
+}
+
+bool LocalMap::needsKeyframe(const Eigen::Matrix4f& pose) const
+{
+    if(!has_keyframe_) return true;
+
+    Eigen::Matrix4f delta = last_keyframe_.inverse()*pose;
+    double dist = hypot(delta(0,3), delta(1,3));
+    double angle = fabs(atan2(delta(1,0), delta(0,0)));
+    return dist > params_.keyframe_distance || angle > params_.keyframe_angle;
+}
+
+void LocalMap::insertKeyframe(const ScanCloud& scan, const Eigen::Matrix4f& pose)
+{
+    for(size_t i = 0; i < scan.points.size(); i++){
+        const ScanPoint& p = scan.points[i];
+        ScanPoint q;
+        q.x = pose(0,0)*p.x + pose(0,1)*p.y + pose(0,3);
+        q.y = pose(1,0)*p.x + pose(1,1)*p.y + pose(1,3);
+        q.z = 0;
+
+        // the first point seen in a voxel stays, so old structure is not dragged by later drift
+        voxels_.insert(VoxelMap::value_type(voxelKey(q.x, q.y), q));
+    }
+
+    // drop what fell out of the window and rebuild the flat cloud for the matcher
+    float cx = pose(0,3), cy = pose(1,3);
+    float r2 = params_.radius*params_.radius;
+
+    // the matcher may still hold the previous cloud, so build into a fresh one
+    ScanCloud::Ptr cloud(new ScanCloud);
+    cloud->points.reserve(voxels_.size());
+    for(VoxelMap::iterator it = voxels_.begin(); it != voxels_.end(); ){
+        float dx = it->second.x - cx, dy = it->second.y - cy;
+        if(dx*dx + dy*dy > r2){
+            it = voxels_.erase(it);
+        }
+        else{
+            cloud->points.push_back(it->second);
+            ++it;
+        }
+    }
+    cloud->width = cloud->points.size();
+    cloud->height = 1;
+    cloud->is_dense = true;
+    cloud_ = cloud;
+
+    last_keyframe_ = pose;
+    has_keyframe_ = true;
+}
+
+}
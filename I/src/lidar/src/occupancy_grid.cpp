@@ -0,0 +1,131 @@
+#include "lidar/occupancy_grid.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace lidar {
+
+const OccupancyGrid::Cell OccupancyGrid::UNKNOWN;
+
+OccupancyGrid::OccupancyGrid(const OccupancyGridParams& params)
+    : params_(params)
+    , last_tile_(NULL)
+{
+}
+
+void OccupancyGrid::clear()
+{
+    tiles_.clear();
+    dirty_.clear();
+    last_tile_ = NULL;
+}
+
+OccupancyGrid::Cell& OccupancyGrid::cell(int cx, int cy)
+{
+    int tx = cx >> TILE_BITS;   // arithmetic shift floors negative cells too
+    int ty = cy >> TILE_BITS;
+
+    if(!last_tile_ || last_tile_->tx != tx || last_tile_->ty != ty){
+        long long key = tileKey(tx, ty);
+        TileMap::iterator it = tiles_.find(key);
+        if(it == tiles_.end()){
+            if(tiles_.empty()){
+                tx0_ = tx1_ = tx;
+                ty0_ = ty1_ = ty;
+            }
+            else{
+                tx0_ = std::min(tx0_, tx); tx1_ = std::max(tx1_, tx);
+                ty0_ = std::min(ty0_, ty); ty1_ = std::max(ty1_, ty);
+            }
+            Tile t;
+            t.tx = tx;
+            t.ty = ty;
+            t.dirty = false;
+            t.cells.assign(TILE*TILE, UNKNOWN);
+            it = tiles_.insert(TileMap::value_type(key, t)).first;
+        }
+        // unordered_map nodes do not move on rehash, so the pointer stays valid
+        last_tile_ = &it->second;
+    }
+
+    if(!last_tile_->dirty){
+        last_tile_->dirty = true;
+        dirty_.push_back(tileKey(tx, ty));
+    }
+    return last_tile_->cells[(cy & (TILE-1))*TILE + (cx & (TILE-1))];
+}
+
+void OccupancyGrid::update(int cx, int cy, int delta)
+{
+    Cell& c = cell(cx, cy);
+    int v = (c == UNKNOWN) ? 0 : c;
+    c = (Cell)std::max(params_.min_log_odds, std::min(params_.max_log_odds, v + delta));
+}
+
+void OccupancyGrid::castRay(int x0, int y0, int x1, int y1, bool hit)
+{
+    int dx = abs(x1 - x0), sx = (x0 < x1) ? 1 : -1;
+    int dy = -abs(y1 - y0), sy = (y0 < y1) ? 1 : -1;
+    int err = dx + dy;
+
+    while(x0 != x1 || y0 != y1){
+        update(x0, y0, params_.miss);
+        int e2 = 2*err;
+        if(e2 >= dy){ err += dy; x0 += sx; }
+        if(e2 <= dx){ err += dx; y0 += sy; }
+    }
+    update(x1, y1, hit ? params_.hit : params_.miss);
+}
+
+void OccupancyGrid::insertScan(const sensor_msgs::LaserScan& scan, double x, double y, double theta)
+{
+    int cx = cellIndex(x), cy = cellIndex(y);
+    double max_range = std::min((double)scan.range_max, params_.max_range);
+
+    float angle = scan.angle_min;
+    for(size_t i = 0; i < scan.ranges.size(); i++, angle += scan.angle_increment){
+        float range = scan.ranges[i];
+        // no return at all says nothing about the free space, skip it
+        if(!std::isfinite(range) || range < scan.range_min) continue;
+
+        bool hit = range <= max_range;
+        double r = hit ? range : max_range;
+        double a = theta + angle;
+        castRay(cx, cy, cellIndex(x + r*cos(a)), cellIndex(y + r*sin(a)), hit);
+    }
+}
+
+void OccupancyGrid::takeDirty(std::vector<const Tile*>& tiles)
+{
+    tiles.clear();
+    for(size_t i = 0; i < dirty_.size(); i++){
+        TileMap::iterator it = tiles_.find(dirty_[i]);
+        if(it == tiles_.end()) continue;
+        it->second.dirty = false;
+        tiles.push_back(&it->second);
+    }
+    dirty_.clear();
+}
+
+const OccupancyGrid::Tile* OccupancyGrid::tile(int tx, int ty) const
+{
+    TileMap::const_iterator it = tiles_.find(tileKey(tx, ty));
+    return (it == tiles_.end()) ? NULL : &it->second;
+}
+
+bool OccupancyGrid::bounds(int& tx0, int& ty0, int& tx1, int& ty1) const
+{
+    if(tiles_.empty()) return false;
+    tx0 = tx0_; ty0 = ty0_;
+    tx1 = tx1_; ty1 = ty1_;
+    return true;
+}
+
+int8_t OccupancyGrid::occupancy(Cell c)
+{
+    if(c == UNKNOWN) return -1;
+    // p = 1 - 1/(1 + exp(l)), l = c/100
+    return (int8_t)lround(100.0 - 100.0/(1.0 + exp(c*0.01)));
+}
+
+}
@@ -0,0 +1,178 @@
+#include <ros/ros.h>
+#include <sensor_msgs/LaserScan.h>
+#include <nav_msgs/OccupancyGrid.h>
+#include <map_msgs/OccupancyGridUpdate.h>
+#include <vector>
+#include <algorithm>
+
+#include "opencv2/opencv.hpp"
+
+#include "lidar/coor.h"
+#include "lidar/occupancy_grid.h"
+
+#define DEGtoRAD(x) ((x)*M_PI/180.)
+
+using namespace std;
+
+typedef lidar::OccupancyGrid Grid;
+
+// Global variable
+Grid grid;
+
+// newest scan; integrated once, when lidar_coor publishes the pose it computed from it
+sensor_msgs::LaserScan::ConstPtr last_scan;
+bool scan_pending = false;
+
+ros::Publisher pub_map;
+ros::Publisher pub_updates;
+string frame_id;
+bool display = false;
+
+// tile box the last full map covered; updates are sent relative to it
+bool map_sent = false;
+int map_tx0, map_ty0, map_tx1, map_ty1;
+ros::Time map_stamp;
+double full_map_period;     // [s], the latched map is refreshed this often for late subscribers
+
+// display canvas, one gray pixel per cell, north up
+cv::Mat canvas;
+
+void scan_cb(const sensor_msgs::LaserScan::ConstPtr& msg){
+    last_scan = msg;
+    scan_pending = true;
+}
+
+void coor_cb(const lidar::coor::ConstPtr& pose){
+    if(!scan_pending) return;
+
+    // lidar_coor publishes x, y in cm and theta in degrees
+    grid.insertScan(*last_scan, pose->coor_x/100., pose->coor_y/100., DEGtoRAD(pose->coor_theta));
+    scan_pending = false;
+}
+
+unsigned char gray(Grid::Cell c){
+    int8_t occ = Grid::occupancy(c);
+    return (occ < 0) ? 128 : (unsigned char)(255 - occ*255/100);
+}
+
+void blitTile(const Grid::Tile& t){
+    int col0 = (t.tx - map_tx0)*Grid::TILE;
+    int row0 = (map_ty1 - t.ty)*Grid::TILE + Grid::TILE - 1;
+    for(int j = 0; j < Grid::TILE; j++){
+        unsigned char* row = canvas.ptr<unsigned char>(row0 - j) + col0;
+        const Grid::Cell* cells = &t.cells[j*Grid::TILE];
+        for(int i = 0; i < Grid::TILE; i++) row[i] = gray(cells[i]);
+    }
+}
+
+void publishFull(){
+    grid.bounds(map_tx0, map_ty0, map_tx1, map_ty1);
+    map_sent = true;
+    map_stamp = ros::Time::now();
+
+    int width = (map_tx1 - map_tx0 + 1)*Grid::TILE;
+    int height = (map_ty1 - map_ty0 + 1)*Grid::TILE;
+    double res = grid.params().resolution;
+
+    nav_msgs::OccupancyGrid map;
+    map.header.stamp = map_stamp;
+    map.header.frame_id = frame_id;
+    map.info.map_load_time = map.header.stamp;
+    map.info.resolution = res;
+    map.info.width = width;
+    map.info.height = height;
+    map.info.origin.position.x = map_tx0*Grid::TILE*res;
+    map.info.origin.position.y = map_ty0*Grid::TILE*res;
+    map.info.origin.orientation.w = 1;
+    map.data.assign((size_t)width*height, -1);
+
+    if(display) canvas = cv::Mat(height, width, CV_8UC1, cv::Scalar(128));
+
+    for(int ty = map_ty0; ty <= map_ty1; ty++){
+        for(int tx = map_tx0; tx <= map_tx1; tx++){
+            const Grid::Tile* t = grid.tile(tx, ty);
+            if(!t) continue;
+            for(int j = 0; j < Grid::TILE; j++){
+                int8_t* row = &map.data[(size_t)((ty - map_ty0)*Grid::TILE + j)*width + (tx - map_tx0)*Grid::TILE];
+                for(int i = 0; i < Grid::TILE; i++) row[i] = Grid::occupancy(t->cells[j*Grid::TILE + i]);
+            }
+            if(display) blitTile(*t);
+        }
+    }
+    pub_map.publish(map);
+}
+
+void publishTile(const Grid::Tile& t){
+    map_msgs::OccupancyGridUpdate update;
+    update.header.stamp = ros::Time::now();
+    update.header.frame_id = frame_id;
+    update.x = (t.tx - map_tx0)*Grid::TILE;
+    update.y = (t.ty - map_ty0)*Grid::TILE;
+    update.width = Grid::TILE;
+    update.height = Grid::TILE;
+    update.data.resize(Grid::TILE*Grid::TILE);
+    for(size_t k = 0; k < update.data.size(); k++) update.data[k] = Grid::occupancy(t.cells[k]);
+    pub_updates.publish(update);
+}
+
+// Send what changed since the last tick : a full map when the explored box grew
+// (or the latched one is old), otherwise one update per dirty tile. The display is patched the same way.
+void publish_cb(const ros::TimerEvent&){
+    vector<const Grid::Tile*> dirty;
+    grid.takeDirty(dirty);
+    if(dirty.empty()) return;
+
+    int tx0, ty0, tx1, ty1;
+    grid.bounds(tx0, ty0, tx1, ty1);
+    bool grown = !map_sent || tx0 < map_tx0 || ty0 < map_ty0 || tx1 > map_tx1 || ty1 > map_ty1;
+    bool stale = map_sent && (ros::Time::now() - map_stamp).toSec() > full_map_period;
+
+    if(grown || stale){
+        publishFull();
+    }
+    else{
+        for(size_t k = 0; k < dirty.size(); k++){
+            publishTile(*dirty[k]);
+            if(display) blitTile(*dirty[k]);
+        }
+    }
+
+    if(display){
+        cv::imshow("occupancy_grid", canvas);
+        cv::waitKey(1);
+    }
+
+    ROS_INFO_THROTTLE(5, "occupancy grid : %d tiles, %d updated", (int)grid.tileCount(), (int)dirty.size());
+}
+
+int main(int argc, char **argv){
+
+    ros::init(argc, argv, "occupancy_mapper_node");
+    ros::NodeHandle nh;
+    ros::NodeHandle nh_private("~");
+
+    lidar::OccupancyGridParams params;
+    nh_private.param("grid_resolution", params.resolution, params.resolution);
+    nh_private.param("grid_max_range", params.max_range, params.max_range);
+    nh_private.param("grid_hit", params.hit, params.hit);
+    nh_private.param("grid_miss", params.miss, params.miss);
+    grid.setParams(params);
+
+    double publish_rate;
+    nh_private.param("publish_rate", publish_rate, 2.0);
+    nh_private.param("full_map_period", full_map_period, 10.0);
+    nh_private.param<string>("frame_id", frame_id, "odom");
+    nh_private.param("display", display, false);
+
+    ros::Subscriber sub_scan = nh.subscribe("/scan", 1, scan_cb);
+    ros::Subscriber sub_coor = nh.subscribe("/lidar_coor", 1, coor_cb);
+    // latched, so a late rviz still gets the map the updates refer to
+    pub_map = nh.advertise<nav_msgs::OccupancyGrid>("map", 1, true);
+    pub_updates = nh.advertise<map_msgs::OccupancyGridUpdate>("map_updates", 100);
+
+    ros::Timer timer = nh.createTimer(ros::Duration(1.0/publish_rate), publish_cb);
+
+    ros::spin();
+
+    return 0;
+}
@@ -0,0 +1,73 @@
+#include "lidar/scan_matcher.h"
+
+#include <cmath>
+#include <pcl/registration/transformation_estimation_2D.h>
+
+namespace lidar {
+
+void scanToCloud(const sensor_msgs::LaserScan& scan, ScanCloud& cloud)
+{
+    size_t len = scan.ranges.size();
+    float angle = scan.angle_min;
+
+    cloud.points.clear();
+    cloud.points.reserve(len);
+    for(size_t i = 0; i < len; i++, angle += scan.angle_increment){
+        float range = scan.ranges[i];
+        if(!std::isfinite(range)) continue;
+
+        ScanPoint p;
+        p.x = range*cos(angle);
+        p.y = range*sin(angle);
+        p.z = 0;
+        cloud.points.push_back(p);
+    }
+    cloud.width = cloud.points.size();
+    cloud.height = 1;
+    cloud.is_dense = true;
+}
+
+ScanMatcher::ScanMatcher(const ScanMatcherParams& params)
+    : target_tree_(new pcl::search::KdTree<ScanPoint>)
+    , fitness_score_(0)
+{
+    typedef pcl::registration::TransformationEstimation2D<ScanPoint, ScanPoint> Estimation2D;
+    icp_.setTransformationEstimation(Estimation2D::Ptr(new Estimation2D));
+    setParams(params);
+}
+
+void ScanMatcher::setParams(const ScanMatcherParams& params)
+{
+    params_ = params;
+    icp_.setMaximumIterations(params_.max_iterations);
+    icp_.setMaxCorrespondenceDistance(params_.max_correspondence_distance);
+    icp_.setTransformationEpsilon(params_.transformation_epsilon);
+    icp_.setEuclideanFitnessEpsilon(params_.euclidean_fitness_epsilon);
+}
+
+void ScanMatcher::setTarget(const ScanCloud::ConstPtr& target)
+{
+    target_ = target;
+    if(!hasTarget()) return;
+
+    // build the k-d tree once and tell ICP not to rebuild it on every align()
+    target_tree_->setInputCloud(target_);
+    icp_.setInputTarget(target_);
+    icp_.setSearchMethodTarget(target_tree_, true);
+}
+
+bool ScanMatcher::match(const ScanCloud::ConstPtr& source, const Eigen::Matrix4f& guess, Eigen::Matrix4f& result)
+{
+    if(!hasTarget() || source->empty()) return false;
+
+    icp_.setInputSource(source);
+    icp_.align(aligned_, guess);
+
+    fitness_score_ = icp_.getFitnessScore(params_.max_correspondence_distance);
+    if(!icp_.hasConverged() || fitness_score_ > params_.max_fitness_score) return false;
+
+    result = icp_.getFinalTransformation();
+    return true;
+}
+
+}
@@ -0,0 +1,138 @@
+#ifndef ROBOT_LINK_H
+#define ROBOT_LINK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+#include <boost/thread.hpp>
+
+namespace robot_link {
+
+/* Number of floats in one myRIO command (the old float data[24]) */
+const int COMMAND_SIZE = 24;
+
+/*
+ * Frame layout (little endian, packed), version 1:
+ *
+ *   off  size  field
+ *     0     2  magic     'R' 'L'
+ *     2     1  version   FRAME_VERSION
+ *     3     1  count     number of floats in the payload
+ *     4     4  sequence  incremented per frame sent, wraps
+ *     8     8  stamp_us  sender CLOCK_MONOTONIC [us] when the command was set
+ *    16  4*count payload
+ *   16+4*count  4  crc   CRC-32 (IEEE) of every byte before it
+ */
+const uint8_t FRAME_MAGIC0 = 'R';
+const uint8_t FRAME_MAGIC1 = 'L';
+const uint8_t FRAME_VERSION = 1;
+const size_t FRAME_HEADER_SIZE = 16;
+const size_t FRAME_CRC_SIZE = 4;
+const size_t FRAME_MAX_SIZE = FRAME_HEADER_SIZE + 4*255 + FRAME_CRC_SIZE;
+
+struct FrameHeader {
+    uint8_t version;
+    uint8_t count;
+    uint32_t sequence;
+    uint64_t stamp_us;
+};
+
+inline size_t frameSize(int count) { return FRAME_HEADER_SIZE + 4*count + FRAME_CRC_SIZE; }
+
+uint32_t crc32(const uint8_t* buf, size_t len);
+
+/* Monotonic clock [us], the clock of FrameHeader::stamp_us */
+uint64_t monotonicUs();
+
+/* Write one frame into out (frameSize(count) bytes), returns its size */
+size_t encodeFrame(const float* data, int count, uint32_t sequence, uint64_t stamp_us, uint8_t* out);
+
+/* Parse one frame from buf. Returns the frame size on success, 0 if more bytes
+ * are needed and -1 if buf does not start with a valid frame (bad magic,
+ * version or crc). At most max_count floats are copied to data. */
+int decodeFrame(const uint8_t* buf, size_t len, FrameHeader& header, float* data, int max_count);
+
+enum Transport {
+    TRANSPORT_TCP,
+    TRANSPORT_UDP
+};
+
+enum Framing {
+    FRAMING_RAW,    // bare float[count], what the current myRIO VI reads
+    FRAMING_V1      // versioned frame above
+};
+
+struct LinkConfig {
+    std::string host;
+    int port;
+    Transport transport;
+    Framing framing;
+    double rate_hz;     // send rate of the background thread
+
+    LinkConfig()
+        : host("172.16.0.1")
+        , port(4000)
+        , transport(TRANSPORT_TCP)
+        , framing(FRAMING_RAW)
+        , rate_hz(40) {}
+};
+
+/*
+ * Latest-value command sender.
+ * setCommand() only copies the command under a lock and never touches the
+ * socket, so the decision loop cannot be blocked by a stalled link. A
+ * background thread sends the newest command at rate_hz on a non-blocking
+ * socket (TCP_NODELAY on TCP); commands replaced before they were sent are
+ * dropped. A frame that was partly written is finished before the next one so
+ * the TCP stream never tears.
+ */
+class RobotLink {
+public:
+    explicit RobotLink(const LinkConfig& config = LinkConfig());
+    ~RobotLink();
+
+    /* Connect (blocking, like before) and start the sender thread.
+     * After the link died the old thread and socket are released first. */
+    bool open();
+    bool open(const LinkConfig& config);
+    const LinkConfig& config() const { return config_; }
+    void close();
+    /* False once the sender thread stopped, e.g. after a send error */
+    bool isOpen() const;
+
+    /* Stores the command; returns false if the link is down and it will not be sent */
+    bool setCommand(const float* data, int count = COMMAND_SIZE);
+
+    /* Counters for diagnostics */
+    uint32_t framesSent() const;
+    uint32_t commandsDropped() const;
+
+private:
+    void sendLoop();
+    bool flushPending();
+
+    LinkConfig config_;
+    int socket_;
+
+    mutable boost::mutex lock_;
+    float command_[255];
+    int command_count_;
+    uint64_t command_stamp_us_;
+    bool command_fresh_;
+    bool running_;
+    uint32_t frames_sent_;
+    uint32_t commands_dropped_;
+
+    boost::thread thread_;
+
+    // owned by the sender thread
+    uint32_t sequence_;
+    uint8_t pending_[FRAME_MAX_SIZE];
+    size_t pending_size_;
+    size_t pending_sent_;
+};
+
+}
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef ROBOT_LINK_ROS_CONFIG_H
+#define ROBOT_LINK_ROS_CONFIG_H
+
+#include <string>
+#include <ros/ros.h>
+
+#include "robot_link/robot_link.h"
+
+namespace robot_link {
+
+/* Read the link settings from private parameters, so every node can be switched
+ * the same way, e.g. `rosrun data_integrate main _myrio_framing:=v1`.
+ *   ~myrio_host, ~myrio_port, ~myrio_transport (tcp|udp),
+ *   ~myrio_framing (raw|v1), ~myrio_rate [Hz]  */
+inline LinkConfig loadLinkConfig(const LinkConfig& defaults = LinkConfig())
+{
+    ros::NodeHandle nh_private("~");
+    LinkConfig config = defaults;
+    std::string transport, framing;
+
+    nh_private.param<std::string>("myrio_host", config.host, defaults.host);
+    nh_private.param("myrio_port", config.port, defaults.port);
+    nh_private.param("myrio_rate", config.rate_hz, defaults.rate_hz);
+    nh_private.param<std::string>("myrio_transport", transport, defaults.transport == TRANSPORT_UDP ? "udp" : "tcp");
+    nh_private.param<std::string>("myrio_framing", framing, defaults.framing == FRAMING_V1 ? "v1" : "raw");
+
+    config.transport = (transport == "udp") ? TRANSPORT_UDP : TRANSPORT_TCP;
+    config.framing = (framing == "v1") ? FRAMING_V1 : FRAMING_RAW;
+    return config;
+}
+
+}
+
+#endif
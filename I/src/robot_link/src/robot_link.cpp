@@ -0,0 +1,315 @@
+#include "robot_link/robot_link.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+
+namespace robot_link {
+
+namespace {
+
+void putU32(uint8_t* p, uint32_t v)
+{
+    p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+}
+
+uint32_t getU32(const uint8_t* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+const uint32_t* crcTable()
+{
+    static uint32_t table[256];
+    static bool built = false;
+    if (!built) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+        built = true;
+    }
+    return table;
+}
+
+// make the table before any thread can race on it
+const uint32_t* crc_table_init = crcTable();
+
+void addNs(struct timespec& ts, long ns)
+{
+    ts.tv_nsec += ns;
+    while (ts.tv_nsec >= 1000000000L) {
+        ts.tv_nsec -= 1000000000L;
+        ts.tv_sec++;
+    }
+}
+
+}
+
+uint32_t crc32(const uint8_t* buf, size_t len)
+{
+    const uint32_t* table = crcTable();
+    uint32_t c = 0xFFFFFFFFu;
+    for (size_t i = 0; i < len; i++) c = table[(c ^ buf[i]) & 0xFF] ^ (c >> 8);
+    return c ^ 0xFFFFFFFFu;
+}
+
+uint64_t monotonicUs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + ts.tv_nsec / 1000;
+}
+
+size_t encodeFrame(const float* data, int count, uint32_t sequence, uint64_t stamp_us, uint8_t* out)
+{
+    out[0] = FRAME_MAGIC0;
+    out[1] = FRAME_MAGIC1;
+    out[2] = FRAME_VERSION;
+    out[3] = (uint8_t)count;
+    putU32(out + 4, sequence);
+    putU32(out + 8, (uint32_t)stamp_us);
+    putU32(out + 12, (uint32_t)(stamp_us >> 32));
+
+    uint8_t* p = out + FRAME_HEADER_SIZE;
+    for (int i = 0; i < count; i++, p += 4) {
+        uint32_t bits;
+        memcpy(&bits, &data[i], 4);
+        putU32(p, bits);
+    }
+    putU32(p, crc32(out, p - out));
+    return frameSize(count);
+}
+
+int decodeFrame(const uint8_t* buf, size_t len, FrameHeader& header, float* data, int max_count)
+{
+    if (len < FRAME_HEADER_SIZE) return 0;
+    if (buf[0] != FRAME_MAGIC0 || buf[1] != FRAME_MAGIC1 || buf[2] != FRAME_VERSION) return -1;
+
+    int count = buf[3];
+    size_t size = frameSize(count);
+    if (len < size) return 0;
+    if (crc32(buf, size - FRAME_CRC_SIZE) != getU32(buf + size - FRAME_CRC_SIZE)) return -1;
+
+    header.version = buf[2];
+    header.count = count;
+    header.sequence = getU32(buf + 4);
+    header.stamp_us = getU32(buf + 8) | ((uint64_t)getU32(buf + 12) << 32);
+
+    const uint8_t* p = buf + FRAME_HEADER_SIZE;
+    for (int i = 0; i < count && i < max_count; i++, p += 4) {
+        uint32_t bits = getU32(p);
+        memcpy(&data[i], &bits, 4);
+    }
+    return (int)size;
+}
+
+RobotLink::RobotLink(const LinkConfig& config)
+    : config_(config)
+    , socket_(-1)
+    , command_count_(0)
+    , command_stamp_us_(0)
+    , command_fresh_(false)
+    , running_(false)
+    , frames_sent_(0)
+    , commands_dropped_(0)
+    , sequence_(0)
+    , pending_size_(0)
+    , pending_sent_(0)
+{
+}
+
+RobotLink::~RobotLink()
+{
+    close();
+}
+
+bool RobotLink::open(const LinkConfig& config)
+{
+    if (isOpen()) return false;
+    config_ = config;
+    return open();
+}
+
+bool RobotLink::open()
+{
+    if (isOpen()) return true;
+    // a dead link still holds its exited thread and socket
+    close();
+
+    bool udp = config_.transport == TRANSPORT_UDP;
+    int fd = socket(PF_INET, udp ? SOCK_DGRAM : SOCK_STREAM, 0);
+    if (fd < 0) return false;
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = inet_addr(config_.host.c_str());
+    addr.sin_port = htons(config_.port);
+
+    // still a blocking connect, the nodes refuse to start without the myRIO
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == -1) {
+        ::close(fd);
+        return false;
+    }
+
+    if (!udp) {
+        // one small frame per tick: Nagle would only hold it back
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+    socket_ = fd;
+    pending_size_ = pending_sent_ = 0;
+    {
+        boost::mutex::scoped_lock guard(lock_);
+        running_ = true;
+    }
+    thread_ = boost::thread(&RobotLink::sendLoop, this);
+    return true;
+}
+
+void RobotLink::close()
+{
+    {
+        boost::mutex::scoped_lock guard(lock_);
+        running_ = false;
+    }
+    if (thread_.joinable()) thread_.join();
+
+    if (socket_ >= 0) {
+        ::close(socket_);
+        socket_ = -1;
+    }
+}
+
+bool RobotLink::isOpen() const
+{
+    boost::mutex::scoped_lock guard(lock_);
+    return running_;
+}
+
+bool RobotLink::setCommand(const float* data, int count)
+{
+    if (count > 255) count = 255;
+    if (count < 0) count = 0;
+
+    boost::mutex::scoped_lock guard(lock_);
+    if (command_fresh_) commands_dropped_++;
+    memcpy(command_, data, count * sizeof(float));
+    command_count_ = count;
+    command_stamp_us_ = monotonicUs();
+    command_fresh_ = true;
+    return running_;
+}
+
+uint32_t RobotLink::framesSent() const
+{
+    boost::mutex::scoped_lock guard(lock_);
+    return frames_sent_;
+}
+
+uint32_t RobotLink::commandsDropped() const
+{
+    boost::mutex::scoped_lock guard(lock_);
+    return commands_dropped_;
+}
+
+/* Push out what is left of the pending frame. Returns false on a dead link. */
+bool RobotLink::flushPending()
+{
+    while (pending_sent_ < pending_size_) {
+        ssize_t n = send(socket_, pending_ + pending_sent_, pending_size_ - pending_sent_, MSG_NOSIGNAL);
+        if (n >= 0) {
+            pending_sent_ += n;
+            continue;
+        }
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return true;
+
+        if (config_.transport == TRANSPORT_UDP) {
+            // nobody listening yet (ICMP refused); drop the datagram and keep sending
+            pending_sent_ = pending_size_;
+            return true;
+        }
+        fprintf(stderr, "(robot_link) send to %s:%d failed : %s\n", config_.host.c_str(), config_.port, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+void RobotLink::sendLoop()
+{
+    float command[255];
+    int count = 0;
+    uint64_t stamp_us = 0;
+
+    long period_ns = (long)(1e9 / (config_.rate_hz > 0 ? config_.rate_hz : 40));
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+
+    for (;;) {
+        bool stopping;
+        {
+            boost::mutex::scoped_lock guard(lock_);
+            // on close() a command set since the last tick still goes out once
+            stopping = !running_;
+            if (stopping && !command_fresh_) break;
+
+            // a stalled socket still holds part of the last frame: keep the newest command waiting
+            if (pending_sent_ >= pending_size_ && command_count_ > 0) {
+                memcpy(command, command_, command_count_ * sizeof(float));
+                count = command_count_;
+                stamp_us = command_stamp_us_;
+                command_fresh_ = false;
+            }
+        }
+
+        bool alive = flushPending();
+        if (alive && pending_sent_ >= pending_size_ && count > 0) {
+            // the latest command is sent every tick, as the old loop did
+            if (config_.framing == FRAMING_V1) {
+                pending_size_ = encodeFrame(command, count, sequence_++, stamp_us, pending_);
+            }
+            else {
+                memcpy(pending_, command, count * sizeof(float));
+                pending_size_ = count * sizeof(float);
+            }
+            pending_sent_ = 0;
+            alive = flushPending();
+
+            boost::mutex::scoped_lock guard(lock_);
+            frames_sent_++;
+        }
+
+        if (!alive) {
+            boost::mutex::scoped_lock guard(lock_);
+            running_ = false;
+            break;
+        }
+        if (stopping) break;
+
+        addNs(next, period_ns);
+        // fell behind (stalled socket, preemption): restart the schedule from now instead of
+        // sending a burst of catch-up frames
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (next.tv_sec < now.tv_sec || (next.tv_sec == now.tv_sec && next.tv_nsec < now.tv_nsec)) {
+            next = now;
+            addNs(next, period_ns);
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+    }
+}
+
+}
@@ -41,6 +41,12 @@
 
 namespace rp { namespace standalone{ namespace rplidar {
 
+typedef struct _rplidar_scan_info_t {
+    _u32  sequence;                 // revolution sequence number, increases by one per complete scan
+    _u64  first_node_timestamp_us;  // monotonic host receive time of the first node in the scan
+    _u64  last_node_timestamp_us;   // monotonic host receive time of the last node in the scan
+} rplidar_scan_info_t;
+
 class RPlidarDriver {
 public:
     enum {
@@ -188,6 +194,19 @@ public:
     /// \The caller application can set the timeout value to Zero(0) to make this interface always returns immediately to achieve non-block operation.
 	virtual u_result grabScanData(rplidar_response_measurement_node_t * nodebuffer, size_t & count, _u32 timeout = DEFAULT_TIMEOUT) = 0;
 
+    /// Wait and borrow the latest complete 0-360 degree scan data without copying it.
+    /// The returned scan has the same charactistics as the one returned by grabScanData.
+    ///
+    /// \param nodebuffer     Receives a pointer to the driver-owned scan data. It stays valid until the next call of borrowScanData or grabScanData.
+    ///
+    /// \param count          Receives the node count of the borrowed scan.
+    ///
+    /// \param info           Receives the revolution sequence number and the CLOCK_MONOTONIC receive time (in microsecond) of the first and last node.
+    ///                       A sequence gap larger than one between two calls means scans were skipped.
+    ///
+    /// \param timeout        Max duration allowed to wait for a complete scan data.
+    virtual u_result borrowScanData(const rplidar_response_measurement_node_t * & nodebuffer, size_t & count, rplidar_scan_info_t & info, _u32 timeout = DEFAULT_TIMEOUT) = 0;
+
     /// Ascending the scan data according to the angle value in the scan.
     ///
     /// \param nodebuffer     Buffer provided by the caller application to do the reorder. Should be retrived from the grabScanData
@@ -36,7 +36,7 @@
 
 
 namespace rp{ namespace arch{
-_u64 getus()
+_u64 rp_getus()
 {
     timeval now;
     gettimeofday(&now,NULL);
@@ -44,4 +44,5 @@ namespace rp{ namespace arch{
 }}
 
 #define getms()   rp::arch::getHDTimer()
+#define getus()   ((_u64)rp::arch::getHDTimer()*1000)
 
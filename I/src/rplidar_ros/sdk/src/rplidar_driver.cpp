@@ -73,7 +73,17 @@ RPlidarDriverSerialImpl::RPlidarDriverSerialImpl()
     , _isSupportingMotorCtrl(false)
 {
     _rxtx = rp::hal::serial_rxtx::CreateRxTx();
-    _cached_scan_node_count = 0;
+    _partial_node_pos = 0;
+    _byte_duration_ns = 0;
+    _scan_write_idx = 0;
+    _scan_ready_idx = 1;
+    _scan_read_idx = 2;
+    _scan_ready_fresh = false;
+    _scan_sequence = 0;
+    memset(_scan_node_count, 0, sizeof(_scan_node_count));
+    memset(_scan_node_seq, 0, sizeof(_scan_node_seq));
+    memset(_scan_first_ts, 0, sizeof(_scan_first_ts));
+    memset(_scan_last_ts, 0, sizeof(_scan_last_ts));
     _cached_sampleduration_std = LEGACY_SAMPLE_DURATION;
     _cached_sampleduration_express = LEGACY_SAMPLE_DURATION;
 }
@@ -103,6 +113,9 @@ u_result RPlidarDriverSerialImpl::connect(const char * port_path, _u32 baudrate,
         _rxtx->flush(0);
     }
 
+    // 8N1 framing: 10 bits on the wire per byte
+    _byte_duration_ns = (_u32)(10ULL*1000000000ULL/baudrate);
+
     _isConnected = true;
 
     checkMotorCtrlSupport(_isSupportingMotorCtrl);
@@ -261,6 +274,7 @@ u_result RPlidarDriverSerialImpl::startScanNormal(bool force, _u32 timeout)
         }
 
         _isScanning = true;
+        _partial_node_pos = 0;
         _cachethread = CLASS_THREAD(RPlidarDriverSerialImpl, _cacheScanData);
         if (_cachethread.getHandle() == 0) {
             return RESULT_OPERATION_FAIL;
@@ -371,17 +385,18 @@ u_result RPlidarDriverSerialImpl::stop(_u32 timeout)
 u_result RPlidarDriverSerialImpl::_cacheScanData()
 {
     rplidar_response_measurement_node_t      local_buf[128];
+    _u64                                     local_ts[128];
     size_t                                   count = 128;
-    rplidar_response_measurement_node_t      local_scan[MAX_SCAN_NODES];
     size_t                                   scan_count = 0;
     u_result                                 ans;
-    memset(local_scan, 0, sizeof(local_scan));
+    memset(_scan_node_buf[_scan_write_idx], 0, sizeof(_scan_node_buf[0]));
 
-    _waitScanData(local_buf, count); // // always discard the first data since it may be incomplete
+    _waitScanData(local_buf, count, local_ts); // // always discard the first data since it may be incomplete
 
     while(_isScanning)
     {
-        if (IS_FAIL(ans=_waitScanData(local_buf, count))) {
+        count = _countof(local_buf);
+        if (IS_FAIL(ans=_waitScanData(local_buf, count, local_ts))) {
             if (ans != RESULT_OPERATION_TIMEOUT) {
                 _isScanning = false;
                 return RESULT_OPERATION_FAIL;
@@ -390,27 +405,45 @@ u_result RPlidarDriverSerialImpl::_cacheScanData()
 
         for (size_t pos = 0; pos < count; ++pos)
         {
-            if (local_buf[pos].sync_quality & RPLIDAR_RESP_MEASUREMENT_SYNCBIT)
-            {
-                // only publish the data when it contains a full 360 degree scan 
-                
-                if ((local_scan[0].sync_quality & RPLIDAR_RESP_MEASUREMENT_SYNCBIT)) {
-                    _lock.lock();
-                    memcpy(_cached_scan_node_buf, local_scan, scan_count*sizeof(rplidar_response_measurement_node_t));
-                    _cached_scan_node_count = scan_count;
-                    _dataEvt.set();
-                    _lock.unlock();
-                }
-                scan_count = 0;
-            }
-            local_scan[scan_count++] = local_buf[pos];
-            if (scan_count == _countof(local_scan)) scan_count-=1; // prevent overflow
+            _cacheScanNode(local_buf[pos], local_ts[pos], scan_count);
         }
     }
     _isScanning = false;
     return RESULT_OK;
 }
 
+void RPlidarDriverSerialImpl::_cacheScanNode(const rplidar_response_measurement_node_t & node, _u64 timestamp_us, size_t & scan_count)
+{
+    rplidar_response_measurement_node_t * local_scan = _scan_node_buf[_scan_write_idx];
+
+    if (node.sync_quality & RPLIDAR_RESP_MEASUREMENT_SYNCBIT)
+    {
+        // only publish the data when it contains a full 360 degree scan 
+
+        if ((local_scan[0].sync_quality & RPLIDAR_RESP_MEASUREMENT_SYNCBIT)) {
+            _scan_node_count[_scan_write_idx] = scan_count;
+            _scan_node_seq[_scan_write_idx] = ++_scan_sequence;
+
+            // publish the filled back buffer by swapping indices, the nodes themselves are never copied
+            _scan_buf_lock.lock();
+            size_t ready_idx = _scan_ready_idx;
+            _scan_ready_idx = _scan_write_idx;
+            _scan_write_idx = ready_idx;
+            _scan_ready_fresh = true;
+            _dataEvt.set();
+            _scan_buf_lock.unlock();
+
+            local_scan = _scan_node_buf[_scan_write_idx];
+        }
+        scan_count = 0;
+    }
+    if (scan_count == 0) _scan_first_ts[_scan_write_idx] = timestamp_us;
+    _scan_last_ts[_scan_write_idx] = timestamp_us;
+
+    local_scan[scan_count++] = node;
+    if (scan_count == MAX_SCAN_NODES) scan_count-=1; // prevent overflow
+}
+
 void     RPlidarDriverSerialImpl::_capsuleToNormal(const rplidar_response_capsule_measurement_nodes_t & capsule, rplidar_response_measurement_node_t *nodebuffer, size_t &nodeCount)
 {
     nodeCount = 0;
@@ -476,12 +509,14 @@ u_result RPlidarDriverSerialImpl::_cacheCapsuledScanData()
     rplidar_response_capsule_measurement_nodes_t    capsule_node;
     rplidar_response_measurement_node_t      local_buf[128];
     size_t                                   count = 128;
-    rplidar_response_measurement_node_t      local_scan[MAX_SCAN_NODES];
+    _u64                                     capsule_ts;
+    _u64                                     prev_capsule_ts;
     size_t                                   scan_count = 0;
     u_result                                 ans;
-    memset(local_scan, 0, sizeof(local_scan));
+    memset(_scan_node_buf[_scan_write_idx], 0, sizeof(_scan_node_buf[0]));
 
     _waitCapsuledNode(capsule_node); // // always discard the first data since it may be incomplete
+    prev_capsule_ts = getus();
 
     while(_isScanning)
     {
@@ -495,26 +530,17 @@ u_result RPlidarDriverSerialImpl::_cacheCapsuledScanData()
             }
         }
 
+        capsule_ts = getus();
+
         _capsuleToNormal(capsule_node, local_buf, count);
 
+        // the decoded nodes were sampled between the previous capsule and this one
         for (size_t pos = 0; pos < count; ++pos)
         {
-            if (local_buf[pos].sync_quality & RPLIDAR_RESP_MEASUREMENT_SYNCBIT)
-            {
-                // only publish the data when it contains a full 360 degree scan 
-                
-                if ((local_scan[0].sync_quality & RPLIDAR_RESP_MEASUREMENT_SYNCBIT)) {
-                    _lock.lock();
-                    memcpy(_cached_scan_node_buf, local_scan, scan_count*sizeof(rplidar_response_measurement_node_t));
-                    _cached_scan_node_count = scan_count;
-                    _dataEvt.set();
-                    _lock.unlock();
-                }
-                scan_count = 0;
-            }
-            local_scan[scan_count++] = local_buf[pos];
-            if (scan_count == _countof(local_scan)) scan_count-=1; // prevent overflow
+            _u64 node_ts = prev_capsule_ts + (capsule_ts - prev_capsule_ts)*(pos+1)/count;
+            _cacheScanNode(local_buf[pos], node_ts, scan_count);
         }
+        prev_capsule_ts = capsule_ts;
     }
     _isScanning = false;
 
@@ -522,6 +548,25 @@ u_result RPlidarDriverSerialImpl::_cacheCapsuledScanData()
 }
 
 u_result RPlidarDriverSerialImpl::grabScanData(rplidar_response_measurement_node_t * nodebuffer, size_t & count, _u32 timeout)
+{
+    const rplidar_response_measurement_node_t * scanbuffer;
+    size_t   scan_count;
+    rplidar_scan_info_t info;
+    u_result ans;
+
+    if (IS_FAIL(ans = borrowScanData(scanbuffer, scan_count, info, timeout))) {
+        count = 0;
+        return ans;
+    }
+
+    size_t size_to_copy = min(count, scan_count);
+
+    memcpy(nodebuffer, scanbuffer, size_to_copy*sizeof(rplidar_response_measurement_node_t));
+    count = size_to_copy;
+    return RESULT_OK;
+}
+
+u_result RPlidarDriverSerialImpl::borrowScanData(const rplidar_response_measurement_node_t * & nodebuffer, size_t & count, rplidar_scan_info_t & info, _u32 timeout)
 {
     switch (_dataEvt.wait(timeout))
     {
@@ -530,15 +575,23 @@ u_result RPlidarDriverSerialImpl::grabScanData(rplidar_response_measurement_node
         return RESULT_OPERATION_TIMEOUT;
     case rp::hal::Event::EVENT_OK:
         {
-            if(_cached_scan_node_count == 0) return RESULT_OPERATION_TIMEOUT; //consider as timeout
+            {
+                rp::hal::AutoLocker l(_scan_buf_lock);
 
-            rp::hal::AutoLocker l(_lock);
+                if (!_scan_ready_fresh) return RESULT_OPERATION_TIMEOUT; //consider as timeout
 
-            size_t size_to_copy = min(count, _cached_scan_node_count);
+                size_t read_idx = _scan_read_idx;
+                _scan_read_idx = _scan_ready_idx;
+                _scan_ready_idx = read_idx;
+                _scan_ready_fresh = false;
+            }
 
-            memcpy(nodebuffer, _cached_scan_node_buf, size_to_copy*sizeof(rplidar_response_measurement_node_t));
-            count = size_to_copy;
-            _cached_scan_node_count = 0;
+            // the front buffer is owned by the caller until the next borrow/grab call
+            nodebuffer = _scan_node_buf[_scan_read_idx];
+            count = _scan_node_count[_scan_read_idx];
+            info.sequence = _scan_node_seq[_scan_read_idx];
+            info.first_node_timestamp_us = _scan_first_ts[_scan_read_idx];
+            info.last_node_timestamp_us = _scan_last_ts[_scan_read_idx];
         }
         return RESULT_OK;
 
@@ -600,79 +653,89 @@ u_result RPlidarDriverSerialImpl::ascendScanData(rplidar_response_measurement_no
     }
 
     // Reorder the scan according to the angle value
-    for (i = 0; i < (count-1); i++){
-        for (size_t j = (i+1); j < count; j++){
-            if(nodebuffer[i].angle_q6_checkbit > nodebuffer[j].angle_q6_checkbit){
-                rplidar_response_measurement_node_t temp = nodebuffer[i];
-                nodebuffer[i] = nodebuffer[j];
-                nodebuffer[j] = temp;
-            }
-        }
+    // (two-pass LSD radix sort over the 16-bit angle_q6_checkbit field, linear in count)
+    rplidar_response_measurement_node_t   local_buf[MAX_SCAN_NODES];
+    rplidar_response_measurement_node_t * tmpbuffer = local_buf;
+    if (count > _countof(local_buf)) {
+        tmpbuffer = new rplidar_response_measurement_node_t[count];
+    }
+
+    _radixPassByAngle(nodebuffer, tmpbuffer, count, 0);
+    _radixPassByAngle(tmpbuffer, nodebuffer, count, 8);
+
+    if (tmpbuffer != local_buf) {
+        delete [] tmpbuffer;
     }
 
     return RESULT_OK;
 }
 
-u_result RPlidarDriverSerialImpl::_waitNode(rplidar_response_measurement_node_t * node, _u32 timeout)
+void RPlidarDriverSerialImpl::_radixPassByAngle(const rplidar_response_measurement_node_t * src, rplidar_response_measurement_node_t * dest, size_t count, int shift)
 {
-    int  recvPos = 0;
-    _u32 startTs = getms();
-    _u8  recvBuffer[sizeof(rplidar_response_measurement_node_t)];
-    _u8 *nodeBuffer = (_u8*)node;
-    _u32 waitTime;
+    size_t bucket_pos[256];
+    memset(bucket_pos, 0, sizeof(bucket_pos));
 
-   while ((waitTime=getms() - startTs) <= timeout) {
-        size_t remainSize = sizeof(rplidar_response_measurement_node_t) - recvPos;
-        size_t recvSize;
+    for (size_t pos = 0; pos < count; ++pos) {
+        ++bucket_pos[(src[pos].angle_q6_checkbit >> shift) & 0xFF];
+    }
 
-        int ans = _rxtx->waitfordata(remainSize, timeout-waitTime, &recvSize);
-        if (ans == rp::hal::serial_rxtx::ANS_DEV_ERR) 
-            return RESULT_OPERATION_FAIL;
-        else if (ans == rp::hal::serial_rxtx::ANS_TIMEOUT)
-            return RESULT_OPERATION_TIMEOUT;
+    size_t offset = 0;
+    for (size_t bucket = 0; bucket < _countof(bucket_pos); ++bucket) {
+        size_t bucket_size = bucket_pos[bucket];
+        bucket_pos[bucket] = offset;
+        offset += bucket_size;
+    }
 
-        if (recvSize > remainSize) recvSize = remainSize;
-        
-        _rxtx->recvdata(recvBuffer, recvSize);
+    // stable scatter keeps the nodes that share an angle in their scan order
+    for (size_t pos = 0; pos < count; ++pos) {
+        dest[bucket_pos[(src[pos].angle_q6_checkbit >> shift) & 0xFF]++] = src[pos];
+    }
+}
 
-        for (size_t pos = 0; pos < recvSize; ++pos) {
-            _u8 currentByte = recvBuffer[pos];
-            switch (recvPos) {
-            case 0: // expect the sync bit and its reverse in this byte
-                {
-                    _u8 tmp = (currentByte>>1);
-                    if ( (tmp ^ currentByte) & 0x1 ) {
-                        // pass
-                    } else {
-                        continue;
-                    }
+size_t RPlidarDriverSerialImpl::_decodeNodes(const _u8 * data, size_t size, _u64 tail_ts_us, rplidar_response_measurement_node_t * nodebuffer, _u64 * timestampbuffer, size_t maxcount)
+{
+    _u8 *  nodeBuffer = (_u8*)&_partial_node;
+    size_t nodeCount = 0;
 
+    for (size_t pos = 0; pos < size && nodeCount < maxcount; ++pos) {
+        _u8 currentByte = data[pos];
+        switch (_partial_node_pos) {
+        case 0: // expect the sync bit and its reverse in this byte
+            {
+                _u8 tmp = (currentByte>>1);
+                if ( (tmp ^ currentByte) & 0x1 ) {
+                    // pass
+                } else {
+                    continue;
                 }
-                break;
-            case 1: // expect the highest bit to be 1
-                {
-                    if (currentByte & RPLIDAR_RESP_MEASUREMENT_CHECKBIT) {
-                        // pass
-                    } else {
-                        recvPos = 0;
-                        continue;
-                    }
+
+            }
+            break;
+        case 1: // expect the highest bit to be 1
+            {
+                if (currentByte & RPLIDAR_RESP_MEASUREMENT_CHECKBIT) {
+                    // pass
+                } else {
+                    _partial_node_pos = 0;
+                    continue;
                 }
-                break;
             }
-            nodeBuffer[recvPos++] = currentByte;
+            break;
+        }
+        nodeBuffer[_partial_node_pos++] = currentByte;
 
-            if (recvPos == sizeof(rplidar_response_measurement_node_t)) {
-                return RESULT_OK;
-            }
+        if (_partial_node_pos == sizeof(rplidar_response_measurement_node_t)) {
+            // a node is complete when its last byte arrived, i.e. (size-1-pos) bytes before the tail
+            if (timestampbuffer) timestampbuffer[nodeCount] = tail_ts_us - (_u64)(size-1-pos)*_byte_duration_ns/1000;
+            nodebuffer[nodeCount++] = _partial_node;
+            _partial_node_pos = 0;
         }
     }
-
-    return RESULT_OPERATION_TIMEOUT;
+    return nodeCount;
 }
 
 
-u_result RPlidarDriverSerialImpl::_waitScanData(rplidar_response_measurement_node_t * nodebuffer, size_t & count, _u32 timeout)
+u_result RPlidarDriverSerialImpl::_waitScanData(rplidar_response_measurement_node_t * nodebuffer, size_t & count, _u64 * timestampbuffer, _u32 timeout)
 {
     if (!_isConnected) {
         count = 0;
@@ -682,15 +745,34 @@ u_result RPlidarDriverSerialImpl::_waitScanData(rplidar_response_measurement_nod
     size_t   recvNodeCount =  0;
     _u32     startTs = getms();
     _u32     waitTime;
-    u_result ans;
+    _u8      recvBuffer[128*sizeof(rplidar_response_measurement_node_t)];
 
     while ((waitTime = getms() - startTs) <= timeout && recvNodeCount < count) {
-        rplidar_response_measurement_node_t node;
-        if (IS_FAIL(ans = _waitNode(&node, timeout - waitTime))) {
-            return ans;
+        // never pull more bytes than the remaining nodes can hold, so no decoded node is dropped
+        size_t remainSize = (count - recvNodeCount)*sizeof(rplidar_response_measurement_node_t) - _partial_node_pos;
+        if (remainSize > sizeof(recvBuffer)) remainSize = sizeof(recvBuffer);
+        size_t recvSize;
+
+        int ans = _rxtx->waitfordata(remainSize, timeout-waitTime, &recvSize);
+        if (ans == rp::hal::serial_rxtx::ANS_DEV_ERR) {
+            count = recvNodeCount;
+            return RESULT_OPERATION_FAIL;
+        } else if (ans == rp::hal::serial_rxtx::ANS_TIMEOUT) {
+            count = recvNodeCount;
+            return RESULT_OPERATION_TIMEOUT;
         }
-        
-        nodebuffer[recvNodeCount++] = node;
+
+        size_t queuedSize = recvSize;
+        if (recvSize > remainSize) recvSize = remainSize;
+
+        recvSize = _rxtx->recvdata(recvBuffer, recvSize);
+
+        // bytes left in the rx queue arrived after the last byte we just read
+        _u64 tail_ts_us = getus();
+        if (queuedSize > recvSize) tail_ts_us -= (_u64)(queuedSize - recvSize)*_byte_duration_ns/1000;
+
+        recvNodeCount += _decodeNodes(recvBuffer, recvSize, tail_ts_us, nodebuffer + recvNodeCount,
+                                      timestampbuffer ? timestampbuffer + recvNodeCount : NULL, count - recvNodeCount);
 
         if (recvNodeCount == count) return RESULT_OK;
     }
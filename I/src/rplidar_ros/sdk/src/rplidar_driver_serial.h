@@ -75,12 +75,14 @@ public:
 
     virtual u_result stop(_u32 timeout = DEFAULT_TIMEOUT);
     virtual u_result grabScanData(rplidar_response_measurement_node_t * nodebuffer, size_t & count, _u32 timeout = DEFAULT_TIMEOUT);
+    virtual u_result borrowScanData(const rplidar_response_measurement_node_t * & nodebuffer, size_t & count, rplidar_scan_info_t & info, _u32 timeout = DEFAULT_TIMEOUT);
     virtual u_result ascendScanData(rplidar_response_measurement_node_t * nodebuffer, size_t count);
 
 protected:
-    u_result _waitNode(rplidar_response_measurement_node_t * node, _u32 timeout = DEFAULT_TIMEOUT);
-    u_result _waitScanData(rplidar_response_measurement_node_t * nodebuffer, size_t & count, _u32 timeout = DEFAULT_TIMEOUT);
+    size_t   _decodeNodes(const _u8 * data, size_t size, _u64 tail_ts_us, rplidar_response_measurement_node_t * nodebuffer, _u64 * timestampbuffer, size_t maxcount);
+    u_result _waitScanData(rplidar_response_measurement_node_t * nodebuffer, size_t & count, _u64 * timestampbuffer = NULL, _u32 timeout = DEFAULT_TIMEOUT);
 	u_result _cacheScanData();
+    void     _cacheScanNode(const rplidar_response_measurement_node_t & node, _u64 timestamp_us, size_t & scan_count);
     void     _capsuleToNormal(const rplidar_response_capsule_measurement_nodes_t & capsule, rplidar_response_measurement_node_t *nodebuffer, size_t &nodeCount);
     u_result _waitCapsuledNode(rplidar_response_capsule_measurement_nodes_t & node, _u32 timeout = DEFAULT_TIMEOUT);
     u_result  _cacheCapsuledScanData();
@@ -89,6 +91,7 @@ protected:
     u_result _waitSampleRate(rplidar_response_sample_rate_t * res, _u32 timeout = DEFAULT_TIMEOUT);
 
     void     _disableDataGrabbing();
+    static void _radixPassByAngle(const rplidar_response_measurement_node_t * src, rplidar_response_measurement_node_t * dest, size_t count, int shift);
 
     bool     _isConnected;
     bool     _isScanning;
@@ -97,8 +100,23 @@ protected:
 	rp::hal::Locker         _lock;
     rp::hal::Event          _dataEvt;
     rp::hal::serial_rxtx  * _rxtx;
-    rplidar_response_measurement_node_t      _cached_scan_node_buf[2048];
-    size_t                                   _cached_scan_node_count;
+    // triple buffer: the cache thread fills [_scan_write_idx], the latest full scan waits in
+    // [_scan_ready_idx] and the caller reads [_scan_read_idx]; _scan_buf_lock guards the index swap only
+    rp::hal::Locker                          _scan_buf_lock;
+    rplidar_response_measurement_node_t      _scan_node_buf[3][MAX_SCAN_NODES];
+    size_t                                   _scan_node_count[3];
+    _u32                                     _scan_node_seq[3];
+    _u64                                     _scan_first_ts[3];
+    _u64                                     _scan_last_ts[3];
+    size_t                                   _scan_write_idx;
+    size_t                                   _scan_ready_idx;
+    size_t                                   _scan_read_idx;
+    bool                                     _scan_ready_fresh;
+    _u32                                     _scan_sequence;
+
+    rplidar_response_measurement_node_t      _partial_node;
+    size_t                                   _partial_node_pos;
+    _u32                                     _byte_duration_ns;
 
     _u16                    _cached_sampleduration_std;
     _u16                    _cached_sampleduration_express;
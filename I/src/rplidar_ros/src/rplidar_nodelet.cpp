@@ -0,0 +1,86 @@
+/*
+ *  RPLIDAR ROS NODELET
+ *
+ *  Copyright (c) 2009 - 2014 RoboPeak Team
+ *  http://www.robopeak.com
+ *  Copyright (c) 2014 - 2016 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <boost/thread.hpp>
+#include <nodelet/nodelet.h>
+#include <pluginlib/class_list_macros.h>
+
+#include "rplidar_scan_publisher.h"
+
+namespace rplidar_ros {
+
+/// Runs the scan publisher inside a nodelet manager so that in-process
+/// subscribers receive the pooled LaserScan by pointer, without serialization.
+class RPlidarNodelet : public nodelet::Nodelet
+{
+public:
+    RPlidarNodelet() : running_(false) {}
+
+    ~RPlidarNodelet()
+    {
+        running_ = false;
+        if (grab_thread_) grab_thread_->join();
+    }
+
+private:
+    virtual void onInit()
+    {
+        NODELET_INFO("Initializing RPLIDAR Nodelet");
+
+        scan_publisher_.reset(new RPlidarScanPublisher(getMTNodeHandle(), getMTPrivateNodeHandle()));
+        if (!scan_publisher_->start()) {
+            NODELET_ERROR("RPLIDAR nodelet failed to start");
+            return;
+        }
+
+        running_ = true;
+        grab_thread_.reset(new boost::thread(boost::bind(&RPlidarNodelet::grabLoop, this)));
+    }
+
+    void grabLoop()
+    {
+        while (running_ && ros::ok()) {
+            scan_publisher_->grabAndPublish();
+        }
+        scan_publisher_->stop();
+    }
+
+    volatile bool running_;
+    boost::shared_ptr<RPlidarScanPublisher> scan_publisher_;
+    boost::shared_ptr<boost::thread> grab_thread_;
+};
+
+}
+
+PLUGINLIB_EXPORT_CLASS(rplidar_ros::RPlidarNodelet, nodelet::Nodelet)
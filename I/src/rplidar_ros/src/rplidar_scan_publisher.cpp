@@ -0,0 +1,440 @@
+/*
+ *  RPLIDAR ROS SCAN PUBLISHER
+ *
+ *  Copyright (c) 2009 - 2014 RoboPeak Team
+ *  http://www.robopeak.com
+ *  Copyright (c) 2014 - 2016 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include "rplidar_scan_publisher.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <time.h>
+
+#ifndef _countof
+#define _countof(_Array) (int)(sizeof(_Array) / sizeof(_Array[0]))
+#endif
+
+#define DEG2RAD(x) ((x)*M_PI/180.)
+
+using namespace rp::standalone::rplidar;
+
+namespace rplidar_ros {
+
+static ros::Time monotonicToRosTime(_u64 timestamp_us)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double now_us = now.tv_sec*1e6 + now.tv_nsec*1e-3;
+    return ros::Time::now() - ros::Duration((now_us - (double)timestamp_us)*1e-6);
+}
+
+// The nodes are packed 5 byte records, which the vectoriser cannot load; they are
+// unpacked in one plain pass and all the arithmetic is done on the float arrays.
+static void unpackNodes(const rplidar_response_measurement_node_t *nodes, size_t node_count,
+                        float *distances_q2, float *intensities)
+{
+    for (size_t i = 0; i < node_count; i++) {
+        distances_q2[i] = (float) nodes[i].distance_q2;
+        intensities[i] = (float) (nodes[i].sync_quality >> 2);
+    }
+}
+
+// q2 millimetres to metres in place, 0 to +inf. The select is a bit mask rather
+// than a branch or ternary, so that the loop vectorises.
+static void scaleRanges(float *ranges, size_t count)
+{
+    const _u32 inf_bits = 0x7f800000u;  // IEEE 754 +inf
+    for (size_t i = 0; i < count; i++) {
+        float read_value = ranges[i] * (1.0f/4.0f/1000.0f);
+        _u32 bits;
+        memcpy(&bits, &read_value, sizeof(bits));
+        _u32 no_return = (_u32)0 - (_u32)(ranges[i] == 0.0f);
+        bits = (bits & ~no_return) | (inf_bits & no_return);
+        memcpy(&ranges[i], &bits, sizeof(bits));
+    }
+}
+
+void convertRanges(const rplidar_response_measurement_node_t *nodes, size_t node_count,
+                   bool reverse, float *ranges, float *intensities)
+{
+    unpackNodes(nodes, node_count, ranges, intensities);
+    scaleRanges(ranges, node_count);
+    if (reverse) {
+        std::reverse(ranges, ranges + node_count);
+        std::reverse(intensities, intensities + node_count);
+    }
+}
+
+RPlidarScanPublisher::RPlidarScanPublisher(ros::NodeHandle & nh, ros::NodeHandle & nh_private)
+    : nh_(nh)
+    , serial_baudrate_(115200)
+    , inverted_(false)
+    , angle_compensate_(true)
+    , angle_compensate_resolution_(1.0)
+    , angle_compensate_min_range_(false)
+    , drv_(NULL)
+    , last_scan_sequence_(0)
+    , scan_msg_next_(0)
+{
+    nh_private.param<std::string>("serial_port", serial_port_, "/dev/ttyUSB0");
+    nh_private.param<int>("serial_baudrate", serial_baudrate_, 115200);
+    nh_private.param<std::string>("frame_id", frame_id_, "laser_frame");
+    nh_private.param<bool>("inverted", inverted_, false);
+    nh_private.param<bool>("angle_compensate", angle_compensate_, true);
+    nh_private.param<double>("angle_compensate_resolution", angle_compensate_resolution_, 1.0);
+
+    std::string angle_compensate_policy;
+    nh_private.param<std::string>("angle_compensate_policy", angle_compensate_policy, "nearest");
+    if (angle_compensate_policy == "min") {
+        angle_compensate_min_range_ = true;
+    } else if (angle_compensate_policy != "nearest") {
+        ROS_WARN("rplidar: unknown angle_compensate_policy '%s', using 'nearest'", angle_compensate_policy.c_str());
+    }
+
+    if (angle_compensate_resolution_ < 0.25 || angle_compensate_resolution_ > 1.0) {
+        ROS_WARN("rplidar: angle_compensate_resolution %.3f out of [0.25, 1], clamped", angle_compensate_resolution_);
+        angle_compensate_resolution_ = std::max(0.25, std::min(1.0, angle_compensate_resolution_));
+    }
+    buildAngleCompensateLut();
+
+    for (size_t i = 0; i < SCAN_MSG_POOL_SIZE; i++) {
+        scan_msg_pool_[i].reset(new sensor_msgs::LaserScan);
+    }
+}
+
+RPlidarScanPublisher::~RPlidarScanPublisher()
+{
+    stop();
+}
+
+bool RPlidarScanPublisher::start()
+{
+    printf("RPLIDAR running on ROS package rplidar_ros\n"
+           "SDK Version: " RPLIDAR_SDK_VERSION "\n");
+
+    // create the driver instance
+    drv_ = RPlidarDriver::CreateDriver(RPlidarDriver::DRIVER_TYPE_SERIALPORT);
+
+    if (!drv_) {
+        fprintf(stderr, "Create Driver fail, exit\n");
+        return false;
+    }
+
+    // make connection...
+    if (IS_FAIL(drv_->connect(serial_port_.c_str(), (_u32)serial_baudrate_))) {
+        fprintf(stderr, "Error, cannot bind to the specified serial port %s.\n"
+            , serial_port_.c_str());
+        RPlidarDriver::DisposeDriver(drv_);
+        drv_ = NULL;
+        return false;
+    }
+
+    // get rplidar device info
+    if (!getDeviceInfo()) {
+        return false;
+    }
+
+    // check health...
+    if (!checkHealth()) {
+        RPlidarDriver::DisposeDriver(drv_);
+        drv_ = NULL;
+        return false;
+    }
+
+    scan_pub_ = nh_.advertise<sensor_msgs::LaserScan>("scan", 1000);
+    stop_motor_service_ = nh_.advertiseService("stop_motor", &RPlidarScanPublisher::stopMotor, this);
+    start_motor_service_ = nh_.advertiseService("start_motor", &RPlidarScanPublisher::startMotor, this);
+
+    drv_->startMotor();
+    drv_->startScan();
+    return true;
+}
+
+void RPlidarScanPublisher::stop()
+{
+    if (!drv_) return;
+
+    // done!
+    drv_->stop();
+    drv_->stopMotor();
+    RPlidarDriver::DisposeDriver(drv_);
+    drv_ = NULL;
+}
+
+bool RPlidarScanPublisher::getDeviceInfo()
+{
+    u_result     op_result;
+    rplidar_response_device_info_t devinfo;
+
+    op_result = drv_->getDeviceInfo(devinfo);
+    if (IS_FAIL(op_result)) {
+        if (op_result == RESULT_OPERATION_TIMEOUT) {
+            fprintf(stderr, "Error, operation time out.\n");
+        } else {
+            fprintf(stderr, "Error, unexpected error, code: %x\n", op_result);
+        }
+        return false;
+    }
+
+    // print out the device serial number, firmware and hardware version number..
+    printf("RPLIDAR S/N: ");
+    for (int pos = 0; pos < 16 ;++pos) {
+        printf("%02X", devinfo.serialnum[pos]);
+    }
+
+    printf("\n"
+           "Firmware Ver: %d.%02d\n"
+           "Hardware Rev: %d\n"
+           , devinfo.firmware_version>>8
+           , devinfo.firmware_version & 0xFF
+           , (int)devinfo.hardware_version);
+    return true;
+}
+
+bool RPlidarScanPublisher::checkHealth()
+{
+    u_result     op_result;
+    rplidar_response_device_health_t healthinfo;
+
+    op_result = drv_->getHealth(healthinfo);
+    if (IS_OK(op_result)) { 
+        printf("RPLidar health status : %d\n", healthinfo.status);
+        
+        if (healthinfo.status == RPLIDAR_STATUS_ERROR) {
+            fprintf(stderr, "Error, rplidar internal error detected."
+                            "Please reboot the device to retry.\n");
+            return false;
+        } else {
+            return true;
+        }
+
+    } else {
+        fprintf(stderr, "Error, cannot retrieve rplidar health code: %x\n", 
+                        op_result);
+        return false;
+    }
+}
+
+bool RPlidarScanPublisher::stopMotor(std_srvs::Empty::Request &req,
+                                     std_srvs::Empty::Response &res)
+{
+  if(!drv_)
+       return false;
+
+  ROS_DEBUG("Stop motor");
+  drv_->stop();
+  drv_->stopMotor();
+  return true;
+}
+
+bool RPlidarScanPublisher::startMotor(std_srvs::Empty::Request &req,
+                                      std_srvs::Empty::Response &res)
+{
+  if(!drv_)
+       return false;
+  ROS_DEBUG("Start motor");
+  drv_->startMotor();
+  drv_->startScan();
+  return true;
+}
+
+void RPlidarScanPublisher::buildAngleCompensateLut()
+{
+    const int full_circle_q6 = 360 << 6;
+    const int bins = (int)(360.0 / angle_compensate_resolution_ + 0.5);
+
+    angle_compensate_nodes_.resize(bins);
+    angle_compensate_bin_err_.resize(bins);
+
+    // the angle field is 15 bits wide, cover all of it so a corrupt node cannot index past the table
+    angle_bin_lut_.resize(1 << 15);
+    angle_bin_err_lut_.resize(1 << 15);
+    for (int angle_q6 = 0; angle_q6 < (int)angle_bin_lut_.size(); angle_q6++) {
+        int wrapped_q6 = angle_q6 % full_circle_q6;
+        int bin = (int)(((long long)wrapped_q6 * bins + full_circle_q6 / 2) / full_circle_q6);
+        int err_q6 = std::abs(wrapped_q6 - (int)((long long)bin * full_circle_q6 / bins));
+        angle_bin_lut_[angle_q6] = (_u16)(bin % bins);
+        angle_bin_err_lut_[angle_q6] = (_u16)err_q6;
+    }
+}
+
+size_t RPlidarScanPublisher::compensateAngles(const rplidar_response_measurement_node_t *nodes, size_t count)
+{
+    const size_t bins = angle_compensate_nodes_.size();
+    rplidar_response_measurement_node_t *bin_nodes = &angle_compensate_nodes_[0];
+    _u16 *bin_err = &angle_compensate_bin_err_[0];
+
+    memset(bin_nodes, 0, bins*sizeof(rplidar_response_measurement_node_t));
+
+    for (size_t i = 0; i < count; i++) {
+        if (nodes[i].distance_q2 == 0) continue;
+
+        _u16 angle_q6 = nodes[i].angle_q6_checkbit >> RPLIDAR_RESP_MEASUREMENT_ANGLE_SHIFT;
+        _u16 bin = angle_bin_lut_[angle_q6];
+        _u16 err = angle_bin_err_lut_[angle_q6];
+
+        // keep either the closest return or the sample nearest to the bin angle
+        bool take;
+        if (bin_nodes[bin].distance_q2 == 0) {
+            take = true;
+        } else if (angle_compensate_min_range_) {
+            take = nodes[i].distance_q2 < bin_nodes[bin].distance_q2;
+        } else {
+            take = err < bin_err[bin];
+        }
+
+        if (take) {
+            bin_nodes[bin] = nodes[i];
+            bin_err[bin] = err;
+        }
+    }
+    return bins;
+}
+
+sensor_msgs::LaserScanPtr RPlidarScanPublisher::acquireScanMsg()
+{
+    for (size_t i = 0; i < SCAN_MSG_POOL_SIZE; i++) {
+        size_t slot = (scan_msg_next_ + i) % SCAN_MSG_POOL_SIZE;
+        if (scan_msg_pool_[slot].unique()) {
+            scan_msg_next_ = (slot + 1) % SCAN_MSG_POOL_SIZE;
+            return scan_msg_pool_[slot];
+        }
+    }
+
+    // every pooled message is still held by a subscriber or the publish queue,
+    // hand the oldest slot a fresh message and leave the old one to its holders
+    size_t slot = scan_msg_next_;
+    scan_msg_pool_[slot].reset(new sensor_msgs::LaserScan);
+    scan_msg_next_ = (slot + 1) % SCAN_MSG_POOL_SIZE;
+    return scan_msg_pool_[slot];
+}
+
+void RPlidarScanPublisher::publishScan(const rplidar_response_measurement_node_t *nodes,
+                                       size_t node_count, ros::Time start, double scan_time,
+                                       float angle_min, float angle_max)
+{
+    sensor_msgs::LaserScanPtr scan_msg = acquireScanMsg();
+
+    scan_msg->header.stamp = start;
+    scan_msg->header.frame_id = frame_id_;
+
+    bool reversed = (angle_max > angle_min);
+    if ( reversed ) {
+      scan_msg->angle_min =  M_PI - angle_max;
+      scan_msg->angle_max =  M_PI - angle_min;
+    } else {
+      scan_msg->angle_min =  M_PI - angle_min;
+      scan_msg->angle_max =  M_PI - angle_max;
+    }
+    scan_msg->angle_increment =
+        (scan_msg->angle_max - scan_msg->angle_min) / (double)(node_count-1);
+
+    scan_msg->scan_time = scan_time;
+    scan_msg->time_increment = scan_time / (double)(node_count-1);
+    scan_msg->range_min = 0.15;
+    scan_msg->range_max = 8.0;
+
+    // resize() keeps the capacity of a recycled message, so steady state does not allocate
+    scan_msg->intensities.resize(node_count);
+    scan_msg->ranges.resize(node_count);
+    bool reverse_data = (!inverted_ && reversed) || (inverted_ && !reversed);
+    if (node_count) {
+        convertRanges(nodes, node_count, reverse_data,
+                      &scan_msg->ranges[0], &scan_msg->intensities[0]);
+    }
+
+    scan_pub_.publish(scan_msg);
+}
+
+bool RPlidarScanPublisher::grabAndPublish()
+{
+    u_result     op_result;
+    const rplidar_response_measurement_node_t * scan_nodes;
+    size_t   count;
+    rplidar_scan_info_t scan_info;
+
+    op_result = drv_->borrowScanData(scan_nodes, count, scan_info);
+    if (op_result != RESULT_OK) return false;
+
+    if (last_scan_sequence_ != 0 && scan_info.sequence - last_scan_sequence_ > 1) {
+        ROS_WARN("rplidar: missed %u scan(s)", scan_info.sequence - last_scan_sequence_ - 1);
+    }
+    last_scan_sequence_ = scan_info.sequence;
+
+    // stamp with the receive time of the first node, not the time grabbing returned
+    ros::Time start_scan_time = monotonicToRosTime(scan_info.first_node_timestamp_us);
+    double scan_duration = (scan_info.last_node_timestamp_us - scan_info.first_node_timestamp_us) * 1e-6;
+
+    // ascendScanData reorders in place, so take a private copy of the borrowed scan
+    if (count > _countof(nodes_)) count = _countof(nodes_);
+    memcpy(nodes_, scan_nodes, count*sizeof(rplidar_response_measurement_node_t));
+    rplidar_response_measurement_node_t *nodes = nodes_;
+
+    op_result = drv_->ascendScanData(nodes, count);
+
+    float angle_min = DEG2RAD(0.0f);
+    float angle_max = DEG2RAD(359.0f);
+    if (op_result == RESULT_OK) {
+        if (angle_compensate_) {
+            size_t angle_compensate_nodes_count = compensateAngles(nodes, count);
+            angle_max = DEG2RAD(360.0f - (float)angle_compensate_resolution_);
+
+            publishScan(&angle_compensate_nodes_[0], angle_compensate_nodes_count,
+                        start_scan_time, scan_duration,
+                        angle_min, angle_max);
+        } else {
+            int start_node = 0, end_node = 0;
+            int i = 0;
+            // find the first valid node and last valid node
+            while (nodes[i++].distance_q2 == 0);
+            start_node = i-1;
+            i = count -1;
+            while (nodes[i--].distance_q2 == 0);
+            end_node = i+1;
+
+            angle_min = DEG2RAD((float)(nodes[start_node].angle_q6_checkbit >> RPLIDAR_RESP_MEASUREMENT_ANGLE_SHIFT)/64.0f);
+            angle_max = DEG2RAD((float)(nodes[end_node].angle_q6_checkbit >> RPLIDAR_RESP_MEASUREMENT_ANGLE_SHIFT)/64.0f);
+
+            publishScan(&nodes[start_node], end_node-start_node +1,
+                        start_scan_time, scan_duration,
+                        angle_min, angle_max);
+       }
+    } else if (op_result == RESULT_OPERATION_FAIL) {
+        // All the data is invalid, just publish them
+        publishScan(nodes, count,
+                    start_scan_time, scan_duration,
+                    angle_min, angle_max);
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,119 @@
+/*
+ *  RPLIDAR ROS SCAN PUBLISHER
+ *
+ *  Copyright (c) 2009 - 2014 RoboPeak Team
+ *  http://www.robopeak.com
+ *  Copyright (c) 2014 - 2016 Shanghai Slamtec Co., Ltd.
+ *  http://www.slamtec.com
+ *
+ */
+/*
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#pragma once
+
+#include "ros/ros.h"
+#include "sensor_msgs/LaserScan.h"
+#include "std_srvs/Empty.h"
+#include "rplidar.h"
+
+#include <vector>
+
+namespace rplidar_ros {
+
+/// Owns the RPLIDAR driver and turns every grabbed revolution into a
+/// sensor_msgs::LaserScan. Shared by rplidarNode and the rplidar nodelet.
+class RPlidarScanPublisher
+{
+public:
+    enum {
+        MAX_SCAN_NODES = 2048,
+        SCAN_MSG_POOL_SIZE = 4,
+    };
+
+    RPlidarScanPublisher(ros::NodeHandle & nh, ros::NodeHandle & nh_private);
+    ~RPlidarScanPublisher();
+
+    /// Connect, check the device health and start the motor and scanning.
+    bool start();
+
+    /// Stop scanning and the motor and release the driver.
+    void stop();
+
+    /// Wait for the next revolution and publish it; returns false on timeout.
+    bool grabAndPublish();
+
+private:
+    bool getDeviceInfo();
+    bool checkHealth();
+
+    bool stopMotor(std_srvs::Empty::Request &req, std_srvs::Empty::Response &res);
+    bool startMotor(std_srvs::Empty::Request &req, std_srvs::Empty::Response &res);
+
+    void buildAngleCompensateLut();
+    size_t compensateAngles(const rplidar_response_measurement_node_t *nodes, size_t count);
+
+    sensor_msgs::LaserScanPtr acquireScanMsg();
+    void publishScan(const rplidar_response_measurement_node_t *nodes,
+                     size_t node_count, ros::Time start, double scan_time,
+                     float angle_min, float angle_max);
+
+    ros::NodeHandle nh_;
+    ros::Publisher scan_pub_;
+    ros::ServiceServer stop_motor_service_;
+    ros::ServiceServer start_motor_service_;
+
+    std::string serial_port_;
+    int serial_baudrate_;
+    std::string frame_id_;
+    bool inverted_;
+    bool angle_compensate_;
+    double angle_compensate_resolution_;
+    bool angle_compensate_min_range_;
+
+    rp::standalone::rplidar::RPlidarDriver * drv_;
+    _u32 last_scan_sequence_;
+
+    // scratch buffers reused every revolution
+    rplidar_response_measurement_node_t nodes_[MAX_SCAN_NODES];
+    std::vector<rplidar_response_measurement_node_t> angle_compensate_nodes_;
+    std::vector<_u16> angle_compensate_bin_err_;
+
+    // q6 angle -> fixed-grid bin and its distance (q6) from the bin angle
+    std::vector<_u16> angle_bin_lut_;
+    std::vector<_u16> angle_bin_err_lut_;
+
+    // published messages are handed out by shared pointer and recycled once no subscriber holds them
+    sensor_msgs::LaserScanPtr scan_msg_pool_[SCAN_MSG_POOL_SIZE];
+    size_t scan_msg_next_;
+};
+
+/// Convert q2 millimetre distances to metres, 0 (no return) becomes +inf.
+/// Written in reverse order when reverse is set. The scaling loop vectorises when the package is
+/// built optimised (e.g. catkin_make -DCMAKE_BUILD_TYPE=Release; checked with -fopt-info-vec).
+void convertRanges(const rplidar_response_measurement_node_t *nodes, size_t node_count,
+                   bool reverse, float *ranges, float *intensities);
+
+}
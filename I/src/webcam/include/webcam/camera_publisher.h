@@ -0,0 +1,53 @@
+#ifndef WEBCAM_CAMERA_PUBLISHER_H
+#define WEBCAM_CAMERA_PUBLISHER_H
+
+#include <string>
+#include <vector>
+#include <ros/ros.h>
+#include <image_transport/image_transport.h>
+#include <sensor_msgs/Image.h>
+#include <opencv2/highgui/highgui.hpp>
+
+namespace webcam {
+
+// Captures one camera and publishes its frames on camera/image.
+//
+// Every frame is decoded straight into the data of the outgoing message, and
+// the message is published by pointer. In a nodelet manager the subscribers
+// then get that very ImageConstPtr, with no serialization and no copy on the
+// way. Messages come from a small pool and are reused once nobody holds them.
+//
+// Parameters (private): device (int, default 0), reduced (bool, publish
+// 320x240), frame_id (string, default "camera").
+class CameraPublisher {
+public:
+  CameraPublisher(ros::NodeHandle& nh, ros::NodeHandle& nh_private);
+
+  // false if the device can not be opened
+  bool open();
+
+  // wait for the next frame, publish it and return it; null if the capture failed
+  sensor_msgs::ImageConstPtr grabAndPublish();
+
+  int device() const { return device_; }
+
+private:
+  static const size_t kPoolSize = 4;
+
+  // an unused message of the pool, sized width x height BGR8
+  sensor_msgs::ImagePtr nextMessage(int width, int height);
+
+  image_transport::Publisher pub_;
+  cv::VideoCapture cap_;
+  int device_;
+  bool reduced_;
+  std::string frame_id_;
+
+  cv::Size size_;        // of the frames the camera delivers, known after the first one
+  cv::Mat frame_;        // capture-size frame, only used when reduced
+  std::vector<sensor_msgs::ImagePtr> pool_;
+};
+
+}
+
+#endif
@@ -0,0 +1,84 @@
+#include "webcam/camera_publisher.h"
+
+#include <boost/make_shared.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <sensor_msgs/image_encodings.h>
+
+namespace webcam {
+
+// the message data as a cv::Mat, no copy
+static cv::Mat wrap(sensor_msgs::Image& msg)
+{
+  if (msg.data.empty()) return cv::Mat();
+  return cv::Mat(msg.height, msg.width, CV_8UC3, &msg.data[0], msg.step);
+}
+
+CameraPublisher::CameraPublisher(ros::NodeHandle& nh, ros::NodeHandle& nh_private)
+{
+  image_transport::ImageTransport it(nh);
+  pub_ = it.advertise("camera/image", 1);
+
+  nh_private.param("device", device_, 0);
+  nh_private.param("reduced", reduced_, false);
+  nh_private.param<std::string>("frame_id", frame_id_, "camera");
+}
+
+bool CameraPublisher::open()
+{
+  return cap_.open(device_);
+}
+
+sensor_msgs::ImagePtr CameraPublisher::nextMessage(int width, int height)
+{
+  sensor_msgs::ImagePtr msg;
+  for (size_t i = 0; i < pool_.size() && !msg; i++) {
+    if (pool_[i].unique()) msg = pool_[i];
+  }
+  if (!msg) {
+    // all in use, e.g. by a slow subscriber still holding frames
+    msg = boost::make_shared<sensor_msgs::Image>();
+    if (pool_.size() < kPoolSize) pool_.push_back(msg);
+  }
+
+  msg->header.frame_id = frame_id_;
+  msg->height = height;
+  msg->width = width;
+  msg->encoding = sensor_msgs::image_encodings::BGR8;
+  msg->is_bigendian = 0;
+  msg->step = width*3;
+  msg->data.resize((size_t)msg->step*height);  // keeps the capacity, no allocation once warm
+  return msg;
+}
+
+sensor_msgs::ImageConstPtr CameraPublisher::grabAndPublish()
+{
+  if (!cap_.grab()) return sensor_msgs::ImageConstPtr();
+  ros::Time stamp = ros::Time::now();
+
+  sensor_msgs::ImagePtr msg;
+  if (reduced_) {
+    if (!cap_.retrieve(frame_) || frame_.empty()) return sensor_msgs::ImageConstPtr();
+    msg = nextMessage(320, 240);
+    cv::Mat out = wrap(*msg);
+    cv::resize(frame_, out, out.size());
+  }
+  else {
+    // retrieve() only allocates when out does not have the frame size, so the
+    // frame is written into the message
+    msg = nextMessage(size_.width, size_.height);
+    cv::Mat out = wrap(*msg);
+    if (!cap_.retrieve(out) || out.empty()) return sensor_msgs::ImageConstPtr();
+    if (msg->data.empty() || out.data != &msg->data[0]) {
+      // first frame, or the size changed
+      size_ = out.size();
+      msg = nextMessage(size_.width, size_.height);
+      out.copyTo(wrap(*msg));
+    }
+  }
+
+  msg->header.stamp = stamp;
+  pub_.publish(msg);
+  return msg;
+}
+
+}
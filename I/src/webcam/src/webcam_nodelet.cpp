@@ -0,0 +1,53 @@
+#include <boost/thread.hpp>
+#include <nodelet/nodelet.h>
+#include <pluginlib/class_list_macros.h>
+
+#include "webcam/camera_publisher.h"
+
+namespace webcam {
+
+/// webcam_node inside a nodelet manager: nodelets of the same manager that
+/// subscribe to camera/image get the frame by pointer, all the same one.
+class WebcamNodelet : public nodelet::Nodelet
+{
+public:
+  WebcamNodelet() : running_(false) {}
+
+  ~WebcamNodelet()
+  {
+    running_ = false;
+    if (grab_thread_) grab_thread_->join();
+  }
+
+private:
+  virtual void onInit()
+  {
+    camera_.reset(new CameraPublisher(getNodeHandle(), getPrivateNodeHandle()));
+    if (!camera_->open()) {
+      NODELET_ERROR("can not open camera %d", camera_->device());
+      return;
+    }
+
+    // the capture blocks until the next frame, so it paces itself
+    running_ = true;
+    grab_thread_.reset(new boost::thread(boost::bind(&WebcamNodelet::grabLoop, this)));
+  }
+
+  void grabLoop()
+  {
+    while (running_ && ros::ok()) {
+      if (!camera_->grabAndPublish()) {
+        NODELET_WARN_THROTTLE(1, "no frame from camera %d", camera_->device());
+        ros::Duration(0.1).sleep();
+      }
+    }
+  }
+
+  volatile bool running_;
+  boost::shared_ptr<CameraPublisher> camera_;
+  boost::shared_ptr<boost::thread> grab_thread_;
+};
+
+}
+
+PLUGINLIB_EXPORT_CLASS(webcam::WebcamNodelet, nodelet::Nodelet)
@@ -8,6 +8,7 @@
 #include <sys/socket.h>
 #include <ros/ros.h>
 #include <geometry_msgs/Vector3.h>
+#include "robot_link/ros_config.h"
 
 extern "C" {
 	#include "xbox_ctrl/gamepad.h"
@@ -43,8 +44,7 @@ static const char* button_names[] = {
 	"Y"
 };
 
-int c_socket, s_socket;
-struct sockaddr_in c_addr;
+robot_link::RobotLink myrio;
 int len;
 int n;
 float data[24];
@@ -158,7 +158,7 @@ void autoBallTrack(const geometry_msgs::Vector3& msg)
 	{
 		dataInit();
 		data[8] = 0.5;
-		write(c_socket, data, sizeof(data));
+		myrio.setCommand(data);
 		return;
 	}
 
@@ -168,7 +168,7 @@ void autoBallTrack(const geometry_msgs::Vector3& msg)
 	{
 		dataInit();
 		data[14] = 0;
-		write(c_socket, data, sizeof(data));
+		myrio.setCommand(data);
 		flag_get_ball = 0;
 		return;
 	}
@@ -240,11 +240,11 @@ void autoBallTrack(const geometry_msgs::Vector3& msg)
 		data[14] = 1;
 		flag_get_ball = 0;
 	}
-	write(c_socket, data, sizeof(data));
+	myrio.setCommand(data);
 	cout << "send1" << endl;
 	ros::Duration(0.5).sleep();
 	dataInit();
-	write(c_socket, data, sizeof(data));
+	myrio.setCommand(data);
 	cout << "send2" << endl;
 	ros::Duration(0.05).sleep();
 }
@@ -265,17 +265,14 @@ int main(int argc, char **argv) {
 
 	GamepadInit();
 
-	c_socket = socket(PF_INET, SOCK_STREAM, 0);
-	printw("socket created\n");
-	c_addr.sin_addr.s_addr = inet_addr(IPADDR);
-	c_addr.sin_family = AF_INET;
-	c_addr.sin_port = htons(PORT);
-
-	if(connect(c_socket, (struct sockaddr*) &c_addr, sizeof(c_addr)) == -1){
+	robot_link::LinkConfig link_config;
+	link_config.host = IPADDR;
+	link_config.port = PORT;
+	if(!myrio.open(robot_link::loadLinkConfig(link_config))){
 		printf("Failed to connect\n");
-		close(c_socket);
 		return -1;
 	}
+	printw("connected\n");
 
 	while ((ch = getch()) != 'q') {
 		GamepadUpdate();
@@ -316,7 +313,8 @@ int main(int argc, char **argv) {
 			data[8] = GamepadTriggerLength(_dev, TRIGGER_LEFT);
 			data[9] = GamepadTriggerLength(_dev, TRIGGER_RIGHT);
 			data[14] = GamepadButtonDown(_dev, BUTTON_A); // duct on/off
-			write(c_socket, data, sizeof(data));
+			if(!myrio.setCommand(data))
+				ROS_ERROR_THROTTLE(1, "Lost the link to the myRIO");
 			ros::Duration(0.025).sleep();
 		}
 		else
@@ -372,7 +370,7 @@ int main(int argc, char **argv) {
 
 		refresh();
 	}
-	close(c_socket);
+	myrio.close();
 
 	ros::shutdown();
 